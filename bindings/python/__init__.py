@@ -24,6 +24,7 @@ from msgq.ipc_pyx import (
     SubSocket,
     PubSocket,
     SocketEventHandle,
+    EventSet,
     toggle_fake_events,
     set_fake_prefix,
     get_fake_prefix,
@@ -46,6 +47,7 @@ __all__ = [
     "SubSocket",
     "PubSocket",
     "SocketEventHandle",
+    "EventSet",
     "toggle_fake_events",
     "set_fake_prefix",
     "get_fake_prefix",
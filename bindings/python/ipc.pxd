@@ -4,18 +4,19 @@
 from libcpp.string cimport string
 from libcpp.vector cimport vector
 from libcpp cimport bool
+from libc.stdint cimport uint32_t
 
 
 cdef extern from "msgq/impl_fake.h":
   cdef cppclass Event:
     @staticmethod
-    int wait_for_one(vector[Event], int) except +
+    int wait_for_one(vector[Event], int) except + nogil
 
     Event()
     Event(int)
     void set()
     int clear()
-    void wait(int) except +
+    void wait(int) except + nogil
     bool peek()
     int fd()
 
@@ -34,6 +35,15 @@ cdef extern from "msgq/impl_fake.h":
     Event recv_ready()
 
 
+cdef extern from "msgq/event_modern.h" namespace "msgq::event":
+  cdef cppclass EventSet:
+    EventSet()
+    size_t add(int) except +
+    void clear()
+    size_t size()
+    int wait(int) except + nogil
+
+
 cdef extern from "msgq/ipc.h":
   cdef cppclass Context:
     @staticmethod
@@ -52,6 +62,7 @@ cdef extern from "msgq/ipc.h":
     int connect(Context *, string, string, bool) nogil
     Message * receive(bool) nogil
     void setTimeout(int) nogil
+    void setDecimation(uint32_t, double) except + nogil
 
   cdef cppclass PubSocket:
     @staticmethod
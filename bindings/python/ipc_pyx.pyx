@@ -1,11 +1,15 @@
 # distutils: language = c++
+# distutils: sources = src/clock_modern.cc
 # cython: c_string_encoding=ascii, language_level=3
+# Event/EventSet 的等待经 msgq::clock 计时（event_modern.h 的 ppoll_for），
+# 其定义在 clock_modern.cc，扩展模块须链接它；路径相对于仓库根目录（setup 的工作目录）
 
 import sys
 from libcpp.string cimport string
 from libcpp.vector cimport vector
 from libcpp cimport bool
 from libc cimport errno
+from libc.stdint cimport uint32_t
 from libc.string cimport strerror
 from cython.operator import dereference
 
@@ -16,6 +20,7 @@ from .ipc cimport PubSocket as cppPubSocket
 from .ipc cimport Poller as cppPoller
 from .ipc cimport Message as cppMessage
 from .ipc cimport Event as cppEvent, SocketEventHandle as cppSocketEventHandle
+from .ipc cimport EventSet as cppEventSet
 
 
 class IpcError(Exception):
@@ -45,11 +50,20 @@ def delete_fake_prefix():
   cppSocketEventHandle.set_fake_prefix(b"")
 
 
-def wait_for_one_event(list events, int timeout=-1):
+def wait_for_one_event(events, int timeout=-1):
   cdef vector[cppEvent] items
+  cdef int r
+
+  # A pre-built EventSet waits without touching Python objects
+  if isinstance(events, EventSet):
+    return (<EventSet>events).wait(timeout)
+
   for event in events:
     items.push_back(dereference(<cppEvent*><size_t>event.ptr))
-  return cppEvent.wait_for_one(items, timeout)
+
+  with nogil:
+    r = cppEvent.wait_for_one(items, timeout)
+  return r
 
 
 cdef class Event:
@@ -68,7 +82,8 @@ cdef class Event:
     return self.event.clear()
 
   def wait(self, int timeout=-1):
-    self.event.wait(timeout)
+    with nogil:
+      self.event.wait(timeout)
 
   def peek(self):
     return self.event.peek()
@@ -82,6 +97,37 @@ cdef class Event:
     return <size_t><void*>&self.event
 
 
+cdef class EventSet:
+  # Events waited on together; the pollfd array is built as events are
+  # added, so wait() allocates nothing and runs without the GIL
+  cdef cppEventSet events
+  cdef list members
+
+  def __cinit__(self, events=()):
+    self.members = []
+    for event in events:
+      self.add(event)
+
+  def add(self, Event event):
+    index = self.events.add(event.event.fd())
+    # The set only stores fds; keep the events alive with it
+    self.members.append(event)
+    return index
+
+  def clear(self):
+    self.events.clear()
+    self.members = []
+
+  def wait(self, int timeout=-1):
+    cdef int r
+    with nogil:
+      r = self.events.wait(timeout)
+    return r
+
+  def __len__(self):
+    return self.events.size()
+
+
 cdef class SocketEventHandle:
   cdef cppSocketEventHandle * handle;
 
@@ -201,6 +247,10 @@ cdef class SubSocket:
     with nogil:
       self.socket.setTimeout(timeout)
 
+  def setDecimation(self, uint32_t every_nth=1, double max_rate_hz=0.0):
+    with nogil:
+      self.socket.setDecimation(every_nth, max_rate_hz)
+
   def receive(self, bool non_blocking=False):
     cdef cppMessage *msg
     with nogil:
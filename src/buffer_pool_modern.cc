@@ -0,0 +1,319 @@
+#include "buffer_pool_modern.h"
+#include <unistd.h>
+#include <thread>
+
+namespace msgq {
+
+namespace {
+
+constexpr uint64_t POOL_MAGIC = 0x324c4f4f5051534dULL;  // "MSQPOOL2"
+constexpr uint64_t POOL_INITIALIZING = 1;
+
+// Slot state: generation in the high half, then the holds kept for readers
+// that have not pinned the buffer yet, then the reference count (which
+// includes those holds). A slot is free when its count is zero; claiming
+// it bumps the generation.
+constexpr uint64_t make_state(uint32_t generation, uint32_t pending, uint32_t refs) noexcept {
+    return (static_cast<uint64_t>(generation) << 32) | (static_cast<uint64_t>(pending) << 16) | refs;
+}
+constexpr uint32_t state_generation(uint64_t state) noexcept {
+    return static_cast<uint32_t>(state >> 32);
+}
+constexpr uint32_t state_pending(uint64_t state) noexcept {
+    return static_cast<uint32_t>((state >> 16) & 0xFFFF);
+}
+constexpr uint32_t state_refs(uint64_t state) noexcept {
+    return static_cast<uint32_t>(state & 0xFFFF);
+}
+
+struct PoolHeader {
+    std::atomic<uint64_t> magic;
+    uint64_t buffer_size;
+    uint32_t count;
+    std::atomic<uint32_t> cursor;  // Where the next acquire starts scanning
+};
+
+// One cache line per slot so readers pinning different buffers don't contend
+struct alignas(64) PoolSlot {
+    std::atomic<uint64_t> state;
+    uint64_t published_at;  // Queue::write_position() after the descriptor went out (publisher only)
+};
+
+size_t round_up(size_t n, size_t alignment) noexcept {
+    return (n + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+// ============================================================================
+// BufferPool implementation
+// ============================================================================
+
+class BufferPool::Impl {
+public:
+    SharedSegment segment_;
+    PoolHeader* header_ = nullptr;
+    PoolSlot* slots_ = nullptr;
+    char* buffers_ = nullptr;
+    size_t stride_ = 0;
+
+    Impl(std::string_view name, size_t buffer_size, uint32_t count, SegmentMode mode) {
+        if (buffer_size == 0 || count == 0) {
+            throw MessageQueueError("Buffer pool needs a non-zero buffer size and count");
+        }
+
+        // Buffers start on page boundaries so frames can be handed to
+        // page-granular consumers (DMA, GPU import) directly
+        const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        stride_ = round_up(buffer_size, page);
+        const size_t slots_offset = round_up(sizeof(PoolHeader), alignof(PoolSlot));
+        const size_t buffers_offset = round_up(slots_offset + sizeof(PoolSlot) * count, page);
+        const size_t total_size = buffers_offset + stride_ * count;
+
+        segment_ = SharedSegment::open(name, total_size, mode);
+        char* base = static_cast<char*>(segment_.data());
+        header_ = reinterpret_cast<PoolHeader*>(base);
+        slots_ = reinterpret_cast<PoolSlot*>(base + slots_offset);
+        buffers_ = base + buffers_offset;
+
+        // First opener records the geometry; everyone else waits for it and
+        // checks that it matches their own
+        uint64_t expected = 0;
+        if (header_->magic.compare_exchange_strong(expected, POOL_INITIALIZING)) {
+            header_->buffer_size = buffer_size;
+            header_->count = count;
+            header_->magic.store(POOL_MAGIC, std::memory_order_release);
+        } else {
+            while (expected == POOL_INITIALIZING) {
+                std::this_thread::yield();
+                expected = header_->magic.load(std::memory_order_acquire);
+            }
+            if (expected != POOL_MAGIC) {
+                throw MessageQueueError("Segment '" + std::string(name) + "' is not a buffer pool");
+            }
+            if (header_->buffer_size != buffer_size || header_->count != count) {
+                throw MessageQueueError("Buffer pool '" + std::string(name) + "' has " +
+                                        std::to_string(header_->count) + " buffers of " +
+                                        std::to_string(header_->buffer_size) + " bytes");
+            }
+        }
+    }
+
+    char* buffer(uint32_t index) const noexcept {
+        return buffers_ + stride_ * index;
+    }
+
+    void unref(uint32_t index) noexcept {
+        // Release orders our accesses to the buffer before its reuse
+        slots_[index].state.fetch_sub(1, std::memory_order_release);
+    }
+
+    // Drop the holds of readers that never pinned a buffer whose descriptor
+    // `queue` has since overwritten: they can no longer receive it
+    void expire_holds(const Queue& queue) noexcept {
+        for (uint32_t i = 0; i < header_->count; ++i) {
+            auto& state = slots_[i].state;
+            uint64_t current = state.load(std::memory_order_relaxed);
+            while (state_pending(current) != 0 && queue.overwritten(slots_[i].published_at)) {
+                const uint32_t pending = state_pending(current);
+                const uint64_t expired = make_state(state_generation(current), 0, state_refs(current) - pending);
+                if (state.compare_exchange_weak(current, expired, std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+        }
+    }
+};
+
+// ============================================================================
+// Buffer / Frame handles
+// ============================================================================
+
+BufferPool::Buffer::Buffer(std::shared_ptr<Impl> pool, uint32_t index, uint32_t generation,
+                           gsl::span<char> data) noexcept
+    : pool_(std::move(pool)), index_(index), generation_(generation), data_(data) {}
+
+BufferPool::Buffer::Buffer(Buffer&& other) noexcept
+    : pool_(std::move(other.pool_)), index_(other.index_),
+      generation_(other.generation_), data_(other.data_) {
+    other.data_ = {};
+}
+
+BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = std::move(other.pool_);
+        index_ = other.index_;
+        generation_ = other.generation_;
+        data_ = other.data_;
+        other.data_ = {};
+    }
+    return *this;
+}
+
+void BufferPool::Buffer::release() noexcept {
+    if (pool_) {
+        pool_->unref(index_);
+        pool_.reset();
+        data_ = {};
+    }
+}
+
+BufferPool::Frame::Frame(std::shared_ptr<Impl> pool, const BufferDescriptor& descriptor,
+                         gsl::span<const char> data) noexcept
+    : pool_(std::move(pool)), descriptor_(descriptor), data_(data) {}
+
+BufferPool::Frame::Frame(Frame&& other) noexcept
+    : pool_(std::move(other.pool_)), descriptor_(other.descriptor_), data_(other.data_) {
+    other.data_ = {};
+}
+
+BufferPool::Frame& BufferPool::Frame::operator=(Frame&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = std::move(other.pool_);
+        descriptor_ = other.descriptor_;
+        data_ = other.data_;
+        other.data_ = {};
+    }
+    return *this;
+}
+
+void BufferPool::Frame::release() noexcept {
+    if (pool_) {
+        pool_->unref(descriptor_.index);
+        pool_.reset();
+        data_ = {};
+    }
+}
+
+// ============================================================================
+// BufferPool public interface
+// ============================================================================
+
+BufferPool::BufferPool(std::shared_ptr<Impl> impl) noexcept : impl_(std::move(impl)) {}
+
+BufferPool BufferPool::create(std::string_view name, size_t buffer_size, uint32_t count,
+                              SegmentMode mode) {
+    return BufferPool(std::make_shared<Impl>(name, buffer_size, count, mode));
+}
+
+std::optional<BufferPool::Buffer> BufferPool::acquire(const Queue& queue) {
+    impl_->expire_holds(queue);
+
+    const uint32_t n = impl_->header_->count;
+    const uint32_t start = impl_->header_->cursor.load(std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < n; ++i) {
+        const uint32_t index = (start + i) % n;
+        auto& state = impl_->slots_[index].state;
+        uint64_t current = state.load(std::memory_order_relaxed);
+        if (state_refs(current) != 0) {
+            continue;
+        }
+
+        // Bumping the generation invalidates descriptors still in flight;
+        // acquire pairs with the release in unref()
+        const uint32_t generation = state_generation(current) + 1;
+        if (state.compare_exchange_strong(current, make_state(generation, 0, 1),
+                                          std::memory_order_acquire, std::memory_order_relaxed)) {
+            impl_->header_->cursor.store((index + 1) % n, std::memory_order_relaxed);
+            return Buffer(impl_, index, generation,
+                          gsl::span<char>(impl_->buffer(index), impl_->header_->buffer_size));
+        }
+    }
+    return std::nullopt;
+}
+
+void BufferPool::publish(Queue& queue, Buffer&& buffer, size_t length) {
+    if (buffer.pool_ != impl_) {
+        throw MessageQueueError("Buffer does not belong to this pool");
+    }
+    if (length > buffer.data_.size()) {
+        throw MessageQueueError("Publish length exceeds buffer size");
+    }
+
+    // One hold per subscriber, taken before the descriptor can be seen, so
+    // the buffer outlives the publisher's reference until each of them
+    // has pinned it or the descriptor was lapped (expire_holds)
+    auto& slot = impl_->slots_[buffer.index_];
+    const uint32_t readers = static_cast<uint32_t>(queue.num_readers());
+    slot.state.fetch_add(make_state(0, readers, readers), std::memory_order_relaxed);
+
+    BufferDescriptor descriptor{buffer.index_, buffer.generation_, length};
+    try {
+        queue.send(gsl::span<const char>(reinterpret_cast<const char*>(&descriptor), sizeof(descriptor)));
+    } catch (...) {
+        slot.state.fetch_sub(make_state(0, readers, readers), std::memory_order_relaxed);
+        throw;
+    }
+    slot.published_at = queue.write_position();
+
+    Buffer released = std::move(buffer);
+}
+
+BufferPool::Frame BufferPool::pin(const BufferDescriptor& descriptor) {
+    if (descriptor.index >= impl_->header_->count || descriptor.length > impl_->header_->buffer_size) {
+        throw MessageQueueError("Invalid buffer descriptor");
+    }
+
+    auto& state = impl_->slots_[descriptor.index].state;
+    uint64_t current = state.load(std::memory_order_relaxed);
+    for (;;) {
+        // A different generation means the publisher recycled the buffer
+        if (state_generation(current) != descriptor.generation) {
+            return Frame();
+        }
+        // Take over a hold left for us, or add a reference if every hold
+        // is taken (a subscriber that joined after the publish)
+        const uint64_t pinned = state_pending(current) != 0
+            ? current - make_state(0, 1, 0)
+            : current + 1;
+        if (state.compare_exchange_weak(current, pinned,
+                                        std::memory_order_acquire, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    return Frame(impl_, descriptor,
+                 gsl::span<const char>(impl_->buffer(descriptor.index), descriptor.length));
+}
+
+BufferPool::Frame BufferPool::receive(Queue& queue, int timeout_ms) {
+    for (;;) {
+        Message msg = queue.recv(timeout_ms);
+        if (msg.empty()) {
+            return Frame();
+        }
+        if (msg.size() != sizeof(BufferDescriptor)) {
+            throw MessageQueueError("Unexpected message on buffer pool queue");
+        }
+
+        BufferDescriptor descriptor;
+        std::memcpy(&descriptor, msg.data_ptr(), sizeof(descriptor));
+        if (Frame frame = pin(descriptor)) {
+            return frame;
+        }
+    }
+}
+
+size_t BufferPool::buffer_size() const noexcept {
+    return impl_->header_->buffer_size;
+}
+
+uint32_t BufferPool::count() const noexcept {
+    return impl_->header_->count;
+}
+
+uint32_t BufferPool::available() const noexcept {
+    uint32_t free = 0;
+    for (uint32_t i = 0; i < impl_->header_->count; ++i) {
+        if (state_refs(impl_->slots_[i].state.load(std::memory_order_relaxed)) == 0) {
+            ++free;
+        }
+    }
+    return free;
+}
+
+} // namespace msgq
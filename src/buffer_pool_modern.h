@@ -0,0 +1,134 @@
+#pragma once
+
+/*
+ * Shared-memory buffer pool - large payloads without copies
+ *
+ * A pool is one shared segment holding `count` fixed-size buffers, each with
+ * a reference count. The publisher fills a buffer in place and sends only a
+ * 16-byte BufferDescriptor through an ordinary Queue; subscribers map the
+ * pool once and pin the buffer the descriptor names, reading it in place.
+ * A buffer returns to the pool when the publisher and every pinned reader
+ * have released it. Publishing leaves a hold for each subscriber of the
+ * queue, which its pin() takes over, so a slow reader still finds its
+ * buffer; holds of readers that never pin (gone, or a whole ring behind)
+ * expire once the queue has overwritten the descriptor.
+ *
+ * Every reuse of a buffer bumps its generation, so a descriptor that arrives
+ * after its buffer was recycled is detected and dropped instead of exposing
+ * a half-written frame. A reader that dies while holding a frame leaks that
+ * buffer until the pool segment is recreated.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "msgq_modern.h"
+
+namespace msgq {
+
+struct BufferDescriptor {
+    uint32_t index;       // Buffer slot in the pool
+    uint32_t generation;  // Slot generation when the buffer was published
+    uint64_t length;      // Valid bytes at the start of the buffer
+};
+
+static_assert(sizeof(BufferDescriptor) == 16, "descriptor is sent as raw bytes");
+
+class BufferPool {
+private:
+    class Impl;
+    std::shared_ptr<Impl> impl_;
+
+    explicit BufferPool(std::shared_ptr<Impl> impl) noexcept;
+
+public:
+    // Writable buffer leased to the publisher. Dropping it without
+    // publishing returns it to the pool.
+    class Buffer {
+    private:
+        friend class BufferPool;
+        std::shared_ptr<Impl> pool_;
+        uint32_t index_ = 0;
+        uint32_t generation_ = 0;
+        gsl::span<char> data_;
+
+        Buffer(std::shared_ptr<Impl> pool, uint32_t index, uint32_t generation,
+               gsl::span<char> data) noexcept;
+        void release() noexcept;
+
+    public:
+        Buffer() = default;
+
+        // Non-copyable, moveable
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+        ~Buffer() { release(); }
+
+        [[nodiscard]] gsl::span<char> data() const noexcept { return data_; }
+        [[nodiscard]] uint32_t index() const noexcept { return index_; }
+        [[nodiscard]] bool valid() const noexcept { return pool_ != nullptr; }
+        explicit operator bool() const noexcept { return valid(); }
+    };
+
+    // Read-only view of a published buffer, pinned until destroyed
+    class Frame {
+    private:
+        friend class BufferPool;
+        std::shared_ptr<Impl> pool_;
+        BufferDescriptor descriptor_{};
+        gsl::span<const char> data_;
+
+        Frame(std::shared_ptr<Impl> pool, const BufferDescriptor& descriptor,
+              gsl::span<const char> data) noexcept;
+        void release() noexcept;
+
+    public:
+        Frame() = default;
+
+        // Non-copyable, moveable
+        Frame(const Frame&) = delete;
+        Frame& operator=(const Frame&) = delete;
+        Frame(Frame&& other) noexcept;
+        Frame& operator=(Frame&& other) noexcept;
+        ~Frame() { release(); }
+
+        [[nodiscard]] gsl::span<const char> data() const noexcept { return data_; }
+        [[nodiscard]] const BufferDescriptor& descriptor() const noexcept { return descriptor_; }
+        [[nodiscard]] size_t size() const noexcept { return data_.size(); }
+        [[nodiscard]] bool valid() const noexcept { return pool_ != nullptr; }
+        explicit operator bool() const noexcept { return valid(); }
+    };
+
+    // Open (creating if needed) the pool `name`. Every process must pass the
+    // same geometry; a mismatch with an existing pool throws.
+    [[nodiscard]] static BufferPool create(std::string_view name, size_t buffer_size, uint32_t count,
+                                           SegmentMode mode = default_segment_mode());
+
+    // Lease a free buffer, or nullopt if every buffer is still in use.
+    // `queue` is the one buffers are published on: holds for descriptors
+    // it has overwritten are dropped first.
+    [[nodiscard]] std::optional<Buffer> acquire(const Queue& queue);
+
+    // Send the descriptor for the first `length` bytes of `buffer` through
+    // `queue`, holding the buffer for each of its subscribers, and drop
+    // the publisher's reference. One publisher per pool.
+    void publish(Queue& queue, Buffer&& buffer, size_t length);
+
+    // Pin the buffer named by `descriptor`; returns an invalid Frame if the
+    // buffer has been recycled since the descriptor was sent
+    [[nodiscard]] Frame pin(const BufferDescriptor& descriptor);
+
+    // Receive descriptors from `queue` until one can be pinned. Stale
+    // descriptors are skipped; returns an invalid Frame if none is left.
+    [[nodiscard]] Frame receive(Queue& queue, int timeout_ms = DEFAULT_TIMEOUT_MS);
+
+    // Status queries
+    [[nodiscard]] size_t buffer_size() const noexcept;
+    [[nodiscard]] uint32_t count() const noexcept;
+    [[nodiscard]] uint32_t available() const noexcept;
+};
+
+} // namespace msgq
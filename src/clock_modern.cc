@@ -0,0 +1,288 @@
+#include "clock_modern.h"
+#include <sys/mman.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace msgq {
+namespace clock {
+
+namespace {
+
+constexpr uint64_t VIRTUAL_CLOCK_MAGIC = 0x4b434f4c43515347ULL;  // "GSQCLOCK"
+
+// Not a valid topic name, so it cannot collide with an EventState file
+constexpr const char* CLOCK_FILE = ".virtual_clock";
+
+// Longest futex sleep in sleep_until() between checks that the controller
+// is still alive
+constexpr auto SLEEP_RECHECK = std::chrono::milliseconds(100);
+
+bool process_alive(pid_t pid) noexcept {
+    return pid > 0 && (::kill(pid, 0) == 0 || errno == EPERM);
+}
+
+bool fake_mode() noexcept {
+    return std::getenv("CEREAL_FAKE") != nullptr;
+}
+
+// Same directory as SocketEventHandle::map_event_state()
+std::string clock_directory() {
+    std::string path = "/dev/shm/";
+    if (const char* prefix = std::getenv("OPENPILOT_PREFIX"); prefix != nullptr) {
+        path += std::string(prefix) + "/";
+    }
+    path += "cereal_events/";
+    if (const char* fake_prefix = std::getenv("CEREAL_FAKE_PREFIX"); fake_prefix != nullptr && *fake_prefix != '\0') {
+        path += std::string(fake_prefix) + "/";
+    }
+    return path;
+}
+
+VirtualClockState* map_state(int fd) noexcept {
+    void* mem = ::mmap(nullptr, sizeof(VirtualClockState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return mem == MAP_FAILED ? nullptr : static_cast<VirtualClockState*>(mem);
+}
+
+int64_t steady_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Reader side mapping of the current prefix's clock. Mappings are never
+// unmapped: another thread may still be reading one. What was found, a
+// clock or none, is reused without locking until `recheck_ns` (steady
+// time), so now() in fake mode without a controller does not build the
+// path and fail an open() on every call.
+struct Attachment {
+    std::mutex mutex;
+    std::string path;
+    std::atomic<VirtualClockState*> state{nullptr};
+    std::atomic<int64_t> recheck_ns{0};
+};
+
+Attachment& attachment() {
+    static Attachment instance;
+    return instance;
+}
+
+VirtualClockState* attach(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    VirtualClockState* state = nullptr;
+    if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(VirtualClockState)) {
+        state = map_state(fd);
+    }
+    ::close(fd);
+    if (state != nullptr && (state->magic.load(std::memory_order_acquire) != VIRTUAL_CLOCK_MAGIC ||
+                             state->owned.load(std::memory_order_acquire) == 0 ||
+                             !process_alive(state->owner_pid.load(std::memory_order_relaxed)))) {
+        ::munmap(state, sizeof(VirtualClockState));
+        state = nullptr;
+    }
+    return state;
+}
+
+// The clock now() follows, or null for steady time
+VirtualClockState* virtual_state() {
+    if (!fake_mode()) {
+        return nullptr;
+    }
+
+    Attachment& cache = attachment();
+    VirtualClockState* state = cache.state.load(std::memory_order_acquire);
+    const bool usable = state == nullptr || state->owned.load(std::memory_order_acquire) != 0;
+    if (usable && steady_ns() < cache.recheck_ns.load(std::memory_order_acquire)) {
+        return state;
+    }
+
+    const std::string path = clock_directory() + CLOCK_FILE;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    state = cache.state.load(std::memory_order_relaxed);
+    if (cache.path != path || state == nullptr || state->owned.load(std::memory_order_acquire) == 0) {
+        cache.path = path;
+        state = attach(path);
+        cache.state.store(state, std::memory_order_release);
+    }
+    cache.recheck_ns.store(steady_ns() + std::chrono::nanoseconds(ATTACH_RETRY).count(),
+                           std::memory_order_release);
+    return state;
+}
+
+// Make the next now() in this process look for the clock again
+void forget_attachment() noexcept {
+    attachment().recheck_ns.store(0, std::memory_order_release);
+}
+
+Clock::time_point virtual_now(const VirtualClockState& state) noexcept {
+    return Clock::time_point(Clock::duration(state.now_ns.load(std::memory_order_acquire)));
+}
+
+// The segment is MAP_SHARED between processes, so no FUTEX_PRIVATE_FLAG
+void futex_wait(const std::atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout) noexcept {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    ::syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+void futex_wake_all(std::atomic<uint32_t>& word) noexcept {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+} // namespace
+
+Clock::time_point Clock::now() noexcept {
+    try {
+        if (const VirtualClockState* state = virtual_state()) {
+            return virtual_now(*state);
+        }
+    } catch (...) {
+        // Out of memory building the path: fall back to steady time
+    }
+    return time_point(std::chrono::duration_cast<duration>(
+        std::chrono::steady_clock::now().time_since_epoch()));
+}
+
+bool is_virtual() noexcept {
+    try {
+        return virtual_state() != nullptr;
+    } catch (...) {
+        return false;
+    }
+}
+
+Clock::time_point deadline_after(int timeout_ms) noexcept {
+    if (timeout_ms < 0) {
+        return Clock::time_point::max();
+    }
+    return now() + std::chrono::milliseconds(timeout_ms);
+}
+
+int wait_slice_ms(Clock::time_point deadline) noexcept {
+    if (deadline == Clock::time_point::max()) {
+        return -1;
+    }
+    const Clock::time_point current = now();
+    if (current >= deadline) {
+        return 0;
+    }
+    if (is_virtual()) {
+        return static_cast<int>(VIRTUAL_WAIT_SLICE.count());
+    }
+    const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - current).count();
+    return static_cast<int>(std::min<int64_t>(remaining, INT_MAX));
+}
+
+void sleep_until(Clock::time_point deadline) {
+    for (;;) {
+        VirtualClockState* state = virtual_state();
+        if (state == nullptr) {
+            const auto current = now();
+            if (current >= deadline) {
+                return;
+            }
+            std::this_thread::sleep_for(std::min<Clock::duration>(deadline - current, SLEEP_RECHECK));
+            continue;
+        }
+
+        // Read the generation first, so an advance after the time check
+        // changes it and the futex wait returns at once
+        const uint32_t generation = state->generation.load(std::memory_order_acquire);
+        if (virtual_now(*state) >= deadline) {
+            return;
+        }
+        futex_wait(state->generation, generation, SLEEP_RECHECK);
+
+        // A controller that died without letting go would freeze the clock
+        if (!process_alive(state->owner_pid.load(std::memory_order_relaxed))) {
+            state->owned.store(0, std::memory_order_release);
+        }
+    }
+}
+
+VirtualClock::VirtualClock() : VirtualClock(Clock::duration(steady_ns())) {}
+
+VirtualClock::VirtualClock(Clock::duration start) {
+    const std::string directory = clock_directory();
+    try {
+        std::filesystem::create_directories(directory);
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to create directories: " + std::string(e.what()));
+    }
+    path_ = directory + CLOCK_FILE;
+
+    // Reuse a stale file's inode, so processes that still map it follow
+    // this controller without re-attaching
+    int fd = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0664);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open virtual clock " + path_ + ": " + std::string(strerror(errno)));
+    }
+    if (::ftruncate(fd, sizeof(VirtualClockState)) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("Could not size virtual clock: " + std::string(strerror(err)));
+    }
+    state_ = map_state(fd);
+    ::close(fd);
+    if (state_ == nullptr) {
+        throw std::runtime_error("Could not map virtual clock: " + std::string(strerror(errno)));
+    }
+
+    state_->now_ns.store(start.count(), std::memory_order_relaxed);
+    state_->owner_pid.store(::getpid(), std::memory_order_relaxed);
+    state_->owned.store(1, std::memory_order_relaxed);
+    state_->magic.store(VIRTUAL_CLOCK_MAGIC, std::memory_order_release);
+    state_->generation.fetch_add(1, std::memory_order_release);
+    futex_wake_all(state_->generation);
+    forget_attachment();
+}
+
+VirtualClock::~VirtualClock() {
+    if (state_ == nullptr) {
+        return;
+    }
+    // Readers drop the mapping and go back to steady time
+    state_->owned.store(0, std::memory_order_release);
+    state_->generation.fetch_add(1, std::memory_order_release);
+    futex_wake_all(state_->generation);
+    ::unlink(path_.c_str());
+    ::munmap(state_, sizeof(VirtualClockState));
+    forget_attachment();
+}
+
+void VirtualClock::set(Clock::time_point time) {
+    const int64_t target = time.time_since_epoch().count();
+    if (target < state_->now_ns.load(std::memory_order_relaxed)) {
+        throw std::invalid_argument("Virtual clock cannot go backwards");
+    }
+    state_->now_ns.store(target, std::memory_order_release);
+    state_->generation.fetch_add(1, std::memory_order_release);
+    futex_wake_all(state_->generation);
+}
+
+void VirtualClock::advance(Clock::duration step) {
+    set(now() + step);
+}
+
+Clock::time_point VirtualClock::now() const noexcept {
+    return virtual_now(*state_);
+}
+
+} // namespace clock
+} // namespace msgq
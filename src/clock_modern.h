@@ -0,0 +1,115 @@
+#pragma once
+
+/*
+ * Deterministic virtual clock for fake (lockstep) mode
+ *
+ * A lockstep controller creates a VirtualClock, a small shared segment
+ * next to the EventState files of its CEREAL_FAKE_PREFIX, and advances it
+ * as it steps the simulation. In every process with CEREAL_FAKE set,
+ * clock::now() then returns that virtual time, and the timeouts of
+ * Event::wait, EventSet::wait, SubSocket::setTimeout and the Poller are
+ * measured against it, so a replay gives the same results at any speed.
+ * Without CEREAL_FAKE, or while no controller owns a clock, now() is
+ * std::chrono::steady_clock.
+ *
+ * Processes look for a controller's clock at most every ATTACH_RETRY
+ * (and re-read the prefix as often), so one that starts later is picked
+ * up within that interval; the controller's own process sees it at once.
+ *
+ * Waits on fds cannot also wait on the clock, so a blocking call with a
+ * virtual deadline blocks in real-time slices of VIRTUAL_WAIT_SLICE and
+ * rechecks the deadline in between; clock::sleep_until() sleeps on the
+ * clock's futex instead and wakes as soon as the controller passes it.
+ *
+ * Self-contained (no msgq_modern.h / msgq.h) like memfd_segment_modern.h.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace msgq {
+namespace clock {
+
+// Monotonic clock that follows the virtual clock in fake mode
+struct Clock {
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<Clock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept;
+};
+
+// Longest real-time block of a wait with a virtual deadline
+constexpr auto VIRTUAL_WAIT_SLICE = std::chrono::milliseconds(1);
+
+// How long now() keeps using what it found (a clock, or none) before it
+// looks at the prefix and the clock file again
+constexpr auto ATTACH_RETRY = std::chrono::milliseconds(10);
+
+// Virtual time in fake mode while a controller owns the clock, steady
+// time otherwise
+[[nodiscard]] inline Clock::time_point now() noexcept { return Clock::now(); }
+
+// now() is reading a virtual clock
+[[nodiscard]] bool is_virtual() noexcept;
+
+// Deadline `timeout_ms` from now (negative = never)
+[[nodiscard]] Clock::time_point deadline_after(int timeout_ms) noexcept;
+
+// Milliseconds a poll()-style call may block before `deadline` must be
+// checked again: the time left in real mode, at most VIRTUAL_WAIT_SLICE
+// in virtual mode, 0 once it has passed, -1 for Clock::time_point::max()
+[[nodiscard]] int wait_slice_ms(Clock::time_point deadline) noexcept;
+
+// Sleep until now() reaches `deadline`
+void sleep_until(Clock::time_point deadline);
+inline void sleep_for(Clock::duration duration) { sleep_until(now() + duration); }
+
+// Shared state; lives in the segment
+struct VirtualClockState {
+    std::atomic<uint64_t> magic;        // VIRTUAL_CLOCK_MAGIC once initialized
+    std::atomic<int64_t> now_ns;        // Current virtual time
+    std::atomic<uint32_t> generation;   // Bumped and futex-woken on every change
+    std::atomic<uint32_t> owned;        // Cleared when the controller goes away
+    std::atomic<int32_t> owner_pid;     // Controller process; a dead owner's clock is ignored
+};
+
+// Controller side: owns the clock of the current OPENPILOT_PREFIX /
+// CEREAL_FAKE_PREFIX until destroyed. Time only moves when set.
+class VirtualClock {
+public:
+    // Starts at the current steady time, so deadlines that waits already
+    // running took from steady time stay where they were. Throws
+    // std::runtime_error if the segment cannot be created.
+    VirtualClock();
+
+    // Starts at `start`. Waits already running when the clock appears
+    // keep their deadline, so one earlier than steady time stretches
+    // them until the controller catches up.
+    explicit VirtualClock(Clock::duration start);
+    ~VirtualClock();
+
+    VirtualClock(const VirtualClock&) = delete;
+    VirtualClock& operator=(const VirtualClock&) = delete;
+
+    // Move the clock to `time`. Throws std::invalid_argument if that is
+    // earlier than now (the clock is monotonic).
+    void set(Clock::time_point time);
+    void advance(Clock::duration step);
+
+    [[nodiscard]] Clock::time_point now() const noexcept;
+
+    // Segment path, for diagnostics
+    [[nodiscard]] const std::string& path() const noexcept { return path_; }
+
+private:
+    std::string path_;
+    VirtualClockState* state_ = nullptr;
+};
+
+} // namespace clock
+} // namespace msgq
@@ -0,0 +1,136 @@
+#include "compression_pool_modern.h"
+#include <algorithm>
+#include <utility>
+
+namespace msgq {
+
+CompressionPool::CompressionPool(const CompressionOptions& options) : options_(options) {
+    if (options_.max_pending == 0) {
+        throw MessageQueueError("Compression pool needs room for at least one message");
+    }
+    size_t count = options_.workers;
+    if (count == 0) {
+        count = std::max<size_t>(std::thread::hardware_concurrency() / 2, 1);
+    }
+    threads_.reserve(count);
+    try {
+        for (size_t i = 0; i < count; ++i) {
+            threads_.emplace_back(options_.realtime, [this] { run(); });
+        }
+    } catch (...) {
+        // Malformed realtime options: release the workers already started
+        stop();
+        throw;
+    }
+}
+
+CompressionPool::~CompressionPool() {
+    stop();
+}
+
+void CompressionPool::stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void CompressionPool::publish(Queue& queue, gsl::span<const char> data, uint64_t tag) {
+    ByteBuffer payload = copy_bytes(data.data(), data.size(), std::pmr::get_default_resource());
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    rethrow_error();
+    progress_.wait(lock, [this] { return pending_ < options_.max_pending; });
+    Lane& lane = lanes_[&queue];
+    jobs_.push_back(Job{&queue, lane.next_ticket++, tag, std::move(payload)});
+    pending_++;
+    lock.unlock();
+    work_ready_.notify_one();
+}
+
+void CompressionPool::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    progress_.wait(lock, [this] { return pending_ == 0; });
+    rethrow_error();
+}
+
+std::vector<RealtimeReport> CompressionPool::realtime() const {
+    std::vector<RealtimeReport> reports;
+    reports.reserve(threads_.size());
+    for (const auto& thread : threads_) {
+        reports.push_back(thread.report());
+    }
+    return reports;
+}
+
+CompressionPool::Stats CompressionPool::stats(const Queue& queue) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = lanes_.find(&queue);
+    return it != lanes_.end() ? it->second.stats : Stats{};
+}
+
+// Called with the mutex held
+void CompressionPool::rethrow_error() {
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+void CompressionPool::run() {
+    ByteBuffer frame;  // Reused across jobs; keeps its high-water capacity
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        work_ready_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+        if (jobs_.empty()) {
+            return;  // Stopping and drained
+        }
+        Job job = std::move(jobs_.front());
+        jobs_.pop_front();
+        lock.unlock();
+
+        const auto start = std::chrono::steady_clock::now();
+        const gsl::span<const char> payload(job.payload.data(), job.payload.size());
+        const bool compressed = payload.size() >= options_.min_size && compress_frame(payload, frame);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        // Jobs leave jobs_ in ticket order, so the one we wait for is
+        // already with another worker
+        lock.lock();
+        Lane& lane = lanes_[job.queue];
+        progress_.wait(lock, [&] { return lane.next_send == job.ticket; });
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            if (compressed) {
+                job.queue->send_compressed(gsl::span<const char>(frame.data(), frame.size()), job.tag);
+            } else {
+                job.queue->send(payload, job.tag);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        lane.next_send++;
+        lane.stats.messages++;
+        lane.stats.compressed += compressed ? 1 : 0;
+        lane.stats.raw_bytes += payload.size();
+        lane.stats.sent_bytes += compressed ? frame.size() : payload.size();
+        lane.stats.compress_time += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+        if (error && !error_) {
+            error_ = error;
+        }
+        pending_--;
+        progress_.notify_all();
+    }
+}
+
+} // namespace msgq
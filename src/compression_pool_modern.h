@@ -0,0 +1,106 @@
+#pragma once
+
+/*
+ * Worker pool that compresses message payloads off the publishing thread
+ *
+ * publish() copies the payload and returns; a worker encodes it with
+ * compress_frame() and sends it on the queue, flagged compressed, or as is
+ * when compressing does not pay. Messages to one queue go out in publish()
+ * order; queues do not wait on each other, so one pool can serve every
+ * topic of a bridge or logger. Subscribers need no setup: recv() expands
+ * compressed records.
+ *
+ * The pool becomes the queue's only sender (Queue is single producer): do
+ * not call Queue::send on it while messages are pending.
+ *
+ * Workers are RealtimeThreads: CompressionOptions::realtime sets their
+ * priority, cores and stack, and realtime() reports what took effect.
+ */
+
+#include "msgq_modern.h"
+#include "realtime_modern.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace msgq {
+
+struct CompressionOptions {
+    size_t workers = 0;         // Worker threads, 0 = half the hardware threads (at least one)
+    size_t max_pending = 64;    // publish() blocks while this many messages wait to be sent
+    size_t min_size = 1024;     // Smaller payloads are sent as is
+    RealtimeOptions realtime;   // Applied to every worker before it takes jobs
+};
+
+class CompressionPool {
+public:
+    struct Stats {
+        uint64_t messages = 0;                     // Messages sent
+        uint64_t compressed = 0;                   // Of which went out compressed
+        uint64_t raw_bytes = 0;                    // Payload bytes passed to publish()
+        uint64_t sent_bytes = 0;                   // Payload bytes written to the queue
+        std::chrono::nanoseconds compress_time{0};  // Worker time spent compressing
+    };
+
+    explicit CompressionPool(const CompressionOptions& options = {});
+
+    // Sends everything still pending, then joins the workers
+    ~CompressionPool();
+
+    CompressionPool(const CompressionPool&) = delete;
+    CompressionPool& operator=(const CompressionPool&) = delete;
+
+    // Queue a copy of `data` for `queue`, an initialized publisher that must
+    // outlive the pending messages. Throws the first error a worker hit
+    // sending since the last publish() or flush().
+    void publish(Queue& queue, gsl::span<const char> data, uint64_t tag = 0);
+
+    // Wait until everything published so far has been sent
+    void flush();
+
+    // Totals for one queue since the pool started
+    [[nodiscard]] Stats stats(const Queue& queue) const;
+
+    [[nodiscard]] size_t workers() const noexcept { return threads_.size(); }
+
+    // What CompressionOptions::realtime achieved, one report per worker
+    [[nodiscard]] std::vector<RealtimeReport> realtime() const;
+
+private:
+    struct Job {
+        Queue* queue;
+        uint64_t ticket;   // Position in the queue's publish order
+        uint64_t tag;
+        ByteBuffer payload;
+    };
+
+    // Per-queue ordering: tickets handed out by publish(), the next to send
+    struct Lane {
+        uint64_t next_ticket = 0;
+        uint64_t next_send = 0;
+        Stats stats;
+    };
+
+    void run();
+    void stop() noexcept;
+    void rethrow_error();
+
+    CompressionOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable work_ready_;  // Jobs queued, or stopping
+    std::condition_variable progress_;    // A message was sent
+    std::deque<Job> jobs_;
+    std::unordered_map<const Queue*, Lane> lanes_;
+    size_t pending_ = 0;                  // Published but not yet sent
+    std::exception_ptr error_;
+    bool stopping_ = false;
+    std::vector<RealtimeThread> threads_;
+};
+
+} // namespace msgq
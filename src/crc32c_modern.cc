@@ -0,0 +1,202 @@
+#include "crc32c_modern.h"
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define MSGQ_CRC32C_X86 1
+#define MSGQ_CRC_TARGET __attribute__((target("sse4.2")))
+#elif defined(__aarch64__) && defined(__linux__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define MSGQ_CRC32C_ARM 1
+#if defined(__clang__)
+#define MSGQ_CRC_TARGET __attribute__((target("crc")))
+#else
+#define MSGQ_CRC_TARGET __attribute__((target("+crc")))
+#endif
+#endif
+
+namespace msgq {
+
+namespace {
+
+constexpr uint32_t POLY = 0x82f63b78;  // Castagnoli polynomial, bit-reflected
+
+// Lane length of the hardware kernel: long lanes for the bulk of a buffer,
+// short lanes for what is left of it
+constexpr size_t LONG_LANE = 8192;
+constexpr size_t SHORT_LANE = 256;
+
+// a * b modulo P, both reflected (x^0 is the top bit)
+uint32_t multmodp(uint32_t a, uint32_t b) noexcept {
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ POLY : b >> 1;
+    }
+    return p;
+}
+
+// x^(8 * bytes) modulo P: the operator that appends `bytes` zero bytes
+uint32_t zeros_operator(size_t bytes) noexcept {
+    uint32_t result = 1u << 31;  // x^0
+    uint32_t power = 1u << 23;   // x^8
+    for (; bytes != 0; bytes >>= 1) {
+        if (bytes & 1) {
+            result = multmodp(power, result);
+        }
+        power = multmodp(power, power);
+    }
+    return result;
+}
+
+struct Tables {
+    uint32_t bytes[256];           // Byte-at-a-time fallback
+    uint32_t long_shift[4][256];   // Append LONG_LANE zero bytes, one table per crc byte
+    uint32_t short_shift[4][256];  // Append SHORT_LANE zero bytes
+
+    Tables() noexcept {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (c >> 1) ^ POLY : c >> 1;
+            }
+            bytes[n] = c;
+        }
+        const uint32_t long_op = zeros_operator(LONG_LANE);
+        const uint32_t short_op = zeros_operator(SHORT_LANE);
+        for (uint32_t k = 0; k < 4; ++k) {
+            for (uint32_t n = 0; n < 256; ++n) {
+                long_shift[k][n] = multmodp(long_op, n << (8 * k));
+                short_shift[k][n] = multmodp(short_op, n << (8 * k));
+            }
+        }
+    }
+};
+
+const Tables& tables() noexcept {
+    static const Tables instance;
+    return instance;
+}
+
+uint32_t crc32c_software(uint32_t crc, const unsigned char* p, size_t n) noexcept {
+    const Tables& t = tables();
+    while (n-- > 0) {
+        crc = t.bytes[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(MSGQ_CRC_TARGET)
+
+#if defined(MSGQ_CRC32C_X86)
+MSGQ_CRC_TARGET inline uint64_t crc_word(uint64_t crc, uint64_t word) noexcept {
+    return _mm_crc32_u64(crc, word);
+}
+MSGQ_CRC_TARGET inline uint64_t crc_byte(uint64_t crc, unsigned char byte) noexcept {
+    return _mm_crc32_u8(static_cast<uint32_t>(crc), byte);
+}
+#else
+MSGQ_CRC_TARGET inline uint64_t crc_word(uint64_t crc, uint64_t word) noexcept {
+    return __crc32cd(static_cast<uint32_t>(crc), word);
+}
+MSGQ_CRC_TARGET inline uint64_t crc_byte(uint64_t crc, unsigned char byte) noexcept {
+    return __crc32cb(static_cast<uint32_t>(crc), byte);
+}
+#endif
+
+inline uint64_t load_word(const unsigned char* p) noexcept {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+inline uint64_t shift_crc(const uint32_t (&shift)[4][256], uint64_t crc) noexcept {
+    return shift[0][crc & 0xff] ^ shift[1][(crc >> 8) & 0xff] ^
+           shift[2][(crc >> 16) & 0xff] ^ shift[3][(crc >> 24) & 0xff];
+}
+
+// Three lanes of `lane` bytes at a time, each with its own CRC so the
+// instructions overlap; the lane CRCs are then folded into the first by
+// shifting it over the following lane's length
+MSGQ_CRC_TARGET uint64_t crc_lanes(uint64_t crc0, const unsigned char*& p, size_t& n, size_t lane,
+                                   const uint32_t (&shift)[4][256]) noexcept {
+    while (n >= 3 * lane) {
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        const unsigned char* end = p + lane;
+        do {
+            crc0 = crc_word(crc0, load_word(p));
+            crc1 = crc_word(crc1, load_word(p + lane));
+            crc2 = crc_word(crc2, load_word(p + 2 * lane));
+            p += 8;
+        } while (p < end);
+        crc0 = shift_crc(shift, crc0) ^ crc1;
+        crc0 = shift_crc(shift, crc0) ^ crc2;
+        p += 2 * lane;
+        n -= 3 * lane;
+    }
+    return crc0;
+}
+
+MSGQ_CRC_TARGET uint32_t crc32c_hardware_kernel(uint32_t crc, const unsigned char* p, size_t n) noexcept {
+    const Tables& t = tables();
+    uint64_t crc0 = crc;
+
+    while (n > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+        crc0 = crc_byte(crc0, *p++);
+        n--;
+    }
+    crc0 = crc_lanes(crc0, p, n, LONG_LANE, t.long_shift);
+    crc0 = crc_lanes(crc0, p, n, SHORT_LANE, t.short_shift);
+    for (; n >= 8; n -= 8, p += 8) {
+        crc0 = crc_word(crc0, load_word(p));
+    }
+    while (n-- > 0) {
+        crc0 = crc_byte(crc0, *p++);
+    }
+    return static_cast<uint32_t>(crc0);
+}
+
+#endif // MSGQ_CRC_TARGET
+
+using Kernel = uint32_t (*)(uint32_t, const unsigned char*, size_t) noexcept;
+
+Kernel select_kernel() noexcept {
+#if defined(MSGQ_CRC32C_X86)
+    if (__builtin_cpu_supports("sse4.2")) {
+        return crc32c_hardware_kernel;
+    }
+#elif defined(MSGQ_CRC32C_ARM)
+    if (::getauxval(AT_HWCAP) & HWCAP_CRC32) {
+        return crc32c_hardware_kernel;
+    }
+#endif
+    return crc32c_software;
+}
+
+// Picked on first use, so callers from other static initializers are safe
+Kernel kernel() noexcept {
+    static const Kernel selected = select_kernel();
+    return selected;
+}
+
+} // namespace
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc) noexcept {
+    return ~kernel()(~crc, static_cast<const unsigned char*>(data), size);
+}
+
+bool crc32c_hardware() noexcept {
+    return kernel() != crc32c_software;
+}
+
+} // namespace msgq
@@ -0,0 +1,28 @@
+#pragma once
+
+/*
+ * CRC-32C (Castagnoli) for record integrity checks
+ *
+ * Uses the CRC32 instructions of SSE4.2 (x86-64) or ARMv8 when the CPU has
+ * them, picked once at runtime, with a table-driven fallback elsewhere.
+ * The hardware kernel runs three independent CRC lanes over adjacent blocks
+ * to hide the instruction's latency and folds them together with
+ * precomputed shift tables, so long buffers go at close to one 8-byte word
+ * per cycle.
+ *
+ * Self-contained (no msgq_modern.h / msgq.h) like memfd_segment_modern.h.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace msgq {
+
+// CRC-32C of `size` bytes at `data`, continuing from `crc` (0 to start):
+// crc32c(b, m, crc32c(a, n)) == crc32c of the n + m bytes a..b
+[[nodiscard]] uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0) noexcept;
+
+// True if crc32c() runs on CRC instructions rather than the table fallback
+[[nodiscard]] bool crc32c_hardware() noexcept;
+
+} // namespace msgq
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// @file default_init_allocator_modern.h
+/// @brief 默认初始化分配器与消息字节缓冲区类型
+/// @details 独立头文件（不依赖 ipc.h / msgq.h），msgq::Message 与 MSGQMessage 共用。
+///          std::vector::resize 对新元素做值初始化，char 会被清零；消息缓冲区随后
+///          总会被 memcpy 或解码器整体覆盖，多 MB 的消息因此白白多走一遍 memset。
+///          此适配器把无参 construct 改为默认初始化，resize 只分配不写内存。
+
+namespace msgq {
+
+/// @brief 分配器适配器：无参 construct 做默认初始化（平凡类型即不初始化）
+/// @tparam Alloc 被包装的分配器，其余行为（含 pmr 的资源传播规则）保持不变
+template <typename Alloc>
+class DefaultInitAllocator : public Alloc {
+  using traits = std::allocator_traits<Alloc>;
+
+public:
+  template <typename U>
+  struct rebind {
+    using other = DefaultInitAllocator<typename traits::template rebind_alloc<U>>;
+  };
+
+  using Alloc::Alloc;
+
+  DefaultInitAllocator() = default;
+
+  /// @brief 从被包装的分配器构造（例如 polymorphic_allocator 隐式来自 memory_resource*）
+  DefaultInitAllocator(const Alloc& alloc) noexcept : Alloc(alloc) {}
+
+  template <typename Other>
+  DefaultInitAllocator(const DefaultInitAllocator<Other>& other) noexcept
+      : Alloc(static_cast<const Other&>(other)) {}
+
+  /// @brief 无参构造：默认初始化
+  template <typename U>
+  void construct(U* ptr) noexcept(std::is_nothrow_default_constructible_v<U>) {
+    ::new (static_cast<void*>(ptr)) U;
+  }
+
+  /// @brief 带参构造：交给被包装的分配器
+  template <typename U, typename... Args>
+  void construct(U* ptr, Args&&... args) {
+    traits::construct(static_cast<Alloc&>(*this), ptr, std::forward<Args>(args)...);
+  }
+
+  /// @brief 容器拷贝构造时的分配器（pmr 下为默认资源）
+  DefaultInitAllocator select_on_container_copy_construction() const {
+    return DefaultInitAllocator(traits::select_on_container_copy_construction(*this));
+  }
+};
+
+template <typename A, typename B>
+bool operator==(const DefaultInitAllocator<A>& a, const DefaultInitAllocator<B>& b) noexcept {
+  return static_cast<const A&>(a) == static_cast<const B&>(b);
+}
+
+template <typename A, typename B>
+bool operator!=(const DefaultInitAllocator<A>& a, const DefaultInitAllocator<B>& b) noexcept {
+  return !(a == b);
+}
+
+/// @brief 消息字节缓冲区：按 memory_resource 分配，resize 不清零
+using ByteBuffer = std::vector<char, DefaultInitAllocator<std::pmr::polymorphic_allocator<char>>>;
+
+/// @brief 从 `resource` 分配缓冲区并 memcpy 填入 `size` 字节
+/// @details 分配器不是 std::allocator 时，vector 的区间构造、拷贝构造和 assign 逐字节调用
+///          construct，1 MB 要慢一个数量级以上；消息字节一律经此函数或 assign_bytes 拷贝。
+inline ByteBuffer copy_bytes(const char* data, std::size_t size, std::pmr::memory_resource* resource) {
+  ByteBuffer buffer(size, resource);
+  if (size > 0) {
+    std::memcpy(buffer.data(), data, size);
+  }
+  return buffer;
+}
+
+/// @brief 用 `size` 字节替换缓冲区内容，保留其 memory_resource；`data` 不能指向缓冲区自身
+inline void assign_bytes(ByteBuffer& buffer, const char* data, std::size_t size) {
+  buffer.clear();  // 扩容时不必逐字节搬运旧内容
+  buffer.resize(size);
+  if (size > 0) {
+    std::memcpy(buffer.data(), data, size);
+  }
+}
+
+}  // namespace msgq
@@ -17,6 +17,8 @@
 #include <signal.h>
 #include <filesystem>
 
+#include "clock_modern.h"
+
 #define CEREAL_EVENTS_PREFIX std::string("cereal_events")
 
 namespace msgq::event {
@@ -198,6 +200,21 @@ struct EventState {
     EventState() : fds{-1, -1}, enabled(false) {}
 };
 
+// 等待 fds 直到有事件或 timeout_sec 秒过去；超时按 clock::now() 计，
+// 虚拟时钟下分片阻塞并在片间检查截止时间。返回值同 ppoll
+inline int ppoll_for(struct pollfd* fds, nfds_t count, int timeout_sec, const sigset_t* signals) {
+    const auto deadline = timeout_sec < 0 ? clock::Clock::time_point::max()
+                                          : clock::now() + std::chrono::seconds(timeout_sec);
+    for (;;) {
+        const int slice_ms = clock::wait_slice_ms(deadline);
+        struct timespec timeout = {slice_ms / 1000, (slice_ms % 1000) * 1000000L};
+        int event_count = ::ppoll(fds, count, slice_ms < 0 ? nullptr : &timeout, signals);
+        if (event_count != 0 || clock::now() >= deadline) {
+            return event_count;
+        }
+    }
+}
+
 // ============================================================================
 // 事件类（RAII 包装）
 // ============================================================================
@@ -257,7 +274,6 @@ public:
         validate();
 
         struct pollfd fds = {event_fd_, POLLIN, 0};
-        struct timespec timeout = {timeout_sec, 0};
 
         sigset_t signals;
         ::sigfillset(&signals);
@@ -266,7 +282,7 @@ public:
         ::sigdelset(&signals, SIGTERM);
         ::sigdelset(&signals, SIGQUIT);
 
-        int event_count = ::ppoll(&fds, 1, timeout_sec < 0 ? nullptr : &timeout, &signals);
+        int event_count = ppoll_for(&fds, 1, timeout_sec, &signals);
 
         if (event_count == 0) {
             throw std::runtime_error("Event timed out (pid: " + std::to_string(::getpid()) + ")");
@@ -292,37 +308,64 @@ public:
         return event_fd_;
     }
 
-    // 等待多个事件中的任意一个
-    static int wait_for_one(const std::vector<Event>& events, int timeout_sec = -1) {
-        if (events.empty()) {
-            throw std::invalid_argument("No events to wait for");
-        }
+    // 等待多个事件中的任意一个（每次调用都重建 pollfd 数组；
+    // 反复等待同一组事件请用 EventSet）
+    static int wait_for_one(const std::vector<Event>& events, int timeout_sec = -1);
+};
 
-        // 使用标准容器而非 VLA
-        std::vector<struct pollfd> fds;
-        fds.reserve(events.size());
-        
-        for (const auto& event : events) {
-            if (event.is_valid()) {
-                fds.push_back({event.fd(), POLLIN, 0});
-            }
-        }
+// ============================================================================
+// 预构建的事件集合
+// ============================================================================
 
-        if (fds.empty()) {
-            throw std::runtime_error("All events are invalid");
+// pollfd 数组与 ppoll 信号掩码在构建时准备一次，wait() 不做任何分配，
+// 适合每个仿真步都等待同一组事件的锁步循环。
+// 集合只记录 fd，不持有事件；事件须比集合活得久。
+class EventSet {
+private:
+    std::vector<struct pollfd> fds_;
+    sigset_t signals_;
+
+public:
+    EventSet() {
+        ::sigfillset(&signals_);
+        ::sigdelset(&signals_, SIGALRM);
+        ::sigdelset(&signals_, SIGINT);
+        ::sigdelset(&signals_, SIGTERM);
+        ::sigdelset(&signals_, SIGQUIT);
+    }
+
+    // 加入一个事件 fd，返回它在集合中的下标
+    size_t add(int fd) {
+        if (fd < 0) {
+            throw std::invalid_argument("Event does not have valid file descriptor");
         }
+        fds_.push_back({fd, POLLIN, 0});
+        return fds_.size() - 1;
+    }
 
-        struct timespec timeout = {timeout_sec, 0};
+    size_t add(const Event& event) {
+        return add(event.fd());
+    }
 
-        sigset_t signals;
-        ::sigfillset(&signals);
-        ::sigdelset(&signals, SIGALRM);
-        ::sigdelset(&signals, SIGINT);
-        ::sigdelset(&signals, SIGTERM);
-        ::sigdelset(&signals, SIGQUIT);
+    void clear() noexcept {
+        fds_.clear();
+    }
 
-        int event_count = ::ppoll(fds.data(), fds.size(), 
-                                 timeout_sec < 0 ? nullptr : &timeout, &signals);
+    [[nodiscard]] size_t size() const noexcept {
+        return fds_.size();
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return fds_.empty();
+    }
+
+    // 等待任意一个事件就绪，返回其下标（多个就绪时取最小者）
+    int wait(int timeout_sec = -1) {
+        if (fds_.empty()) {
+            throw std::invalid_argument("No events to wait for");
+        }
+
+        int event_count = ppoll_for(fds_.data(), fds_.size(), timeout_sec, &signals_);
 
         if (event_count == 0) {
             throw std::runtime_error("Event poll timed out (pid: " + std::to_string(::getpid()) + ")");
@@ -331,8 +374,8 @@ public:
                                    " (pid: " + std::to_string(::getpid()) + ")");
         }
 
-        for (size_t i = 0; i < fds.size(); i++) {
-            if (fds[i].revents & POLLIN) {
+        for (size_t i = 0; i < fds_.size(); i++) {
+            if (fds_[i].revents & POLLIN) {
                 return static_cast<int>(i);
             }
         }
@@ -341,6 +384,24 @@ public:
     }
 };
 
+inline int Event::wait_for_one(const std::vector<Event>& events, int timeout_sec) {
+    if (events.empty()) {
+        throw std::invalid_argument("No events to wait for");
+    }
+
+    EventSet set;
+    for (const auto& event : events) {
+        if (event.is_valid()) {
+            set.add(event);
+        }
+    }
+
+    if (set.empty()) {
+        throw std::runtime_error("All events are invalid");
+    }
+    return set.wait(timeout_sec);
+}
+
 // ============================================================================
 // 事件句柄类（管理共享内存中的事件对）
 // ============================================================================
@@ -109,6 +109,8 @@ int FakeSubSocket<TSubSocket>::connect(
 
 #include "msgq/impl_msgq.h"
 #include "msgq/impl_zmq.h"
+#include "msgq/impl_unix_modern.h"
+#include "msgq/impl_multicast_modern.h"
 
 // 显式实例化：FakeSubSocket 包装 MSGQSubSocket
 template class FakeSubSocket<MSGQSubSocket>;
@@ -118,3 +120,21 @@ template class FakeSubSocket<MSGQSubSocket>;
 template class FakeSubSocket<ZMQSubSocket>;
 #endif
 
+// 显式实例化：FakeSubSocket 包装 UnixSubSocket（MSGQ_UNIX）
+template class FakeSubSocket<UnixSubSocket>;
+
+// 显式实例化：FakeSubSocket 包装 MulticastSubSocket（MSGQ_MULTICAST）
+template class FakeSubSocket<MulticastSubSocket>;
+
+namespace msgq::detail {
+
+std::unique_ptr<SubSocket> create_fake_unix_subsocket() {
+  return std::make_unique<FakeSubSocket<UnixSubSocket>>();
+}
+
+std::unique_ptr<SubSocket> create_fake_multicast_subsocket() {
+  return std::make_unique<FakeSubSocket<MulticastSubSocket>>();
+}
+
+} // namespace msgq::detail
+
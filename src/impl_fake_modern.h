@@ -14,11 +14,13 @@
 
 #include "msgq/ipc.h"
 #include "msgq/event.h"
+#include "msgq/clock_modern.h"
 
 /// @file impl_fake_modern.h
 /// @brief Fake/test 后端的现代 C++17 实现
 /// @details 用于单元和集成测试，提供：
 ///   - 事件同步机制
+///   - 虚拟时钟下的确定性超时（见 clock_modern.h）
 ///   - 完全的内存安全（智能指针）
 ///   - 异常安全保证
 ///   - const 正确的 API
@@ -92,6 +94,9 @@ private:
   /// @brief 事件状态指针（可变）
   mutable std::shared_ptr<EventState> state;
 
+  /// @brief 接收超时（毫秒），-1=无限等待；按 msgq::clock::now() 计时
+  int timeout_ms = -1;
+
 public:
   /// @brief 默认构造函数
   FakeSubSocket() : TSubSocket() {}
@@ -113,6 +118,13 @@ public:
               const std::string& address = "127.0.0.1",
               bool conflate = false, bool check_endpoint = true) override;
 
+  /// @brief 设置接收超时时间
+  /// @param timeout 超时毫秒数，-1 表示无限等待；虚拟时钟下按虚拟时间计
+  void setTimeout(int timeout) override {
+    timeout_ms = timeout;
+    TSubSocket::setTimeout(timeout);
+  }
+
   /// @brief 接收消息（带事件同步）
   /// @param non_blocking 非阻塞模式
   /// @return 接收到的消息，nullptr 表示无消息
@@ -121,7 +133,9 @@ public:
   ///   2. 等待 recv_ready 事件
   ///   3. 清除 recv_ready 事件
   ///   4. 然后调用底层 receive()
-  Message* receive(bool non_blocking = false) override {
+  ///   有虚拟时钟时，底层按 VIRTUAL_WAIT_SLICE 分片等待，
+  ///   直到收到消息或虚拟时间越过超时
+  std::unique_ptr<Message> receive(bool non_blocking = false) override {
     if (state && state->enabled) {
       if (recv_called) {
         recv_called->set();
@@ -132,7 +146,27 @@ public:
       }
     }
 
-    return TSubSocket::receive(non_blocking);
+    if (non_blocking || timeout_ms < 0 || !msgq::clock::is_virtual()) {
+      return TSubSocket::receive(non_blocking);
+    }
+
+    const auto deadline = msgq::clock::deadline_after(timeout_ms);
+    std::unique_ptr<Message> message;
+    try {
+      for (;;) {
+        const int slice_ms = msgq::clock::wait_slice_ms(deadline);
+        TSubSocket::setTimeout(slice_ms);
+        message = TSubSocket::receive(slice_ms == 0);
+        if (message || slice_ms == 0) {
+          break;
+        }
+      }
+    } catch (...) {
+      TSubSocket::setTimeout(timeout_ms);
+      throw;
+    }
+    TSubSocket::setTimeout(timeout_ms);
+    return message;
   }
 };
 
@@ -143,6 +177,8 @@ private:
   std::vector<SubSocket*> sockets;
 
 public:
+  using Poller::registerSocket;
+
   /// @brief 注册套接字以供轮询
   /// @param socket 子套接字指针（非空）
   /// @throws std::invalid_argument 如果 socket 为空
@@ -156,9 +192,12 @@ public:
   /// @brief 对已注册的套接字进行轮询
   /// @param timeout 超时毫秒数
   /// @return 准备好的套接字列表
-  /// @details Fake 轮询器直接返回所有已注册的套接字
-  std::vector<SubSocket*> poll(int timeout) const override {
-    return sockets;
+  /// @details Fake 轮询器把所有已注册的套接字视为就绪，按调度规则排序后返回
+  ///          （从不阻塞，因此与虚拟时钟无关）
+  std::vector<SubSocket*> poll(int timeout) override {
+    std::vector<SubSocket*> ready = sockets;
+    orderReady(ready);
+    return ready;
   }
 
   /// @brief 虚析构函数
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <cstring>
 #include <iostream>
 #include <cstdlib>
@@ -7,8 +9,241 @@
 #include <vector>
 #include <stdexcept>
 #include <memory>
+#include <chrono>
+#include <thread>
+#include <csignal>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "msgq/impl_msgq_modern.h"
+#include "msgq/clock_modern.h"
+
+// ============================================================================
+// memfd 段辅助函数
+// ============================================================================
+
+namespace {
+
+/// @brief 以 memfd 模式打开队列，替代 msgq_new_queue
+/// @details 通过 unix 套接字取得（或创建并提供）密封的 memfd 段，
+///          再按 msgq_new_queue 相同的布局映射到 q。/dev/shm 下不留文件。
+/// @param q 待初始化的队列
+/// @param endpoint 端点名称
+/// @param size 数据区大小
+/// @param segment 输出：段对象，必须与队列同生命周期
+/// @return 0 成功，-1 失败
+int msgq_new_queue_memfd(msgq_queue_t* q, const std::string& endpoint, size_t size,
+                         std::unique_ptr<msgq::MemfdSegment>& segment) {
+  const size_t total_size = size + sizeof(msgq_header_t);
+  segment = msgq::MemfdSegment::open(endpoint, total_size);
+
+  char* mem = static_cast<char*>(mmap(nullptr, total_size, PROT_READ | PROT_WRITE,
+                                      MAP_SHARED, segment->fd(), 0));
+  if (mem == MAP_FAILED) {
+    segment.reset();
+    return -1;
+  }
+  q->mmap_p = mem;
+
+  // 与 msgq_new_queue 保持一致的头部指针布局
+  msgq_header_t* header = reinterpret_cast<msgq_header_t*>(mem);
+  q->num_readers = reinterpret_cast<std::atomic<uint64_t>*>(&header->num_readers);
+  q->write_pointer = reinterpret_cast<std::atomic<uint64_t>*>(&header->write_pointer);
+  q->write_uid = reinterpret_cast<std::atomic<uint64_t>*>(&header->write_uid);
+
+  for (size_t i = 0; i < NUM_READERS; i++) {
+    q->read_pointers[i] = reinterpret_cast<std::atomic<uint64_t>*>(&header->read_pointers[i]);
+    q->read_valids[i] = reinterpret_cast<std::atomic<uint64_t>*>(&header->read_valids[i]);
+    q->read_uids[i] = reinterpret_cast<std::atomic<uint64_t>*>(&header->read_uids[i]);
+  }
+
+  q->data = mem + sizeof(msgq_header_t);
+  q->size = size;
+  q->reader_id = -1;
+  q->endpoint = endpoint;
+  q->read_conflate = false;
+  return 0;
+}
+
+/// @brief 按 MSGQ_MEMFD 选择段类型打开队列
+int open_queue(msgq_queue_t* q, const std::string& endpoint,
+               std::unique_ptr<msgq::MemfdSegment>& segment) {
+  if (msgq::messaging_use_memfd()) {
+    return msgq_new_queue_memfd(q, endpoint, DEFAULT_SEGMENT_SIZE, segment);
+  }
+  return msgq_new_queue(q, endpoint.c_str(), DEFAULT_SEGMENT_SIZE);
+}
+
+/// @brief 通知读者线程有新消息，与 msgq 的 thread_signal 相同
+void msgq_signal_reader(uint64_t read_uid) {
+  syscall(SYS_tkill, static_cast<pid_t>(read_uid & 0xFFFFFFFF), SIGUSR2);
+}
+
+/// @brief msgq_msg_send 的分散-聚集版本：各片段依次直接写入环
+/// @details 回绕标记、读者失效与通知的逻辑与 msgq_msg_send 一致，
+///          只是负载按片段逐段复制，省掉聚集缓冲区的一次整体复制。
+/// @param q 已初始化为发布者的队列
+/// @param parts 片段列表
+/// @return 发送的字节数，-1 表示已不再是当前发布者（errno = EADDRINUSE）
+int msgq_msgv_send(msgq_queue_t* q, msgq::span<const msgq::span<const char>> parts) {
+  if (q->write_uid_local != *q->write_uid) {
+    errno = EADDRINUSE;
+    return -1;
+  }
+
+  size_t size = 0;
+  for (const auto& part : parts) {
+    size += part.size();
+  }
+  const uint64_t total_msg_size = ALIGN(size + sizeof(int64_t));
+  // 与 msgq_msg_send 相同：环里至少放得下三条消息
+  assert(3 * total_msg_size <= q->size);
+
+  const uint64_t num_readers = *q->num_readers;
+  uint32_t write_cycles = static_cast<uint32_t>(*q->write_pointer >> 32);
+  uint32_t write_pointer = static_cast<uint32_t>(*q->write_pointer);
+  char* p = q->data + write_pointer;
+
+  // 总要给下一条消息的回绕标记留出位置
+  const int64_t remaining_space = static_cast<int64_t>(q->size) - write_pointer - total_msg_size - sizeof(int64_t);
+  if (remaining_space <= 0) {
+    *reinterpret_cast<int64_t*>(p) = -1;
+    for (uint64_t i = 0; i < num_readers; i++) {
+      const uint64_t read = *q->read_pointers[i];
+      if (static_cast<uint32_t>(read) > write_pointer && static_cast<uint32_t>(read >> 32) != write_cycles) {
+        *q->read_valids[i] = false;
+      }
+    }
+    write_pointer = 0;
+    write_cycles++;
+    *q->write_pointer = static_cast<uint64_t>(write_cycles) << 32;
+    p = q->data;
+  }
+
+  // 即将覆盖的区域内的读者失效
+  const uint64_t end = ALIGN(write_pointer + sizeof(int64_t) + size);
+  for (uint64_t i = 0; i < num_readers; i++) {
+    const uint64_t read = *q->read_pointers[i];
+    const uint32_t read_pointer = static_cast<uint32_t>(read);
+    if (read_pointer >= write_pointer && read_pointer < end && static_cast<uint32_t>(read >> 32) != write_cycles) {
+      *q->read_valids[i] = false;
+    }
+  }
+
+  reinterpret_cast<std::atomic<int64_t>*>(p)->store(static_cast<int64_t>(size));
+  char* dst = p + sizeof(int64_t);
+  for (const auto& part : parts) {
+    if (part.size() > 0) {
+      std::memcpy(dst, part.data(), part.size());
+      dst += part.size();
+    }
+  }
+  __sync_synchronize();
+
+  *q->write_pointer = (static_cast<uint64_t>(write_cycles) << 32) | static_cast<uint32_t>(end);
+
+  for (uint64_t i = 0; i < num_readers; i++) {
+    msgq_signal_reader(*q->read_uids[i]);
+  }
+  return static_cast<int>(size);
+}
+
+/// @brief 跳过读指针处的一条消息，只读取 8 字节的大小头，不复制负载
+/// @details 与 msgq_msg_recv 的读指针推进逻辑一致（包括回绕标记 -1）。
+///          读者被驱逐或失效时不做处理，留给随后的 msgq_msg_recv 重置。
+/// @param q 已初始化为订阅者的队列
+/// @param keep_newest 为 true 时不跳过最新一条（用于“最新者胜出”）
+/// @param skipped_size 输出：跳过的消息的负载字节数
+/// @return true 跳过了一条消息，false 队列已空或需要交给 msgq_msg_recv
+bool msgq_skip_msg(msgq_queue_t* q, bool keep_newest, size_t& skipped_size) {
+  const int id = q->reader_id;
+  for (;;) {
+    if (q->read_uid_local != *q->read_uids[id] || !*q->read_valids[id]) {
+      return false;
+    }
+
+    const uint64_t read = *q->read_pointers[id];
+    const uint32_t read_cycles = static_cast<uint32_t>(read >> 32);
+    const uint32_t read_pointer = static_cast<uint32_t>(read);
+    const uint32_t write_pointer = static_cast<uint32_t>(*q->write_pointer);
+    if (read_pointer == write_pointer) {
+      return false;
+    }
+
+    int64_t size;
+    std::memcpy(&size, q->data + read_pointer, sizeof(size));
+    if (!*q->read_valids[id]) {
+      return false;
+    }
+
+    if (size == -1) {
+      *q->read_pointers[id] = static_cast<uint64_t>(read_cycles + 1) << 32;
+      continue;
+    }
+
+    const uint64_t next = (read_pointer + sizeof(int64_t) + size + 7) & ~uint64_t{7};
+    if (keep_newest && next == write_pointer) {
+      return false;
+    }
+    *q->read_pointers[id] = (static_cast<uint64_t>(read_cycles) << 32) | next;
+    skipped_size = static_cast<size_t>(size);
+    return true;
+  }
+}
+
+/// @brief 统计环中 [from, to) 之间的消息数和负载字节数，只读大小头
+/// @param q 已初始化为订阅者的队列
+/// @param from 起始偏移（帧或回绕标记的开头）
+/// @param to 结束偏移（写指针）
+/// @param info 累加：消息数与负载字节数
+/// @return true 走到了 to，false 读到不一致的大小头（与写者竞争）
+bool msgq_count_frames(const msgq_queue_t* q, uint32_t from, uint32_t to, PendingInfo& info) {
+  // 最多走一圈，防止与写者竞争时读到的大小头不一致导致死循环
+  for (size_t walked = 0; from != to;) {
+    if (walked > q->size) {
+      return false;
+    }
+    int64_t size;
+    std::memcpy(&size, q->data + from, sizeof(size));
+    if (size == -1) {
+      walked += q->size - from;
+      from = 0;
+      continue;
+    }
+    if (size < 0 || static_cast<uint64_t>(size) > q->size) {
+      return false;
+    }
+    const uint32_t next = static_cast<uint32_t>((from + sizeof(int64_t) + size + 7) & ~uint64_t{7});
+    walked += next - from;
+    from = next;
+    info.messages++;
+    info.bytes += static_cast<size_t>(size);
+  }
+  return true;
+}
+
+/// @brief 读者是否已被写者覆盖或驱逐，下一次 msgq_msg_recv 会重置读指针
+/// @param q 已初始化为订阅者的队列
+bool msgq_reader_lost(const msgq_queue_t* q) {
+  const int id = q->reader_id;
+  return id >= 0 && (q->read_uid_local != *q->read_uids[id] || !*q->read_valids[id]);
+}
+
+/// @brief msgq_poll 的超时：到截止时间的剩余毫秒数（向上取整）
+/// @param deadline 截止时间，time_point::max() 表示无限等待（每 100ms 醒来一次）
+/// @return 毫秒数
+int poll_timeout_until(std::chrono::steady_clock::time_point deadline) {
+  if (deadline == std::chrono::steady_clock::time_point::max()) {
+    return 100;
+  }
+  const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+      deadline - std::chrono::steady_clock::now()).count();
+  return static_cast<int>(std::clamp<int64_t>(remaining, 0, INT32_MAX));
+}
+
+}  // namespace
 
 // ============================================================================
 // MSGQMessage 实现
@@ -30,7 +265,7 @@ void MSGQMessage::init(char* src_data, size_t size) {
   try {
     data.clear();
     if (size > 0) {
-      data.assign(src_data, src_data + size);
+      msgq::assign_bytes(data, src_data, size);
     }
   } catch (const std::exception& e) {
     throw std::runtime_error(std::string("Failed to initialize message: ") + e.what());
@@ -46,7 +281,7 @@ void MSGQMessage::takeOwnership(char* src_data, size_t size) {
     data.clear();
     if (size > 0) {
       // 首先复制数据
-      data.assign(src_data, src_data + size);
+      msgq::assign_bytes(data, src_data, size);
       // 然后释放源指针
       delete[] src_data;
     }
@@ -72,10 +307,11 @@ void MSGQSubSocket::cleanup() {
   if (q) {
     msgq_close_queue(q.get());
   }
+  segment.reset();
 }
 
-int MSGQSubSocket::connect(Context* context, std::string endpoint,
-                           std::string address, bool conflate,
+int MSGQSubSocket::connect(Context* context, const std::string& endpoint,
+                           const std::string& address, bool conflate,
                            bool check_endpoint) {
   // 参数验证
   if (!context) {
@@ -94,8 +330,8 @@ int MSGQSubSocket::connect(Context* context, std::string endpoint,
     // 创建队列对象
     q = std::make_unique<msgq_queue_t>();
 
-    // 初始化队列
-    int r = msgq_new_queue(q.get(), endpoint.c_str(), DEFAULT_SEGMENT_SIZE);
+    // 初始化队列（/dev/shm 文件或 memfd 段）
+    int r = open_queue(q.get(), endpoint, segment);
     if (r != 0) {
       q.reset();
       throw std::runtime_error("Failed to create MSGQ queue '" + endpoint + "': " +
@@ -115,6 +351,11 @@ int MSGQSubSocket::connect(Context* context, std::string endpoint,
       q->read_conflate = true;
     }
 
+    // 连接前写入的消息不计入新鲜度
+    overruns = 0;
+    observed_write = *q->write_pointer;
+    observed_write_at = std::chrono::steady_clock::time_point();
+
     timeout = -1;
     return 0;
 
@@ -124,41 +365,202 @@ int MSGQSubSocket::connect(Context* context, std::string endpoint,
   }
 }
 
+bool MSGQSubSocket::setMemoryResource(std::pmr::memory_resource* resource) {
+  this->resource = resource != nullptr ? resource : std::pmr::get_default_resource();
+  return true;
+}
+
+void MSGQSubSocket::setDecimation(uint32_t every_nth, double max_rate_hz) {
+  if (every_nth == 0 || max_rate_hz < 0.0) {
+    throw std::invalid_argument("Invalid decimation settings");
+  }
+
+  this->every_nth = every_nth;
+  skip_remaining = 0;
+  min_interval = std::chrono::steady_clock::duration::zero();
+  if (max_rate_hz > 0.0) {
+    min_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / max_rate_hz));
+  }
+  next_delivery = std::chrono::steady_clock::time_point();
+}
+
+bool MSGQSubSocket::getPending(PendingInfo& info) const {
+  if (!q) {
+    info = PendingInfo{};
+    return false;
+  }
+  count_pending(info);
+  return true;
+}
+
+void MSGQSubSocket::count_pending(PendingInfo& info) const {
+  info = PendingInfo{};
+  const int id = q->reader_id;
+  if (id < 0 || msgq_reader_lost(q.get())) {
+    pending_read = UINT64_MAX;
+    return;
+  }
+
+  // 读指针从上次统计后被别处移动过（合并、重置）：从读指针重新统计
+  const uint64_t read = *q->read_pointers[id];
+  if (read != pending_read) {
+    pending = PendingInfo{};
+    pending_end = static_cast<uint32_t>(read);
+    pending_read = read;
+  }
+
+  // 只走上次统计之后写入的帧
+  const uint32_t write_pointer = static_cast<uint32_t>(*q->write_pointer);
+  if (!msgq_count_frames(q.get(), pending_end, write_pointer, pending) || msgq_reader_lost(q.get())) {
+    // 统计期间读者被写者覆盖，结果不可信
+    pending_read = UINT64_MAX;
+    return;
+  }
+  pending_end = write_pointer;
+  info = pending;
+}
+
+void MSGQSubSocket::consumed(uint64_t read_before, size_t size) {
+  if (pending_read != read_before || pending.messages == 0) {
+    return;
+  }
+  pending_read = *q->read_pointers[q->reader_id];
+  pending.messages--;
+  pending.bytes -= std::min(pending.bytes, size);
+}
+
+Freshness MSGQSubSocket::freshness() const {
+  Freshness result;
+  if (!q) {
+    return result;
+  }
+
+  observe_writer();
+  result.newest_timestamp = observed_write_at;
+
+  PendingInfo info;
+  count_pending(info);
+  result.backlog_messages = info.messages;
+  result.backlog_bytes = info.bytes;
+  // 尚未被 receive 处理的覆盖也计入
+  result.overruns = overruns + (msgq_reader_lost(q.get()) ? 1 : 0);
+  return result;
+}
+
+void MSGQSubSocket::observe_writer() const {
+  const uint64_t write = *q->write_pointer;
+  if (write != observed_write) {
+    observed_write = write;
+    observed_write_at = std::chrono::steady_clock::now();
+  }
+}
+
+int MSGQSubSocket::recv_msg(msgq_msg_t* msg) {
+  if (msgq_reader_lost(q.get())) {
+    overruns++;
+  }
+  const uint64_t read_before = *q->read_pointers[q->reader_id];
+  const int rc = msgq_msg_recv(msg, q.get());
+  // 合并模式一次可能越过多条，留给下次统计重新计数
+  if (rc > 0 && !q->read_conflate) {
+    consumed(read_before, static_cast<size_t>(rc));
+  }
+  return rc;
+}
+
+bool MSGQSubSocket::skip_msg(bool keep_newest) {
+  const uint64_t read_before = *q->read_pointers[q->reader_id];
+  size_t size = 0;
+  if (!msgq_skip_msg(q.get(), keep_newest, size)) {
+    return false;
+  }
+  consumed(read_before, size);
+  return true;
+}
+
+bool MSGQSubSocket::apply_decimation(bool non_blocking, std::chrono::steady_clock::time_point deadline) {
+  using clock = std::chrono::steady_clock;
+
+  if (every_nth <= 1 && min_interval == clock::duration::zero()) {
+    return true;
+  }
+
+  // 限速窗口未打开：阻塞模式下等到窗口打开或超时
+  if (min_interval != clock::duration::zero()) {
+    if (clock::now() < next_delivery) {
+      if (non_blocking) {
+        return false;
+      }
+      if (deadline < next_delivery) {
+        std::this_thread::sleep_until(deadline);
+        return false;
+      }
+      std::this_thread::sleep_until(next_delivery);
+    }
+    // 最新者胜出：跳到窗口内最新的一条
+    while (skip_msg(true)) {
+    }
+  }
+
+  // 抽取：跳过本轮剩余的消息，不足时等待发布者
+  while (skip_remaining > 0) {
+    if (skip_msg(false)) {
+      skip_remaining--;
+      continue;
+    }
+    if (non_blocking || clock::now() >= deadline) {
+      return false;
+    }
+
+    msgq_pollitem_t items[1] = {};
+    items[0].q = q.get();
+    msgq_poll(items, 1, poll_timeout_until(deadline));
+  }
+  return true;
+}
+
 std::unique_ptr<Message> MSGQSubSocket::receive(bool non_blocking) {
   if (!q) {
     throw std::runtime_error("Socket not connected");
   }
 
+  // 抽取等待与接收等待共用一个截止时间，整个调用不超过 timeout
+  const auto deadline = timeout == -1
+      ? std::chrono::steady_clock::time_point::max()
+      : std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+  if (!apply_decimation(non_blocking, deadline)) {
+    return nullptr;
+  }
+
   msgq_msg_t msg = {};
 
-  int rc = msgq_msg_recv(&msg, q.get());
+  int rc = recv_msg(&msg);
 
-  // 非阻塞模式下的重试逻辑
+  // 阻塞模式下等待发布者，直到收到消息或截止时间已过
   if (!non_blocking) {
     while (rc == 0) {
-      msgq_pollitem_t items[1] = {};
-      items[0].q = q.get();
-
-      int poll_timeout = (timeout != -1) ? timeout : 100;
-
-      int n = msgq_poll(items, 1, poll_timeout);
-      rc = msgq_msg_recv(&msg, q.get());
-
-      // 成功接收到数据
-      if (n > 0 && rc > 0) {
+      if (timeout != -1 && std::chrono::steady_clock::now() >= deadline) {
         break;
       }
 
-      // 超时或已设置超时
-      if (timeout != -1) {
-        break;
-      }
+      msgq_pollitem_t items[1] = {};
+      items[0].q = q.get();
+      msgq_poll(items, 1, poll_timeout_until(deadline));
+      rc = recv_msg(&msg);
     }
   }
 
   // 创建现代消息对象
   if (rc > 0) {
-    auto message = std::make_unique<MSGQMessage>();
+    observe_writer();
+    skip_remaining = every_nth - 1;
+    if (min_interval != std::chrono::steady_clock::duration::zero()) {
+      next_delivery = std::chrono::steady_clock::now() + min_interval;
+    }
+
+    auto message = std::make_unique<MSGQMessage>(resource);
     message->takeOwnership(msg.data, msg.size);
     return message;
   }
@@ -186,9 +588,10 @@ void MSGQPubSocket::cleanup() {
   if (q) {
     msgq_close_queue(q.get());
   }
+  segment.reset();
 }
 
-int MSGQPubSocket::connect(Context* context, std::string endpoint,
+int MSGQPubSocket::connect(Context* context, const std::string& endpoint,
                            bool check_endpoint) {
   // 参数验证
   if (!context) {
@@ -203,8 +606,8 @@ int MSGQPubSocket::connect(Context* context, std::string endpoint,
     // 创建队列对象
     q = std::make_unique<msgq_queue_t>();
 
-    // 初始化队列
-    int r = msgq_new_queue(q.get(), endpoint.c_str(), DEFAULT_SEGMENT_SIZE);
+    // 初始化队列（/dev/shm 文件或 memfd 段）
+    int r = open_queue(q.get(), endpoint, segment);
     if (r != 0) {
       q.reset();
       throw std::runtime_error("Failed to create MSGQ queue '" + endpoint + "': " +
@@ -269,6 +672,19 @@ int MSGQPubSocket::send(char* data, size_t size) {
   return result;
 }
 
+int MSGQPubSocket::sendv(msgq::span<const msgq::span<const char>> parts) {
+  if (!q) {
+    throw std::runtime_error("Socket not connected");
+  }
+
+  int result = msgq_msgv_send(q.get(), parts);
+  if (result < 0) {
+    throw std::runtime_error("Failed to send data: " + std::string(strerror(errno)));
+  }
+
+  return result;
+}
+
 bool MSGQPubSocket::all_readers_updated() const {
   if (!q) {
     return false;
@@ -314,8 +730,13 @@ std::vector<SubSocket*> MSGQPoller::poll(int timeout) {
     return ready;
   }
 
-  // 调用 C 风格的轮询函数
-  int rc = msgq_poll(polls.data(), polls.size(), timeout);
+  // 调用 C 风格的轮询函数；msgq_poll 按真实时间等待，虚拟时钟下
+  // 分片调用并在片间检查虚拟截止时间
+  const auto deadline = msgq::clock::deadline_after(timeout);
+  int rc;
+  do {
+    rc = msgq_poll(polls.data(), polls.size(), msgq::clock::wait_slice_ms(deadline));
+  } while (rc == 0 && msgq::clock::now() < deadline);
 
   if (rc < 0) {
     throw std::runtime_error("msgq_poll failed: " + std::string(strerror(errno)));
@@ -328,6 +749,7 @@ std::vector<SubSocket*> MSGQPoller::poll(int timeout) {
     }
   }
 
+  orderReady(ready);
   return ready;
 }
 
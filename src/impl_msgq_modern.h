@@ -1,12 +1,17 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <vector>
 #include <stdexcept>
 
 #include "msgq/ipc.h"
 #include "msgq/msgq.h"
+#include "msgq/memfd_segment_modern.h"
+#include "msgq/default_init_allocator_modern.h"
 
 /// @file impl_msgq_modern.h
 /// @brief MSGQ 后端的现代 C++17 实现
@@ -34,10 +39,15 @@ public:
 /// @brief MSGQ 消息实现（使用现代 C++ vector 管理内存）
 class MSGQMessage : public Message {
 private:
-  std::vector<char> data;  ///< 消息数据，RAII 自动管理
+  msgq::ByteBuffer data;  ///< 消息数据，从构造时给定的内存资源分配，扩容不清零
 
 public:
-  /// @brief 初始化指定大小的消息缓冲区
+  /// @brief 构造空消息
+  /// @param resource 缓冲区使用的内存资源，必须比消息活得更久
+  explicit MSGQMessage(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    : data(resource) {}
+
+  /// @brief 初始化指定大小的消息缓冲区（内容未初始化）
   /// @param size 消息大小（字节）
   /// @throws std::bad_alloc 如果内存分配失败
   void init(size_t size) override;
@@ -79,11 +89,53 @@ public:
 class MSGQSubSocket : public SubSocket {
 private:
   std::unique_ptr<msgq_queue_t> q;  ///< MSGQ 队列对象，unique_ptr 自动管理
+  std::unique_ptr<msgq::MemfdSegment> segment;  ///< memfd 模式下的段（MSGQ_MEMFD）
   int timeout = -1;                 ///< 接收超时（毫秒）-1=无限等待
+  std::pmr::memory_resource* resource = std::pmr::get_default_resource();  ///< 接收消息的内存资源
+
+  uint32_t every_nth = 1;           ///< 抽取：每 N 条投递一条
+  uint32_t skip_remaining = 0;      ///< 下一次投递前还需跳过的消息数
+  std::chrono::steady_clock::duration min_interval{0};  ///< 限速：两次投递的最小间隔
+  std::chrono::steady_clock::time_point next_delivery;  ///< 限速窗口打开的时刻
+
+  mutable uint64_t pending_read = UINT64_MAX;  ///< pending 统计时的读指针（UINT64_MAX 表示需重新统计）
+  mutable uint32_t pending_end = 0;            ///< pending 已统计到的环内偏移
+  mutable PendingInfo pending;                 ///< 读指针到 pending_end 之间的消息
+
+  uint64_t overruns = 0;                                    ///< 被写者覆盖的次数
+  mutable uint64_t observed_write = 0;                      ///< 最近一次观察到的写指针
+  mutable std::chrono::steady_clock::time_point observed_write_at;  ///< 观察到写指针变化的时刻
 
   /// @brief 安全清理队列资源
   void cleanup();
 
+  /// @brief msgq_msg_recv 的包装，读者被覆盖时计数
+  /// @param msg 输出消息
+  /// @return 同 msgq_msg_recv
+  int recv_msg(msgq_msg_t* msg);
+
+  /// @brief msgq_skip_msg 的包装，同步 pending 统计
+  /// @param keep_newest 为 true 时不跳过最新一条
+  /// @return true 跳过了一条消息
+  bool skip_msg(bool keep_newest);
+
+  /// @brief 统计待读消息：读指针未被别处移动时只走新写入的帧，
+  ///        每个大小头只读一次，没有新消息时为 O(1)
+  /// @param info 输出：待读消息数与负载字节数
+  void count_pending(PendingInfo& info) const;
+
+  /// @brief 读指针从 read_before 越过了一条 size 字节的消息，从 pending 中扣除
+  void consumed(uint64_t read_before, size_t size);
+
+  /// @brief 写指针变化时记下观察时刻（MSGQ 帧没有发送时间戳）
+  void observe_writer() const;
+
+  /// @brief 按抽取/限速设置推进读指针，只读记录头，不复制负载
+  /// @param non_blocking 非阻塞模式
+  /// @param deadline 整个 receive 调用的截止时间（time_point::max() 表示无限等待）
+  /// @return true 可以接收下一条消息，false 在截止时间前没有可投递的消息
+  bool apply_decimation(bool non_blocking, std::chrono::steady_clock::time_point deadline);
+
 public:
   /// @brief 连接到订阅套接字
   /// @param context MSGQ 上下文（非空）
@@ -94,8 +146,8 @@ public:
   /// @return 0 成功，-1 失败
   /// @throws std::invalid_argument 如果参数无效
   /// @throws std::runtime_error 如果队列创建失败
-  int connect(Context* context, std::string endpoint,
-              std::string address = "127.0.0.1", bool conflate = false,
+  int connect(Context* context, const std::string& endpoint,
+              const std::string& address = "127.0.0.1", bool conflate = false,
               bool check_endpoint = true) override;
 
   /// @brief 设置接收超时时间
@@ -104,6 +156,29 @@ public:
     this->timeout = timeout;
   }
 
+  /// @brief 设置接收消息使用的内存资源
+  /// @param resource 内存资源，nullptr 恢复为默认资源
+  /// @return true（MSGQ 后端总是使用该资源）
+  bool setMemoryResource(std::pmr::memory_resource* resource) override;
+
+  /// @brief 设置抽取/限速订阅（在读指针推进时跳过，不复制被丢弃的消息）
+  /// @param every_nth 每 N 条只投递一条
+  /// @param max_rate_hz 最高投递频率（0 表示不限速），窗口内最新一条胜出
+  /// @throws std::invalid_argument 如果参数无效
+  void setDecimation(uint32_t every_nth, double max_rate_hz = 0.0) override;
+
+  /// @brief 查询待读状态：增量统计，只读新写入帧的 8 字节大小头
+  /// @param info 输出：待读消息数与负载字节数（MSGQ 帧无时间戳，oldest_age 为 0）
+  /// @return true 如果已连接，false 否则
+  bool getPending(PendingInfo& info) const override;
+
+  /// @brief 查询话题新鲜度，只读共享头部与大小头
+  /// @details MSGQ 帧不带时间戳，newest_timestamp 为本套接字观察到写指针
+  ///          前进的时刻（在 freshness()/receive() 中更新），精度为查询间隔；
+  ///          连接后尚无新消息时为未知。
+  /// @return 新鲜度快照
+  Freshness freshness() const override;
+
   /// @brief 接收消息
   /// @param non_blocking 非阻塞模式
   /// @return 接收到的消息（unique_ptr），nullptr 表示无消息
@@ -121,6 +196,7 @@ public:
 class MSGQPubSocket : public PubSocket {
 private:
   std::unique_ptr<msgq_queue_t> q;  ///< MSGQ 队列对象
+  std::unique_ptr<msgq::MemfdSegment> segment;  ///< memfd 模式下的段（MSGQ_MEMFD）
 
   /// @brief 安全清理队列资源
   void cleanup();
@@ -133,7 +209,7 @@ public:
   /// @return 0 成功，-1 失败
   /// @throws std::invalid_argument 如果参数无效
   /// @throws std::runtime_error 如果队列创建失败
-  int connect(Context* context, std::string endpoint,
+  int connect(Context* context, const std::string& endpoint,
               bool check_endpoint = true) override;
 
   /// @brief 发送消息对象
@@ -148,6 +224,12 @@ public:
   /// @return 发送的字节数，-1 表示失败
   int send(char* data, size_t size) override;
 
+  /// @brief 分散-聚集发送
+  /// @details 按 msgq_msg_send 的环布局直接把各片段写入环，不经过中间缓冲区
+  /// @param parts 片段列表
+  /// @return 发送的字节数，-1 表示失败
+  int sendv(msgq::span<const msgq::span<const char>> parts) override;
+
   /// @brief 检查所有订阅者是否已更新
   /// @return true 如果所有订阅者都收到最新消息
   bool all_readers_updated() const override;
@@ -163,6 +245,8 @@ private:
   std::vector<msgq_pollitem_t> polls;   ///< 轮询项数组
 
 public:
+  using Poller::registerSocket;
+
   /// @brief 注册套接字以供轮询
   /// @param socket 子套接字指针（非空）
   /// @throws std::invalid_argument 如果 socket 为空
@@ -171,7 +255,7 @@ public:
 
   /// @brief 对已注册的套接字进行轮询
   /// @param timeout 超时毫秒数，-1 表示无限等待
-  /// @return 准备好的套接字列表
+  /// @return 准备好的套接字列表（按优先级/截止时间排序）
   std::vector<SubSocket*> poll(int timeout) override;
 
   /// @brief 虚析构函数 - 自动清理所有资源
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <stdexcept>
+#include <memory>
+
+#include <poll.h>
+
+#include "msgq/impl_multicast_modern.h"
+
+// ============================================================================
+// MulticastMessage 实现
+// ============================================================================
+
+void MulticastMessage::init(size_t size) {
+  try {
+    data.resize(size);
+  } catch (const std::exception& e) {
+    throw std::runtime_error(std::string("Failed to allocate message: ") + e.what());
+  }
+}
+
+void MulticastMessage::init(char* src_data, size_t size) {
+  if (size > 0 && !src_data) {
+    throw std::invalid_argument("Source data cannot be null when size > 0");
+  }
+
+  try {
+    data.clear();
+    if (size > 0) {
+      msgq::assign_bytes(data, src_data, size);
+    }
+  } catch (const std::exception& e) {
+    throw std::runtime_error(std::string("Failed to initialize message: ") + e.what());
+  }
+}
+
+void MulticastMessage::close() {
+  data.clear();
+  data.shrink_to_fit();
+}
+
+// ============================================================================
+// MulticastSubSocket 实现
+// ============================================================================
+
+int MulticastSubSocket::connect(Context* context, const std::string& endpoint,
+                           const std::string& address, bool conflate,
+                           bool check_endpoint) {
+  if (!context) {
+    throw std::invalid_argument("Context cannot be null");
+  }
+
+  if (endpoint.empty()) {
+    throw std::invalid_argument("Endpoint cannot be empty");
+  }
+
+  if (address != "127.0.0.1") {
+    throw std::invalid_argument("Multicast backend only supports address 127.0.0.1, got: " + address);
+  }
+
+  // 组播接口由 MSGQ_MULTICAST_IF 决定，发布者不在时也能加入
+  try {
+    subscriber = msgq::MulticastSubscriber::join(endpoint);
+  } catch (const std::system_error& e) {
+    throw std::runtime_error("Failed to join multicast topic '" + endpoint + "': " + e.what());
+  }
+  subscriber->set_memory_resource(resource);
+  this->conflate = conflate;
+  timeout = -1;
+  return 0;
+}
+
+bool MulticastSubSocket::setMemoryResource(std::pmr::memory_resource* resource) {
+  this->resource = resource != nullptr ? resource : std::pmr::get_default_resource();
+  if (subscriber) {
+    subscriber->set_memory_resource(this->resource);
+  }
+  return true;
+}
+
+std::unique_ptr<Message> MulticastSubSocket::receive(bool non_blocking) {
+  if (!subscriber) {
+    throw std::runtime_error("Socket not connected");
+  }
+
+  return receiveDecimated(non_blocking ? 0 : timeout, [this](int wait_ms) -> std::unique_ptr<Message> {
+    auto message = std::make_unique<MulticastMessage>(resource);
+    if (!subscriber->receive(message->buffer(), wait_ms, conflate)) {
+      return nullptr;
+    }
+    return message;
+  });
+}
+
+// ============================================================================
+// MulticastPubSocket 实现
+// ============================================================================
+
+int MulticastPubSocket::connect(Context* context, const std::string& endpoint,
+                           bool check_endpoint) {
+  if (!context) {
+    throw std::invalid_argument("Context cannot be null");
+  }
+
+  if (endpoint.empty()) {
+    throw std::invalid_argument("Endpoint cannot be empty");
+  }
+
+  try {
+    publisher = msgq::MulticastPublisher::create(endpoint);
+  } catch (const std::system_error& e) {
+    throw std::runtime_error("Failed to create multicast socket '" + endpoint + "': " + e.what());
+  }
+  return 0;
+}
+
+int MulticastPubSocket::sendMessage(Message* message) {
+  if (!message) {
+    throw std::invalid_argument("Message cannot be null");
+  }
+
+  return send(message->getData(), message->getSize());
+}
+
+int MulticastPubSocket::send(char* data, size_t size) {
+  if (!data && size > 0) {
+    throw std::invalid_argument("Data cannot be null when size > 0");
+  }
+
+  const msgq::span<const char> part(data, size);
+  return sendv(msgq::span<const msgq::span<const char>>(&part, 1));
+}
+
+int MulticastPubSocket::sendv(msgq::span<const msgq::span<const char>> parts) {
+  if (!publisher) {
+    throw std::runtime_error("Socket not connected");
+  }
+
+  size_t total = 0;
+  for (const auto& part : parts) {
+    total += part.size();
+  }
+
+  // 没有订阅者不算错误（与 MSGQ 环形缓冲一致）
+  publisher->send(parts);
+  return static_cast<int>(total);
+}
+
+bool MulticastPubSocket::all_readers_updated() const {
+  // 没有读者跟踪：已发出即视为完成，丢失的数据报由 NACK 修复
+  return publisher != nullptr;
+}
+
+// ============================================================================
+// MulticastPoller 实现
+// ============================================================================
+
+void MulticastPoller::registerSocket(SubSocket* socket) {
+  if (!socket) {
+    throw std::invalid_argument("Socket cannot be null");
+  }
+
+  auto* subscriber = static_cast<msgq::MulticastSubscriber*>(socket->getRawSocket());
+  if (!subscriber) {
+    throw std::invalid_argument("Socket getRawSocket() returned null");
+  }
+
+  sockets.push_back(socket);
+  subscribers.push_back(subscriber);
+}
+
+std::vector<SubSocket*> MulticastPoller::poll(int timeout) {
+  std::vector<SubSocket*> ready;
+
+  if (sockets.empty()) {
+    return ready;
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout, 0));
+  std::vector<struct pollfd> fds(sockets.size());
+
+  for (;;) {
+    // 先重组已到达的数据报并发送到期的 NACK；只有完整消息才算就绪
+    bool repairing = false;
+    for (size_t i = 0; i < sockets.size(); ++i) {
+      if (subscribers[i]->pump()) {
+        ready.push_back(sockets[i]);
+      }
+      repairing = repairing || subscribers[i]->repairing();
+      fds[i] = {subscribers[i]->fd(), POLLIN, 0};
+    }
+
+    const bool expired = timeout >= 0 && std::chrono::steady_clock::now() >= deadline;
+    if (!ready.empty() || expired) {
+      break;
+    }
+
+    int wait_ms = -1;
+    if (timeout >= 0) {
+      wait_ms = static_cast<int>(std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now()).count(), 0));
+    }
+    // 有缺口在修复时按 NACK 间隔醒来重发
+    if (repairing) {
+      const int nack_ms = static_cast<int>(msgq::MULTICAST_NACK_INTERVAL.count());
+      wait_ms = wait_ms < 0 ? nack_ms : std::min(wait_ms, nack_ms);
+    }
+
+    int rc = ::poll(fds.data(), fds.size(), wait_ms);
+    if (rc < 0 && errno != EINTR) {
+      throw std::runtime_error("poll failed: " + std::string(strerror(errno)));
+    }
+  }
+
+  orderReady(ready);
+  return ready;
+}
+
+// ============================================================================
+// 工厂函数
+// ============================================================================
+
+namespace msgq::detail {
+
+std::unique_ptr<Context> create_multicast_context() {
+  return std::make_unique<MulticastContext>();
+}
+
+std::unique_ptr<SubSocket> create_multicast_subsocket() {
+  return std::make_unique<MulticastSubSocket>();
+}
+
+std::unique_ptr<PubSocket> create_multicast_pubsocket() {
+  return std::make_unique<MulticastPubSocket>();
+}
+
+std::unique_ptr<Poller> create_multicast_poller() {
+  return std::make_unique<MulticastPoller>();
+}
+
+} // namespace msgq::detail
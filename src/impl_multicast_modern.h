@@ -0,0 +1,192 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "msgq/ipc.h"
+#include "msgq/multicast_socket_modern.h"
+#include "msgq/default_init_allocator_modern.h"
+
+/// @file impl_multicast_modern.h
+/// @brief UDP 组播后端（MSGQ_MULTICAST=1）
+/// @details 每条消息只发送一次，订阅者数量不影响发布端开销：
+///   - 大消息按 fragment_size 分片，一次 sendmmsg 发出；订阅端用 recvmmsg 批量接收
+///   - 订阅端按序号检测缺口，向发布者发送 NACK，发布者从有界历史中重传
+///   - 默认组播接口为 127.0.0.1，可在回环接口上完整测试
+
+/// @brief 组播上下文（无共享状态）
+class MulticastContext : public Context {
+public:
+  /// @brief 获取原始上下文指针
+  /// @return 组播后端不使用上下文，返回 nullptr
+  void* getRawContext() const override {
+    return nullptr;
+  }
+
+  /// @brief 虚析构函数
+  ~MulticastContext() override = default;
+};
+
+/// @brief 组播消息（从给定内存资源分配，扩容不清零）
+class MulticastMessage : public Message {
+private:
+  msgq::ByteBuffer data;  ///< 消息数据
+
+public:
+  /// @brief 构造空消息
+  /// @param resource 缓冲区使用的内存资源，必须比消息活得更久
+  explicit MulticastMessage(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    : data(resource) {}
+
+  /// @brief 初始化指定大小的消息缓冲区（内容未初始化）
+  /// @param size 消息大小（字节）
+  void init(size_t size) override;
+
+  /// @brief 初始化并复制消息数据
+  /// @param data 源数据指针
+  /// @param size 数据大小
+  /// @throws std::invalid_argument 如果 data 为空且 size > 0
+  void init(char* data, size_t size) override;
+
+  /// @brief 获取消息大小（字节）
+  size_t getSize() const override {
+    return data.size();
+  }
+
+  /// @brief 获取消息数据指针
+  char* getData() const override {
+    return const_cast<char*>(data.data());
+  }
+
+  /// @brief 接收缓冲区，供 MulticastSubSocket 直接填充
+  msgq::ByteBuffer& buffer() noexcept {
+    return data;
+  }
+
+  /// @brief 清理消息数据
+  void close() override;
+
+  /// @brief 虚析构函数
+  ~MulticastMessage() override = default;
+};
+
+/// @brief 组播订阅实现
+class MulticastSubSocket : public SubSocket {
+private:
+  std::unique_ptr<msgq::MulticastSubscriber> subscriber;  ///< 已加入话题组播组的套接字
+  int timeout = -1;                                       ///< 接收超时（毫秒），-1=无限等待
+  bool conflate = false;                                  ///< 只保留最新消息
+  std::pmr::memory_resource* resource = std::pmr::get_default_resource();  ///< 接收消息的内存资源
+
+public:
+  /// @brief 加入话题的组播组
+  /// @details 发布者尚未启动时也会成功，收到其首个数据报或心跳后开始接收
+  /// @param context 上下文（非空）
+  /// @param endpoint 端点名称
+  /// @param address 服务地址（必须是 127.0.0.1，组播接口由 MSGQ_MULTICAST_IF 指定）
+  /// @param conflate 是否只保留最新消息
+  /// @param check_endpoint 是否检查端点有效性
+  /// @return 0 成功
+  /// @throws std::invalid_argument 如果参数无效
+  /// @throws std::runtime_error 如果套接字创建失败
+  int connect(Context* context, const std::string& endpoint,
+              const std::string& address = "127.0.0.1", bool conflate = false,
+              bool check_endpoint = true) override;
+
+  /// @brief 设置接收超时时间
+  /// @param timeout 超时毫秒数，-1 表示无限等待
+  void setTimeout(int timeout) override {
+    this->timeout = timeout;
+  }
+
+  /// @brief 设置接收消息使用的内存资源
+  /// @param resource 内存资源，nullptr 恢复为默认资源
+  /// @return true（消息直接在该资源中重组）
+  bool setMemoryResource(std::pmr::memory_resource* resource) override;
+
+  /// @brief 接收消息
+  /// @details 设置了 setDecimation 时由 receiveDecimated 接收并丢弃被跳过的消息
+  /// @param non_blocking 非阻塞模式
+  /// @return 接收到的消息，nullptr 表示超时或无消息
+  std::unique_ptr<Message> receive(bool non_blocking = false) override;
+
+  /// @brief 获取底层订阅者（msgq::MulticastSubscriber*，供 MulticastPoller 使用）
+  void* getRawSocket() const override {
+    return subscriber.get();
+  }
+
+  /// @brief 虚析构函数
+  ~MulticastSubSocket() override = default;
+};
+
+/// @brief 组播发布实现
+class MulticastPubSocket : public PubSocket {
+private:
+  std::unique_ptr<msgq::MulticastPublisher> publisher;  ///< 发送套接字与重传线程
+
+public:
+  /// @brief 创建话题的发送套接字
+  /// @details 组播无法检测同一话题的其他发布者，每个话题只应有一个发布者
+  /// @param context 上下文（非空）
+  /// @param endpoint 端点名称
+  /// @param check_endpoint 是否检查端点有效性
+  /// @return 0 成功
+  /// @throws std::invalid_argument 如果参数无效
+  /// @throws std::runtime_error 如果套接字创建失败
+  int connect(Context* context, const std::string& endpoint,
+              bool check_endpoint = true) override;
+
+  /// @brief 发送消息对象
+  /// @param message 消息指针（非空）
+  /// @return 发送的字节数
+  /// @throws std::invalid_argument 如果 message 为空
+  int sendMessage(Message* message) override;
+
+  /// @brief 发送原始数据
+  /// @param data 数据指针
+  /// @param size 数据大小
+  /// @return 发送的字节数
+  int send(char* data, size_t size) override;
+
+  /// @brief 分散-聚集发送
+  /// @details 片段直接拷入分片数据报，不经过额外的聚集缓冲区
+  /// @param parts 片段列表
+  /// @return 发送的字节数
+  int sendv(msgq::span<const msgq::span<const char>> parts) override;
+
+  /// @brief 检查所有订阅者是否已读完
+  /// @details 组播发布者不知道订阅者是谁，消息发出后即返回 true
+  bool all_readers_updated() const override;
+
+  /// @brief 虚析构函数
+  ~MulticastPubSocket() override = default;
+};
+
+/// @brief 组播轮询器
+/// @details 就绪判断基于完整消息而非套接字可读：收到的数据报先经 pump()
+///          重组，只有缺口的分片不算就绪。修复缺口期间等待被切分为不超过
+///          MULTICAST_NACK_INTERVAL 的片段，以便按时发送 NACK
+class MulticastPoller : public Poller {
+private:
+  std::vector<SubSocket*> sockets;                       ///< 已注册的套接字列表
+  std::vector<msgq::MulticastSubscriber*> subscribers;   ///< 对应的订阅者
+
+public:
+  using Poller::registerSocket;
+
+  /// @brief 注册套接字以供轮询
+  /// @param socket 子套接字指针（非空，必须是已连接的 MulticastSubSocket）
+  /// @throws std::invalid_argument 如果 socket 为空或未连接
+  void registerSocket(SubSocket* socket) override;
+
+  /// @brief 对已注册的套接字进行轮询
+  /// @param timeout 超时毫秒数，-1 表示无限等待
+  /// @return 准备好的套接字列表（按优先级/截止时间排序）
+  std::vector<SubSocket*> poll(int timeout) override;
+
+  /// @brief 虚析构函数
+  ~MulticastPoller() override = default;
+};
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <stdexcept>
+#include <memory>
+
+#include <poll.h>
+
+#include "msgq/impl_unix_modern.h"
+
+// ============================================================================
+// UnixMessage 实现
+// ============================================================================
+
+void UnixMessage::init(size_t size) {
+  try {
+    data.resize(size);
+  } catch (const std::exception& e) {
+    throw std::runtime_error(std::string("Failed to allocate message: ") + e.what());
+  }
+}
+
+void UnixMessage::init(char* src_data, size_t size) {
+  if (size > 0 && !src_data) {
+    throw std::invalid_argument("Source data cannot be null when size > 0");
+  }
+
+  try {
+    data.clear();
+    if (size > 0) {
+      msgq::assign_bytes(data, src_data, size);
+    }
+  } catch (const std::exception& e) {
+    throw std::runtime_error(std::string("Failed to initialize message: ") + e.what());
+  }
+}
+
+void UnixMessage::close() {
+  data.clear();
+  data.shrink_to_fit();
+}
+
+// ============================================================================
+// UnixSubSocket 实现
+// ============================================================================
+
+int UnixSubSocket::connect(Context* context, const std::string& endpoint,
+                           const std::string& address, bool conflate,
+                           bool check_endpoint) {
+  if (!context) {
+    throw std::invalid_argument("Context cannot be null");
+  }
+
+  if (endpoint.empty()) {
+    throw std::invalid_argument("Endpoint cannot be empty");
+  }
+
+  if (address != "127.0.0.1") {
+    throw std::invalid_argument("Unix socket backend only supports address 127.0.0.1, got: " + address);
+  }
+
+  // 发布者不在时 connect 也成功，之后延迟重连
+  subscriber = msgq::UnixSubscriber::connect(endpoint);
+  subscriber->set_memory_resource(resource);
+  this->conflate = conflate;
+  timeout = -1;
+  return 0;
+}
+
+bool UnixSubSocket::setMemoryResource(std::pmr::memory_resource* resource) {
+  this->resource = resource != nullptr ? resource : std::pmr::get_default_resource();
+  if (subscriber) {
+    subscriber->set_memory_resource(this->resource);
+  }
+  return true;
+}
+
+std::unique_ptr<Message> UnixSubSocket::receive(bool non_blocking) {
+  if (!subscriber) {
+    throw std::runtime_error("Socket not connected");
+  }
+
+  return receiveDecimated(non_blocking ? 0 : timeout, [this](int wait_ms) -> std::unique_ptr<Message> {
+    auto message = std::make_unique<UnixMessage>(resource);
+    if (!subscriber->receive(message->buffer(), wait_ms, conflate)) {
+      return nullptr;
+    }
+    return message;
+  });
+}
+
+// ============================================================================
+// UnixPubSocket 实现
+// ============================================================================
+
+int UnixPubSocket::connect(Context* context, const std::string& endpoint,
+                           bool check_endpoint) {
+  if (!context) {
+    throw std::invalid_argument("Context cannot be null");
+  }
+
+  if (endpoint.empty()) {
+    throw std::invalid_argument("Endpoint cannot be empty");
+  }
+
+  try {
+    publisher = msgq::UnixPublisher::bind(endpoint);
+  } catch (const std::system_error& e) {
+    // 与 ZMQ 后端一致：话题已有发布者时返回 -1 并保留 errno
+    if (e.code().value() == EADDRINUSE) {
+      errno = EADDRINUSE;
+      return -1;
+    }
+    throw std::runtime_error("Failed to bind unix socket '" + endpoint + "': " + e.what());
+  }
+  return 0;
+}
+
+int UnixPubSocket::sendMessage(Message* message) {
+  if (!message) {
+    throw std::invalid_argument("Message cannot be null");
+  }
+
+  return send(message->getData(), message->getSize());
+}
+
+int UnixPubSocket::send(char* data, size_t size) {
+  if (!data && size > 0) {
+    throw std::invalid_argument("Data cannot be null when size > 0");
+  }
+
+  const msgq::span<const char> part(data, size);
+  return sendv(msgq::span<const msgq::span<const char>>(&part, 1));
+}
+
+int UnixPubSocket::sendv(msgq::span<const msgq::span<const char>> parts) {
+  if (!publisher) {
+    throw std::runtime_error("Socket not connected");
+  }
+
+  size_t total = 0;
+  for (const auto& part : parts) {
+    total += part.size();
+  }
+
+  // 没有订阅者或被积压上限丢弃都不算错误（与 MSGQ 环形缓冲一致）
+  publisher->send(parts);
+  return static_cast<int>(total);
+}
+
+bool UnixPubSocket::all_readers_updated() const {
+  if (!publisher) {
+    return false;
+  }
+
+  return publisher->all_readers_updated();
+}
+
+// ============================================================================
+// UnixPoller 实现
+// ============================================================================
+
+void UnixPoller::registerSocket(SubSocket* socket) {
+  if (!socket) {
+    throw std::invalid_argument("Socket cannot be null");
+  }
+
+  auto* subscriber = static_cast<msgq::UnixSubscriber*>(socket->getRawSocket());
+  if (!subscriber) {
+    throw std::invalid_argument("Socket getRawSocket() returned null");
+  }
+
+  sockets.push_back(socket);
+  subscribers.push_back(subscriber);
+}
+
+std::vector<SubSocket*> UnixPoller::poll(int timeout) {
+  std::vector<SubSocket*> ready;
+
+  if (sockets.empty()) {
+    return ready;
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout, 0));
+  std::vector<struct pollfd> fds;
+  std::vector<size_t> index;  // fds[k] 对应 sockets[index[k]]
+
+  for (;;) {
+    // 已在上一批 recvmmsg 中缓存的消息无需系统调用
+    for (size_t i = 0; i < sockets.size(); ++i) {
+      if (subscribers[i]->buffered()) {
+        ready.push_back(sockets[i]);
+      }
+    }
+
+    fds.clear();
+    index.clear();
+    bool disconnected = false;
+    for (size_t i = 0; i < subscribers.size(); ++i) {
+      if (subscribers[i]->try_connect()) {
+        fds.push_back({subscribers[i]->fd(), POLLIN, 0});
+        index.push_back(i);
+      } else {
+        disconnected = true;
+      }
+    }
+
+    int wait_ms = -1;
+    if (!ready.empty()) {
+      wait_ms = 0;
+    } else if (timeout >= 0) {
+      wait_ms = static_cast<int>(std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now()).count(), 0));
+    }
+    // 有未连接的订阅者时按重连间隔醒来重试
+    if (disconnected) {
+      const int retry_ms = static_cast<int>(msgq::UNIX_RECONNECT_INTERVAL.count());
+      wait_ms = wait_ms < 0 ? retry_ms : std::min(wait_ms, retry_ms);
+    }
+
+    int rc = ::poll(fds.data(), fds.size(), wait_ms);
+    if (rc < 0 && errno != EINTR) {
+      throw std::runtime_error("poll failed: " + std::string(strerror(errno)));
+    }
+
+    for (size_t k = 0; rc > 0 && k < fds.size(); ++k) {
+      const size_t i = index[k];
+      if (fds[k].revents & POLLIN) {
+        if (!subscribers[i]->buffered()) {
+          ready.push_back(sockets[i]);
+        }
+      } else if (fds[k].revents & (POLLHUP | POLLERR)) {
+        // 发布者退出：下次轮询时重连
+        subscribers[i]->disconnect();
+      }
+    }
+
+    const bool expired = timeout >= 0 && std::chrono::steady_clock::now() >= deadline;
+    if (!ready.empty() || expired) {
+      break;
+    }
+  }
+
+  orderReady(ready);
+  return ready;
+}
+
+// ============================================================================
+// 工厂函数
+// ============================================================================
+
+namespace msgq::detail {
+
+std::unique_ptr<Context> create_unix_context() {
+  return std::make_unique<UnixContext>();
+}
+
+std::unique_ptr<SubSocket> create_unix_subsocket() {
+  return std::make_unique<UnixSubSocket>();
+}
+
+std::unique_ptr<PubSocket> create_unix_pubsocket() {
+  return std::make_unique<UnixPubSocket>();
+}
+
+std::unique_ptr<Poller> create_unix_poller() {
+  return std::make_unique<UnixPoller>();
+}
+
+} // namespace msgq::detail
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "msgq/ipc.h"
+#include "msgq/unix_socket_modern.h"
+#include "msgq/default_init_allocator_modern.h"
+
+/// @file impl_unix_modern.h
+/// @brief AF_UNIX SOCK_SEQPACKET 后端（MSGQ_UNIX=1）
+/// @details 供无法映射 /dev/shm 的沙箱进程使用：
+///   - 每个订阅者一条 seqpacket 连接，内核保证消息边界与顺序
+///   - 发布端按订阅者用 sendmmsg 发送分片与积压包，订阅端用 recvmmsg 批量接收
+///   - 大负载写入密封 memfd，经 SCM_RIGHTS 传给所有订阅者（只复制一次）
+///   - 发布者从不阻塞：慢订阅者积压超过上限时只丢弃该订阅者的整条消息
+
+/// @brief Unix 套接字上下文（无共享状态）
+class UnixContext : public Context {
+public:
+  /// @brief 获取原始上下文指针
+  /// @return Unix 后端不使用上下文，返回 nullptr
+  void* getRawContext() const override {
+    return nullptr;
+  }
+
+  /// @brief 虚析构函数
+  ~UnixContext() override = default;
+};
+
+/// @brief Unix 套接字消息（从给定内存资源分配，扩容不清零）
+class UnixMessage : public Message {
+private:
+  msgq::ByteBuffer data;  ///< 消息数据
+
+public:
+  /// @brief 构造空消息
+  /// @param resource 缓冲区使用的内存资源，必须比消息活得更久
+  explicit UnixMessage(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    : data(resource) {}
+
+  /// @brief 初始化指定大小的消息缓冲区（内容未初始化）
+  /// @param size 消息大小（字节）
+  void init(size_t size) override;
+
+  /// @brief 初始化并复制消息数据
+  /// @param data 源数据指针
+  /// @param size 数据大小
+  /// @throws std::invalid_argument 如果 data 为空且 size > 0
+  void init(char* data, size_t size) override;
+
+  /// @brief 获取消息大小（字节）
+  size_t getSize() const override {
+    return data.size();
+  }
+
+  /// @brief 获取消息数据指针
+  char* getData() const override {
+    return const_cast<char*>(data.data());
+  }
+
+  /// @brief 接收缓冲区，供 UnixSubSocket 直接填充
+  msgq::ByteBuffer& buffer() noexcept {
+    return data;
+  }
+
+  /// @brief 清理消息数据
+  void close() override;
+
+  /// @brief 虚析构函数
+  ~UnixMessage() override = default;
+};
+
+/// @brief Unix 套接字订阅实现
+class UnixSubSocket : public SubSocket {
+private:
+  std::unique_ptr<msgq::UnixSubscriber> subscriber;  ///< 连接（发布者不在时延迟重连）
+  int timeout = -1;                                  ///< 接收超时（毫秒），-1=无限等待
+  bool conflate = false;                             ///< 只保留最新消息
+  std::pmr::memory_resource* resource = std::pmr::get_default_resource();  ///< 接收消息的内存资源
+
+public:
+  /// @brief 订阅话题
+  /// @details 发布者尚未启动时也会成功，之后在接收/轮询时自动连接
+  /// @param context 上下文（非空）
+  /// @param endpoint 端点名称
+  /// @param address 服务地址（必须是 127.0.0.1）
+  /// @param conflate 是否只保留最新消息
+  /// @param check_endpoint 是否检查端点有效性
+  /// @return 0 成功
+  /// @throws std::invalid_argument 如果参数无效
+  int connect(Context* context, const std::string& endpoint,
+              const std::string& address = "127.0.0.1", bool conflate = false,
+              bool check_endpoint = true) override;
+
+  /// @brief 设置接收超时时间
+  /// @param timeout 超时毫秒数，-1 表示无限等待
+  void setTimeout(int timeout) override {
+    this->timeout = timeout;
+  }
+
+  /// @brief 设置接收消息使用的内存资源
+  /// @param resource 内存资源，nullptr 恢复为默认资源
+  /// @return true（消息直接在该资源中重组）
+  bool setMemoryResource(std::pmr::memory_resource* resource) override;
+
+  /// @brief 接收消息
+  /// @details 设置了 setDecimation 时由 receiveDecimated 接收并丢弃被跳过的消息
+  /// @param non_blocking 非阻塞模式
+  /// @return 接收到的消息，nullptr 表示超时或无消息
+  std::unique_ptr<Message> receive(bool non_blocking = false) override;
+
+  /// @brief 获取底层订阅者（msgq::UnixSubscriber*，供 UnixPoller 使用）
+  void* getRawSocket() const override {
+    return subscriber.get();
+  }
+
+  /// @brief 虚析构函数
+  ~UnixSubSocket() override = default;
+};
+
+/// @brief Unix 套接字发布实现
+class UnixPubSocket : public PubSocket {
+private:
+  std::unique_ptr<msgq::UnixPublisher> publisher;  ///< 监听套接字与订阅者连接
+
+public:
+  /// @brief 绑定话题的套接字
+  /// @param context 上下文（非空）
+  /// @param endpoint 端点名称
+  /// @param check_endpoint 是否检查端点有效性
+  /// @return 0 成功，-1 且 errno=EADDRINUSE 表示已有发布者
+  /// @throws std::invalid_argument 如果参数无效
+  /// @throws std::runtime_error 如果套接字创建失败
+  int connect(Context* context, const std::string& endpoint,
+              bool check_endpoint = true) override;
+
+  /// @brief 发送消息对象
+  /// @param message 消息指针（非空）
+  /// @return 发送的字节数
+  /// @throws std::invalid_argument 如果 message 为空
+  int sendMessage(Message* message) override;
+
+  /// @brief 发送原始数据
+  /// @param data 数据指针
+  /// @param size 数据大小
+  /// @return 发送的字节数
+  int send(char* data, size_t size) override;
+
+  /// @brief 分散-聚集发送
+  /// @details 片段直接作为 iovec 交给内核，不经过聚集缓冲区
+  /// @param parts 片段列表
+  /// @return 发送的字节数
+  int sendv(msgq::span<const msgq::span<const char>> parts) override;
+
+  /// @brief 检查所有订阅者是否已读完（积压为空且内核发送队列为空）
+  bool all_readers_updated() const override;
+
+  /// @brief 虚析构函数
+  ~UnixPubSocket() override = default;
+};
+
+/// @brief Unix 套接字轮询器
+/// @details 对已连接的订阅者 poll；未连接的订阅者每 UNIX_RECONNECT_INTERVAL
+///          重试连接，因此等待被切分为不超过该间隔的片段
+class UnixPoller : public Poller {
+private:
+  std::vector<SubSocket*> sockets;                  ///< 已注册的套接字列表
+  std::vector<msgq::UnixSubscriber*> subscribers;   ///< 对应的订阅者
+
+public:
+  using Poller::registerSocket;
+
+  /// @brief 注册套接字以供轮询
+  /// @param socket 子套接字指针（非空，必须是已连接的 UnixSubSocket）
+  /// @throws std::invalid_argument 如果 socket 为空或未连接
+  void registerSocket(SubSocket* socket) override;
+
+  /// @brief 对已注册的套接字进行轮询
+  /// @param timeout 超时毫秒数，-1 表示无限等待
+  /// @return 准备好的套接字列表（按优先级/截止时间排序）
+  std::vector<SubSocket*> poll(int timeout) override;
+
+  /// @brief 虚析构函数
+  ~UnixPoller() override = default;
+};
@@ -13,6 +13,8 @@
 #include <cassert>
 #include <zmq.h>
 
+#include "msgq/poll_scheduler_modern.h"
+
 // ============================================================================
 // 自定义删除器（RAII 资源管理）
 // ============================================================================
@@ -297,6 +299,7 @@ private:
   void* zmq_context = nullptr;
   std::vector<void*> zmq_sockets;
   std::vector<int> socket_events;
+  mutable msgq::PollScheduler scheduler;  ///< 就绪排序状态（轮询时更新）
   
 public:
   /// @brief 构造函数
@@ -327,7 +330,7 @@ public:
   /// @brief 轮询 ZMQ 套接字（只读操作）
   /// 
   /// @param timeout_ms 超时时间（毫秒）
-  /// @return 就绪的事件列表
+  /// @return 就绪套接字的下标，按优先级/截止时间排序（见 msgq::PollScheduler）
   std::vector<int> poll(int timeout_ms = -1) const {
     if (zmq_sockets.empty()) {
       return {};
@@ -348,13 +351,21 @@ public:
       return {};
     }
     
-    // 收集就绪的事件
-    std::vector<int> ready;
+    // 收集就绪的套接字并排序
+    std::vector<void*> ready_sockets;
     for (size_t i = 0; i < items.size(); ++i) {
       if (items[i].revents & (ZMQ_POLLIN | ZMQ_POLLOUT)) {
-        ready.push_back(static_cast<int>(i));
+        ready_sockets.push_back(zmq_sockets[i]);
       }
     }
+    scheduler.order(ready_sockets);
+    
+    std::vector<int> ready;
+    ready.reserve(ready_sockets.size());
+    for (void* socket : ready_sockets) {
+      auto it = std::find(zmq_sockets.begin(), zmq_sockets.end(), socket);
+      ready.push_back(static_cast<int>(it - zmq_sockets.begin()));
+    }
     
     return ready;
   }
@@ -363,15 +374,23 @@ public:
   /// 
   /// @param socket ZMQ 套接字指针
   /// @param events 关注的事件（如 ZMQ_POLLIN）
+  /// @param options 优先级与可选截止时间
   /// 
   /// @throw std::invalid_argument 套接字为空
-  void register_socket(void* socket, int events = ZMQ_POLLIN) {
+  void register_socket(void* socket, int events = ZMQ_POLLIN,
+                       const msgq::PollOptions& options = {}) {
     if (!socket) {
       throw std::invalid_argument("Socket cannot be null");
     }
     
     zmq_sockets.push_back(socket);
     socket_events.push_back(events);
+    scheduler.set_options(socket, options);
+  }
+  
+  /// @brief 设置防饿死上限（0 表示关闭）
+  void set_starvation_limit(std::chrono::milliseconds limit) noexcept {
+    scheduler.set_starvation_limit(limit);
   }
   
   /// @brief 获取套接字数量（只读操作）
@@ -385,6 +404,7 @@ public:
   void clear() noexcept {
     zmq_sockets.clear();
     socket_events.clear();
+    scheduler = msgq::PollScheduler();
   }
 };
 
@@ -1,7 +1,9 @@
 #include "ipc_modern.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cassert>
+#include <thread>
 #include <iostream>
 #include <map>
 
@@ -44,10 +46,16 @@ bool messaging_use_fake() noexcept {
 BackendType determine_backend_type() noexcept {
     const bool use_fake = messaging_use_fake();
     const bool use_zmq = messaging_use_zmq();
+    const bool use_unix = !use_zmq && messaging_use_unix();
+    const bool use_multicast = !use_zmq && !use_unix && messaging_use_multicast();
 
     if (use_fake) {
+        if (use_unix) return BackendType::FAKE_UNIX;
+        if (use_multicast) return BackendType::FAKE_MULTICAST;
         return use_zmq ? BackendType::FAKE_ZMQ : BackendType::FAKE_MSGQ;
     } else {
+        if (use_unix) return BackendType::UNIX;
+        if (use_multicast) return BackendType::MULTICAST;
         return use_zmq ? BackendType::ZMQ : BackendType::MSGQ;
     }
 }
@@ -78,6 +86,16 @@ namespace detail {
     extern std::unique_ptr<Poller> create_zmq_poller();
     extern std::unique_ptr<Poller> create_msgq_poller();
     extern std::unique_ptr<Poller> create_fake_poller();
+    extern std::unique_ptr<Context> create_unix_context();
+    extern std::unique_ptr<SubSocket> create_unix_subsocket();
+    extern std::unique_ptr<SubSocket> create_fake_unix_subsocket();
+    extern std::unique_ptr<PubSocket> create_unix_pubsocket();
+    extern std::unique_ptr<Poller> create_unix_poller();
+    extern std::unique_ptr<Context> create_multicast_context();
+    extern std::unique_ptr<SubSocket> create_multicast_subsocket();
+    extern std::unique_ptr<SubSocket> create_fake_multicast_subsocket();
+    extern std::unique_ptr<PubSocket> create_multicast_pubsocket();
+    extern std::unique_ptr<Poller> create_multicast_poller();
 }
 
 // ============================================================================
@@ -90,6 +108,10 @@ std::unique_ptr<Context> Context::create() {
         
         if (use_zmq) {
             return detail::create_zmq_context();
+        } else if (messaging_use_unix()) {
+            return detail::create_unix_context();
+        } else if (messaging_use_multicast()) {
+            return detail::create_multicast_context();
         } else {
             return detail::create_msgq_context();
         }
@@ -113,10 +135,18 @@ std::unique_ptr<SubSocket> SubSocket::create() {
                 return detail::create_fake_zmq_subsocket();
             case BackendType::FAKE_MSGQ:
                 return detail::create_fake_msgq_subsocket();
+            case BackendType::FAKE_UNIX:
+                return detail::create_fake_unix_subsocket();
+            case BackendType::FAKE_MULTICAST:
+                return detail::create_fake_multicast_subsocket();
             case BackendType::ZMQ:
                 return detail::create_zmq_subsocket();
             case BackendType::MSGQ:
                 return detail::create_msgq_subsocket();
+            case BackendType::UNIX:
+                return detail::create_unix_subsocket();
+            case BackendType::MULTICAST:
+                return detail::create_multicast_subsocket();
         }
         
         // 不应该到达这里
@@ -133,7 +163,8 @@ std::unique_ptr<SubSocket> SubSocket::create(
     const std::string& endpoint,
     const std::string& address,
     bool conflate,
-    bool check_endpoint) {
+    bool check_endpoint,
+    std::pmr::memory_resource* resource) {
     
     if (context == nullptr) {
         throw std::invalid_argument("Context pointer cannot be null");
@@ -145,6 +176,9 @@ std::unique_ptr<SubSocket> SubSocket::create(
 
     try {
         auto socket = SubSocket::create();
+        if (resource != nullptr) {
+            (void)socket->setMemoryResource(resource);
+        }
         int r = socket->connect(context, endpoint, address, conflate, check_endpoint);
         
         if (r != 0) {
@@ -166,6 +200,16 @@ std::unique_ptr<SubSocket> SubSocket::create(
     }
 }
 
+std::unique_ptr<SubSocket> SubSocket::create(
+    Context* context,
+    const TopicInfo& topic,
+    const std::string& address,
+    bool conflate,
+    bool check_endpoint,
+    std::pmr::memory_resource* resource) {
+    return SubSocket::create(context, std::string(topic.name), address, conflate, check_endpoint, resource);
+}
+
 // ============================================================================
 // PubSocket 工厂实现
 // ============================================================================
@@ -176,6 +220,10 @@ std::unique_ptr<PubSocket> PubSocket::create() {
         
         if (use_zmq) {
             return detail::create_zmq_pubsocket();
+        } else if (messaging_use_unix()) {
+            return detail::create_unix_pubsocket();
+        } else if (messaging_use_multicast()) {
+            return detail::create_multicast_pubsocket();
         } else {
             return detail::create_msgq_pubsocket();
         }
@@ -252,10 +300,153 @@ std::unique_ptr<PubSocket> PubSocket::create(
     }
 }
 
+std::unique_ptr<PubSocket> PubSocket::create(
+    Context* context,
+    const TopicInfo& topic,
+    bool check_endpoint) {
+    return PubSocket::create(context, std::string(topic.name), check_endpoint);
+}
+
+void SubSocket::setDecimation(uint32_t every_nth, double max_rate_hz) {
+    if (every_nth == 0 || max_rate_hz < 0.0) {
+        throw std::invalid_argument("Invalid decimation settings");
+    }
+
+    decimation_every_nth = every_nth;
+    decimation_skip = 0;
+    decimation_interval = std::chrono::steady_clock::duration::zero();
+    if (max_rate_hz > 0.0) {
+        decimation_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / max_rate_hz));
+    }
+    decimation_next = std::chrono::steady_clock::time_point();
+}
+
+std::unique_ptr<Message> SubSocket::receiveDecimated(
+    int timeout_ms, const std::function<std::unique_ptr<Message>(int)>& receive_one) {
+    using clock = std::chrono::steady_clock;
+
+    if (decimation_every_nth <= 1 && decimation_interval == clock::duration::zero()) {
+        return receive_one(timeout_ms);
+    }
+
+    const clock::time_point deadline = timeout_ms < 0
+        ? clock::time_point::max()
+        : clock::now() + std::chrono::milliseconds(timeout_ms);
+    // 截止时间剩余的毫秒数（向上取整，不会提前醒来）
+    auto remaining_ms = [&]() -> int {
+        if (timeout_ms <= 0) {
+            return timeout_ms;
+        }
+        const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - clock::now()).count();
+        return static_cast<int>(std::max<int64_t>(left, 0));
+    };
+
+    // 限速窗口未打开：阻塞模式下等到窗口打开或超时
+    const bool rate_limited = decimation_interval != clock::duration::zero();
+    if (rate_limited && clock::now() < decimation_next) {
+        if (timeout_ms == 0) {
+            return nullptr;
+        }
+        if (deadline < decimation_next) {
+            std::this_thread::sleep_until(deadline);
+            return nullptr;
+        }
+        std::this_thread::sleep_until(decimation_next);
+    }
+
+    bool newest = rate_limited;
+    for (;;) {
+        std::unique_ptr<Message> message = receive_one(remaining_ms());
+        if (!message) {
+            return nullptr;
+        }
+        // 最新者胜出：取走窗口打开时已到达的全部消息，留下最后一条
+        while (newest) {
+            std::unique_ptr<Message> newer = receive_one(0);
+            if (!newer) {
+                break;
+            }
+            message = std::move(newer);
+        }
+        newest = false;
+
+        if (decimation_skip > 0) {
+            decimation_skip--;
+            continue;
+        }
+        decimation_skip = decimation_every_nth - 1;
+        if (rate_limited) {
+            decimation_next = clock::now() + decimation_interval;
+        }
+        return message;
+    }
+}
+
+bool SubSocket::setMemoryResource(std::pmr::memory_resource* resource) {
+    (void)resource;
+    return false;
+}
+
+bool SubSocket::getPending(PendingInfo& info) const {
+    info = PendingInfo{};
+    return false;
+}
+
+Freshness SubSocket::freshness() const {
+    Freshness result;
+    PendingInfo pending;
+    if (getPending(pending)) {
+        result.backlog_messages = pending.messages;
+        result.backlog_bytes = pending.bytes;
+    }
+    return result;
+}
+
+int PubSocket::sendv(span<const span<const char>> parts) {
+    size_t total = 0;
+    for (const auto& part : parts) {
+        total += part.size();
+    }
+
+    std::vector<char> buffer;
+    buffer.reserve(total);
+    for (const auto& part : parts) {
+        buffer.insert(buffer.end(), part.data(), part.data() + part.size());
+    }
+    return send(buffer.data(), buffer.size());
+}
+
 // ============================================================================
 // Poller 工厂实现
 // ============================================================================
 
+std::vector<PollResult> Poller::pollDetailed(int timeout) {
+    std::vector<SubSocket*> ready = poll(timeout);
+
+    std::vector<PollResult> results;
+    results.reserve(ready.size());
+    const auto now = PollScheduler::Clock::now();
+    for (SubSocket* socket : ready) {
+        PollResult result;
+        result.socket = socket;
+        (void)socket->getPending(result.pending);
+        if (result.pending.oldest_age.count() == 0) {
+            result.pending.oldest_age = scheduler_.pending_age(socket, now);
+        }
+        results.push_back(result);
+    }
+    return results;
+}
+
+void Poller::registerSocket(SubSocket* socket, const PollOptions& options) {
+    if (!socket) {
+        throw std::invalid_argument("Socket cannot be null");
+    }
+    registerSocket(socket);
+    scheduler_.set_options(socket, options);
+}
+
 std::unique_ptr<Poller> Poller::create() {
     try {
         const bool use_fake = messaging_use_fake();
@@ -268,6 +459,10 @@ std::unique_ptr<Poller> Poller::create() {
         
         if (use_zmq) {
             return detail::create_zmq_poller();
+        } else if (messaging_use_unix()) {
+            return detail::create_unix_poller();
+        } else if (messaging_use_multicast()) {
+            return detail::create_multicast_poller();
         } else {
             return detail::create_msgq_poller();
         }
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <vector>
 #include <utility>
@@ -13,6 +16,10 @@
 #include <cerrno>
 #include <cstring>
 
+#include "span_modern.h"
+#include "poll_scheduler_modern.h"
+#include "topic_modern.h"
+
 #ifdef __APPLE__
 #define CLOCK_BOOTTIME CLOCK_MONOTONIC
 #endif
@@ -29,8 +36,12 @@ constexpr int MSG_MULTIPLE_PUBLISHERS = 100;
 enum class BackendType {
     FAKE_ZMQ,   ///< Fake + ZMQ 组合
     FAKE_MSGQ,  ///< Fake + MSGQ 组合
+    FAKE_UNIX,  ///< Fake + Unix 套接字组合
+    FAKE_MULTICAST,  ///< Fake + UDP 组播组合
     ZMQ,        ///< ZMQ 后端
-    MSGQ        ///< MSGQ 后端
+    MSGQ,       ///< MSGQ 后端
+    UNIX,       ///< AF_UNIX SOCK_SEQPACKET 后端（无共享内存）
+    MULTICAST   ///< UDP 组播后端（NACK 重传，可跨主机）
 };
 
 // ============================================================================
@@ -62,6 +73,7 @@ protected:
 class Message {
 public:
     /// @brief 初始化指定大小的消息缓冲区
+    /// @details 内容未初始化（不清零），调用者随后整体写入
     /// @param size 缓冲区大小（字节）
     /// @throws std::bad_alloc 如果分配失败
     virtual void init(size_t size) = 0;
@@ -92,6 +104,32 @@ protected:
     Message& operator=(const Message&) = delete;
 };
 
+/// @brief 订阅者待读状态
+struct PendingInfo {
+    size_t messages = 0;                     ///< 待读消息数
+    size_t bytes = 0;                        ///< 待读负载字节数
+    std::chrono::nanoseconds oldest_age{0};  ///< 最旧待读消息的等待时间（0 表示未知）
+};
+
+/// @brief 话题新鲜度快照（供看门狗查询，不消费消息、不移动读指针）
+struct Freshness {
+    std::chrono::steady_clock::time_point newest_timestamp{};  ///< 最新消息的时间（纪元值表示未知）
+    size_t backlog_messages = 0;                               ///< 待读消息数
+    size_t backlog_bytes = 0;                                  ///< 待读负载字节数
+    uint64_t overruns = 0;                                     ///< 读者被写者覆盖（丢失消息）的次数
+
+    /// @brief 最新消息距今的时长
+    /// @param now 当前时间
+    /// @return 时长，未知时为 0
+    [[nodiscard]] std::chrono::nanoseconds newestAge(
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const noexcept {
+        if (newest_timestamp == std::chrono::steady_clock::time_point{}) {
+            return std::chrono::nanoseconds{0};
+        }
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now - newest_timestamp);
+    }
+};
+
 /// @brief 订阅者套接字抽象接口
 class SubSocket {
 public:
@@ -115,6 +153,34 @@ public:
     /// @param timeout 超时时间（毫秒），-1 表示无限等待
     virtual void setTimeout(int timeout) = 0;
 
+    /// @brief 设置抽取/限速订阅
+    /// @param every_nth 每 N 条只投递一条（1 表示全部投递）
+    /// @param max_rate_hz 最高投递频率，窗口内只投递最新一条（0 表示不限速）
+    /// @throws std::invalid_argument 如果 every_nth 为 0 或 max_rate_hz 为负
+    /// @note MSGQ 后端直接推进读指针，被跳过的消息不会复制到 Message；
+    ///       默认实现记下设置，由 receiveDecimated 照常接收后丢弃（Unix、组播后端）
+    virtual void setDecimation(uint32_t every_nth, double max_rate_hz = 0.0);
+
+    /// @brief 查询待读状态（只读游标与帧头，不复制消息、不发起系统调用）
+    /// @param info 输出：待读消息数、字节数与最旧消息等待时间
+    /// @return true 如果后端能提供，false 如果不支持
+    [[nodiscard]] virtual bool getPending(PendingInfo& info) const;
+
+    /// @brief 设置接收消息使用的内存资源
+    /// @details 例如每个周期开始时 release() 的 std::pmr::monotonic_buffer_resource，
+    ///          一个周期内收到的消息缓冲区在周期结束时一次性释放。
+    ///          资源必须比由它分配的所有消息活得更久。
+    /// @param resource 内存资源，nullptr 恢复为默认资源
+    /// @return true 如果后端使用该资源，false 如果后端仍使用全局分配器
+    virtual bool setMemoryResource(std::pmr::memory_resource* resource);
+
+    /// @brief 查询话题新鲜度：最新消息时间、积压与覆盖次数
+    /// @details 只读共享头部，不复制消息。默认实现只填积压（来自 getPending），
+    ///          最新消息时间未知、覆盖次数为 0；ZMQ 后端使用默认实现，
+    ///          Fake 后端沿用被包装后端的实现。
+    /// @return 新鲜度快照
+    [[nodiscard]] virtual Freshness freshness() const;
+
     /// @brief 从套接字接收消息
     /// @param non_blocking 非阻塞模式（true 时立即返回，无消息则返回 nullptr）
     /// @return 接收到的消息指针，或 nullptr 如果无消息
@@ -136,6 +202,7 @@ public:
     /// @param address IP 地址（默认为 127.0.0.1）
     /// @param conflate 是否合并消息
     /// @param check_endpoint 是否检查端点有效性
+    /// @param resource 接收消息使用的内存资源（nullptr 为默认资源），见 setMemoryResource
     /// @return 连接的套接字，或 nullptr 如果连接失败
     /// @throws std::invalid_argument 如果参数无效
     /// @throws std::runtime_error 如果连接失败
@@ -144,7 +211,27 @@ public:
         const std::string& endpoint,
         const std::string& address = "127.0.0.1",
         bool conflate = false,
-        bool check_endpoint = true);
+        bool check_endpoint = true,
+        std::pmr::memory_resource* resource = nullptr);
+
+    /// @brief 工厂方法：按注册的话题常量创建并连接子套接字
+    /// @param context 消息队列上下文（非空）
+    /// @param topic 话题常量（名称已在编译期校验）
+    /// @param address IP 地址（默认为 127.0.0.1）
+    /// @param conflate 是否合并消息
+    /// @param check_endpoint 是否检查端点有效性
+    /// @param resource 接收消息使用的内存资源（nullptr 为默认资源）
+    /// @return 连接的套接字，或 nullptr 如果连接失败
+    /// @throws std::runtime_error 如果连接失败
+    /// @note MSGQ 后端段大小固定为 DEFAULT_SEGMENT_SIZE 以兼容旧进程，
+    ///       topic.segment_size 只作用于 msgq::Queue
+    [[nodiscard]] static std::unique_ptr<SubSocket> create(
+        Context* context,
+        const TopicInfo& topic,
+        const std::string& address = "127.0.0.1",
+        bool conflate = false,
+        bool check_endpoint = true,
+        std::pmr::memory_resource* resource = nullptr);
 
     /// @brief 虚析构函数
     virtual ~SubSocket() = default;
@@ -153,6 +240,21 @@ protected:
     SubSocket() = default;
     SubSocket(const SubSocket&) = delete;
     SubSocket& operator=(const SubSocket&) = delete;
+
+    /// @brief 按 setDecimation 的设置接收一条消息（通用模拟）
+    /// @details 供不能在游标上跳过消息的后端在 receive() 中调用：被跳过的消息
+    ///          照常接收后释放。整个调用（包括限速窗口等待）共用一个截止时间。
+    /// @param timeout_ms 本次接收的超时（0 为非阻塞，-1 为无限等待）
+    /// @param receive_one 按给定毫秒数（语义同 timeout_ms）接收一条消息，超时返回 nullptr
+    /// @return 应投递的消息，或 nullptr 如果超时前没有
+    [[nodiscard]] std::unique_ptr<Message> receiveDecimated(
+        int timeout_ms, const std::function<std::unique_ptr<Message>(int)>& receive_one);
+
+private:
+    uint32_t decimation_every_nth = 1;                          ///< 抽取：每 N 条投递一条
+    uint32_t decimation_skip = 0;                               ///< 下一次投递前还需丢弃的消息数
+    std::chrono::steady_clock::duration decimation_interval{0};  ///< 限速：两次投递的最小间隔
+    std::chrono::steady_clock::time_point decimation_next;      ///< 限速窗口打开的时刻
 };
 
 /// @brief 发布者套接字抽象接口
@@ -185,6 +287,13 @@ public:
     /// @throws std::runtime_error 如果发送失败
     virtual int send(const char* data, size_t size) = 0;
 
+    /// @brief 分散-聚集发送：按顺序把多个片段作为一条消息发送
+    /// @param parts 片段列表（例如头部结构 + 若干数据块）
+    /// @return 发送的总字节数，-1 表示失败
+    /// @throws std::runtime_error 如果发送失败
+    /// @note 默认实现先拼接再调用 send()；后端应覆盖以直接聚集写入
+    virtual int sendv(span<const span<const char>> parts);
+
     /// @brief 检查所有读者是否已读取最新消息
     /// @return true 如果所有读者都已读取，false 否则
     [[nodiscard]] virtual bool all_readers_updated() const = 0;
@@ -220,6 +329,17 @@ public:
         int port,
         bool check_endpoint = true);
 
+    /// @brief 工厂方法：按注册的话题常量创建并连接发布者套接字
+    /// @param context 消息队列上下文（非空）
+    /// @param topic 话题常量（名称已在编译期校验）
+    /// @param check_endpoint 是否检查端点有效性
+    /// @return 连接的套接字
+    /// @throws std::runtime_error 如果连接失败
+    [[nodiscard]] static std::unique_ptr<PubSocket> create(
+        Context* context,
+        const TopicInfo& topic,
+        bool check_endpoint = true);
+
     /// @brief 虚析构函数
     virtual ~PubSocket() = default;
 
@@ -229,6 +349,12 @@ protected:
     PubSocket& operator=(const PubSocket&) = delete;
 };
 
+/// @brief 带待读状态的轮询结果
+struct PollResult {
+    SubSocket* socket = nullptr;  ///< 就绪的套接字
+    PendingInfo pending;          ///< 待读状态（后端不支持时 messages/bytes 为 0）
+};
+
 /// @brief 事件轮询器抽象接口
 class Poller {
 public:
@@ -237,12 +363,32 @@ public:
     /// @throws std::invalid_argument 如果 socket 为 nullptr
     virtual void registerSocket(SubSocket* socket) = 0;
 
+    /// @brief 带调度选项注册套接字
+    /// @param socket 套接字指针（非空）
+    /// @param options 优先级与可选截止时间
+    /// @throws std::invalid_argument 如果 socket 为 nullptr
+    void registerSocket(SubSocket* socket, const PollOptions& options);
+
+    /// @brief 设置防饿死上限：等待超过此时长的就绪套接字排到最前
+    /// @param limit 等待上限，0 表示关闭
+    void setStarvationLimit(std::chrono::milliseconds limit) noexcept {
+        scheduler_.set_starvation_limit(limit);
+    }
+
     /// @brief 轮询已注册的套接字
     /// @param timeout 超时时间（毫秒），-1 表示无限等待
-    /// @return 有消息可读的套接字列表
+    /// @return 有消息可读的套接字列表，按 PollScheduler 规则排序
+    ///         （超时/饿死者优先，其次优先级，再次等待时长）
     /// @throws std::runtime_error 如果轮询失败
     [[nodiscard]] virtual std::vector<SubSocket*> poll(int timeout) = 0;
 
+    /// @brief 轮询并附带每个就绪套接字的待读状态
+    /// @param timeout 超时时间（毫秒），-1 表示无限等待
+    /// @return 与 poll() 同序的结果；后端不提供消息时间戳时，
+    ///         oldest_age 取轮询器首次观察到该套接字就绪以来的时长
+    /// @throws std::runtime_error 如果轮询失败
+    [[nodiscard]] std::vector<PollResult> pollDetailed(int timeout);
+
     /// @brief 工厂方法：创建轮询器
     /// @return 持有新创建轮询器的 unique_ptr
     /// @throws std::bad_alloc 如果分配失败
@@ -263,6 +409,14 @@ protected:
     Poller() = default;
     Poller(const Poller&) = delete;
     Poller& operator=(const Poller&) = delete;
+
+    /// @brief 派生类在 poll() 返回前调用，按调度规则排序就绪列表
+    /// @param ready 本轮就绪的套接字（注册顺序）
+    void orderReady(std::vector<SubSocket*>& ready) {
+        scheduler_.order(ready);
+    }
+
+    PollScheduler scheduler_;  ///< 就绪排序状态
 };
 
 // ============================================================================
@@ -278,6 +432,16 @@ protected:
 /// @return true 如果配置了 CEREAL_FAKE 环境变量，false 否则
 [[nodiscard]] bool messaging_use_fake() noexcept;
 
+/// @brief 检查是否应使用 Unix 套接字后端（用于不能映射 /dev/shm 的沙箱进程）
+/// @return true 如果设置了 MSGQ_UNIX 环境变量（"0" 除外），false 否则
+/// @note 优先级：ZMQ > MSGQ_UNIX > MSGQ；定义在 unix_socket_modern.cc
+[[nodiscard]] bool messaging_use_unix() noexcept;
+
+/// @brief 检查是否应使用 UDP 组播后端（一次发送到达任意数量的订阅者）
+/// @return true 如果设置了 MSGQ_MULTICAST 环境变量（"0" 除外），false 否则
+/// @note 优先级：ZMQ > MSGQ_UNIX > MSGQ_MULTICAST > MSGQ；定义在 multicast_socket_modern.cc
+[[nodiscard]] bool messaging_use_multicast() noexcept;
+
 /// @brief 确定当前后端类型
 /// @return 对应的后端类型枚举
 [[nodiscard]] BackendType determine_backend_type() noexcept;
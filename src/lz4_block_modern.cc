@@ -0,0 +1,274 @@
+#include "lz4_block_modern.h"
+#include <algorithm>
+#include <cstring>
+
+namespace msgq {
+namespace lz4 {
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t LAST_LITERALS = 5;    // The block always ends in this many literals
+constexpr size_t MATCH_LIMIT = 12;     // No match may start this close to the end
+constexpr size_t MAX_DISTANCE = 65535;
+constexpr uint32_t RUN_MASK = 15;      // Length nibble that continues in extra bytes
+
+// Hash table of 2^bits recent positions; 4K entries (16 KiB, L1-resident)
+// for large inputs, fewer for small ones so clearing it stays cheap
+constexpr int MAX_HASH_BITS = 12;
+constexpr int MIN_HASH_BITS = 8;
+
+// Misses before the search step grows by one byte
+constexpr int SKIP_TRIGGER = 6;
+
+// Short copies in the decoder move this many bytes when both buffers have
+// room for it, instead of an exact-length memcpy call
+constexpr size_t WILD_COPY = 16;
+
+inline uint32_t load32(const unsigned char* p) noexcept {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t load64(const unsigned char* p) noexcept {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t hash(uint32_t sequence, int bits) noexcept {
+    return (sequence * 2654435761u) >> (32 - bits);
+}
+
+// Bytes two positions have in common, stopping at `limit`
+inline size_t common_length(const unsigned char* p, const unsigned char* match,
+                            const unsigned char* limit) noexcept {
+    const unsigned char* start = p;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (p + sizeof(uint64_t) <= limit) {
+        const uint64_t diff = load64(p) ^ load64(match);
+        if (diff != 0) {
+            return static_cast<size_t>(p - start) + (__builtin_ctzll(diff) >> 3);
+        }
+        p += sizeof(uint64_t);
+        match += sizeof(uint64_t);
+    }
+#endif
+    while (p < limit && *p == *match) {
+        p++;
+        match++;
+    }
+    return static_cast<size_t>(p - start);
+}
+
+// Extra length bytes after a saturated nibble: runs of 255 then the rest
+inline unsigned char* put_length(unsigned char* op, size_t length) noexcept {
+    for (; length >= 255; length -= 255) {
+        *op++ = 255;
+    }
+    *op++ = static_cast<unsigned char>(length);
+    return op;
+}
+
+// Bytes needed for a run of `literals` literals plus the worst-case match
+// that follows (offset and its own length bytes are checked separately)
+inline size_t literal_cost(size_t literals) noexcept {
+    return 1 + (literals >= RUN_MASK ? (literals - RUN_MASK) / 255 + 1 : 0) + literals;
+}
+
+} // namespace
+
+size_t compress(const char* src, size_t size, char* dst, size_t capacity) noexcept {
+    if (size > MAX_INPUT_SIZE) {
+        return 0;
+    }
+
+    const auto* const base = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* const end = base + size;
+    const unsigned char* anchor = base;
+    auto* op = reinterpret_cast<unsigned char*>(dst);
+    unsigned char* const oend = op + capacity;
+
+    if (size > MATCH_LIMIT) {
+        int bits = MIN_HASH_BITS;
+        while (bits < MAX_HASH_BITS && (size_t{1} << bits) < size / 4) {
+            bits++;
+        }
+        uint32_t table[size_t{1} << MAX_HASH_BITS];
+        std::memset(table, 0, sizeof(uint32_t) << bits);
+
+        const unsigned char* const match_start_limit = end - MATCH_LIMIT;
+        const unsigned char* const match_end_limit = end - LAST_LITERALS;
+        const unsigned char* ip = base + 1;
+
+        while (ip <= match_start_limit) {
+            // Find a match, stepping further on each miss
+            const unsigned char* match;
+            int misses = 1 << SKIP_TRIGGER;
+            for (;;) {
+                const uint32_t sequence = load32(ip);
+                uint32_t& slot = table[hash(sequence, bits)];
+                match = base + slot;
+                slot = static_cast<uint32_t>(ip - base);
+                if (match < ip && static_cast<size_t>(ip - match) <= MAX_DISTANCE && load32(match) == sequence) {
+                    break;
+                }
+                ip += misses++ >> SKIP_TRIGGER;
+                if (ip > match_start_limit) {
+                    goto last_literals;
+                }
+            }
+
+            // Grow the match backwards over pending literals
+            while (ip > anchor && match > base && ip[-1] == match[-1]) {
+                ip--;
+                match--;
+            }
+
+            const size_t literals = static_cast<size_t>(ip - anchor);
+            const size_t match_length = MIN_MATCH + common_length(ip + MIN_MATCH, match + MIN_MATCH, match_end_limit);
+            const size_t extra = match_length - MIN_MATCH;
+            const size_t needed = literal_cost(literals) + 2 +
+                                  (extra >= RUN_MASK ? (extra - RUN_MASK) / 255 + 1 : 0);
+            if (needed > static_cast<size_t>(oend - op)) {
+                return 0;
+            }
+
+            unsigned char* token = op++;
+            *token = static_cast<unsigned char>(std::min<size_t>(literals, RUN_MASK) << 4);
+            if (literals >= RUN_MASK) {
+                op = put_length(op, literals - RUN_MASK);
+            }
+            std::memcpy(op, anchor, literals);
+            op += literals;
+
+            const size_t distance = static_cast<size_t>(ip - match);
+            *op++ = static_cast<unsigned char>(distance);
+            *op++ = static_cast<unsigned char>(distance >> 8);
+
+            *token |= static_cast<unsigned char>(std::min<size_t>(extra, RUN_MASK));
+            if (extra >= RUN_MASK) {
+                op = put_length(op, extra - RUN_MASK);
+            }
+
+            ip += match_length;
+            anchor = ip;
+
+            // Index a position inside the match so the next one can chain on
+            if (ip <= match_start_limit) {
+                table[hash(load32(ip - 2), bits)] = static_cast<uint32_t>(ip - 2 - base);
+            }
+        }
+    }
+
+last_literals:
+    const size_t literals = static_cast<size_t>(end - anchor);
+    if (literal_cost(literals) > static_cast<size_t>(oend - op)) {
+        return 0;
+    }
+    *op++ = static_cast<unsigned char>(std::min<size_t>(literals, RUN_MASK) << 4);
+    if (literals >= RUN_MASK) {
+        op = put_length(op, literals - RUN_MASK);
+    }
+    if (literals != 0) {
+        std::memcpy(op, anchor, literals);
+    }
+    op += literals;
+    return static_cast<size_t>(op - reinterpret_cast<unsigned char*>(dst));
+}
+
+bool decompress(const char* src, size_t size, char* dst, size_t raw_size) noexcept {
+    const auto* ip = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* const iend = ip + size;
+    auto* const obase = reinterpret_cast<unsigned char*>(dst);
+    unsigned char* op = obase;
+    unsigned char* const oend = op + raw_size;
+
+    while (ip < iend) {
+        const uint32_t token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == RUN_MASK) {
+            unsigned char more;
+            do {
+                if (ip == iend) return false;
+                more = *ip++;
+                literals += more;
+            } while (more == 255);
+        }
+        if (literals > static_cast<size_t>(iend - ip) || literals > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+        if (literals <= WILD_COPY && iend - ip >= static_cast<ptrdiff_t>(WILD_COPY) &&
+            oend - op >= static_cast<ptrdiff_t>(WILD_COPY)) {
+            std::memcpy(op, ip, WILD_COPY);  // Fixed size: one unaligned load and store
+        } else if (literals != 0) {
+            std::memcpy(op, ip, literals);
+        }
+        op += literals;
+        ip += literals;
+
+        if (ip == iend) {
+            break;  // The last sequence has no match
+        }
+
+        if (iend - ip < 2) return false;
+        const size_t distance = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (distance == 0 || distance > static_cast<size_t>(op - obase)) {
+            return false;
+        }
+
+        size_t match_length = token & RUN_MASK;
+        if (match_length == RUN_MASK) {
+            unsigned char more;
+            do {
+                if (ip == iend) return false;
+                more = *ip++;
+                match_length += more;
+            } while (more == 255);
+        }
+        match_length += MIN_MATCH;
+        if (match_length > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+
+        const unsigned char* match = op - distance;
+        if (oend - op >= static_cast<ptrdiff_t>(match_length + WILD_COPY)) {
+            // Word copies may overrun the match into bytes written later,
+            // so every source word must lie a whole word behind its
+            // destination. A short distance is a repeating pattern: write
+            // one period of at least a word byte by byte, then copy words
+            // from that period back.
+            unsigned char* const copy_end = op + match_length;
+            if (distance < sizeof(uint64_t)) {
+                const size_t period = distance * ((sizeof(uint64_t) + distance - 1) / distance);
+                const size_t head = std::min(period, match_length);
+                for (size_t i = 0; i < head; ++i) {
+                    op[i] = match[i];
+                }
+                op += head;
+                match = op - period;
+            }
+            while (op < copy_end) {
+                std::memcpy(op, match, sizeof(uint64_t));
+                op += sizeof(uint64_t);
+                match += sizeof(uint64_t);
+            }
+            op = copy_end;
+        } else if (distance >= match_length) {
+            std::memcpy(op, match, match_length);
+            op += match_length;
+        } else {
+            // Near the end of the output: exact byte copy
+            for (size_t i = 0; i < match_length; ++i) {
+                *op++ = match[i];
+            }
+        }
+    }
+    return op == oend;
+}
+
+} // namespace lz4
+} // namespace msgq
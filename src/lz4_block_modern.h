@@ -0,0 +1,41 @@
+#pragma once
+
+/*
+ * LZ4-class block codec for compressing message payloads
+ *
+ * Writes and reads the LZ4 block format (token, literals, 16-bit offset,
+ * match length; last five bytes always literals), so frames can be handed
+ * to any LZ4 decoder. The compressor is the single-pass greedy kind: one
+ * hash table of recent 4-byte sequences, no chain search, and a skip step
+ * that grows on incompressible input so it stays near memcpy speed there.
+ * Bundled so the tree builds offline without liblz4.
+ *
+ * Self-contained (no msgq_modern.h / msgq.h) like crc32c_modern.h.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace msgq {
+namespace lz4 {
+
+// Largest input compress() accepts (the LZ4 format limit)
+constexpr size_t MAX_INPUT_SIZE = 0x7E000000;
+
+// Worst-case compressed size of `size` bytes of incompressible input
+[[nodiscard]] constexpr size_t compress_bound(size_t size) noexcept {
+    return size + size / 255 + 16;
+}
+
+// Compress `size` bytes at `src` into `dst`, which has room for `capacity`
+// bytes. Returns the block size, or 0 if the block does not fit or the
+// input is larger than MAX_INPUT_SIZE. compress_bound(size) always fits.
+[[nodiscard]] size_t compress(const char* src, size_t size, char* dst, size_t capacity) noexcept;
+
+// Decode a block of `size` bytes at `src` into exactly `raw_size` bytes at
+// `dst`. Never reads or writes out of bounds; returns false on a malformed
+// block or if it does not expand to `raw_size` bytes.
+[[nodiscard]] bool decompress(const char* src, size_t size, char* dst, size_t raw_size) noexcept;
+
+} // namespace lz4
+} // namespace msgq
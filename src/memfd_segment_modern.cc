@@ -0,0 +1,273 @@
+#include "memfd_segment_modern.h"
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace msgq {
+
+namespace {
+
+constexpr int RECV_TIMEOUT_SEC = 1;
+constexpr int MAX_OPEN_ATTEMPTS = 3;
+
+// A reply carries the memfd and the listening socket, in that order
+constexpr size_t SEGMENT_FDS = 2;
+
+std::string errno_string() {
+    return std::string(strerror(errno));
+}
+
+void close_fd(int& fd) noexcept {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+socklen_t make_abstract_address(const std::string& address, sockaddr_un& addr) {
+    if (address.size() + 1 > sizeof(addr.sun_path)) {
+        throw std::invalid_argument("Segment address too long: " + address);
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    // sun_path[0] == '\0' selects the abstract namespace
+    std::memcpy(addr.sun_path + 1, address.data(), address.size());
+    return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + address.size());
+}
+
+// Connect to a served segment and receive its fd and the listening socket
+// it is served on. Returns false if nobody is serving `address`.
+bool attach_segment(const std::string& address, size_t expected_size, int& fd, int& listen_fd) {
+    int sock = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        throw std::runtime_error("Failed to create segment socket: " + errno_string());
+    }
+
+    sockaddr_un addr;
+    socklen_t len = make_abstract_address(address, addr);
+    if (::connect(sock, reinterpret_cast<sockaddr*>(&addr), len) < 0) {
+        int err = errno;
+        ::close(sock);
+        if (err == ECONNREFUSED || err == ENOENT) {
+            return false;
+        }
+        throw std::runtime_error("Failed to connect to segment '" + address + "': " + strerror(err));
+    }
+
+    timeval tv = {RECV_TIMEOUT_SEC, 0};
+    ::setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    uint64_t size = 0;
+    iovec iov = {&size, sizeof(size)};
+    alignas(cmsghdr) char control[CMSG_SPACE(SEGMENT_FDS * sizeof(int))];
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = ::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    int err = errno;
+    ::close(sock);
+    if (n != static_cast<ssize_t>(sizeof(size))) {
+        // The holder that accepted went away before replying: the next
+        // connect reaches another holder, or nobody
+        if (n == 0 || err == ECONNRESET) return false;
+        throw std::runtime_error("Failed to receive segment '" + address + "': " + strerror(err));
+    }
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        throw std::runtime_error("Segment '" + address + "' reply carried no fd");
+    }
+    int fds[SEGMENT_FDS] = {-1, -1};
+    const size_t received = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    std::memcpy(fds, CMSG_DATA(cmsg), std::min<size_t>(received, SEGMENT_FDS) * sizeof(int));
+
+    if (received != SEGMENT_FDS || size != expected_size) {
+        close_fd(fds[0]);
+        close_fd(fds[1]);
+        if (received != SEGMENT_FDS) {
+            throw std::runtime_error("Segment '" + address + "' reply carried " + std::to_string(received) +
+                                     " fds, expected " + std::to_string(SEGMENT_FDS));
+        }
+        throw std::runtime_error("Segment '" + address + "' has size " + std::to_string(size) +
+                                 ", expected " + std::to_string(expected_size));
+    }
+    fd = fds[0];
+    listen_fd = fds[1];
+    return true;
+}
+
+int create_sealed_memfd(std::string_view name, size_t size) {
+    std::string label = "msgq:" + std::string(name);
+    int fd = ::memfd_create(label.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        throw std::runtime_error("memfd_create failed: " + errno_string());
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size)) < 0 ||
+        ::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("Failed to size and seal memfd: " + std::string(strerror(err)));
+    }
+    return fd;
+}
+
+} // namespace
+
+bool messaging_use_memfd() noexcept {
+    const char* value = std::getenv("MSGQ_MEMFD");
+    return value != nullptr && std::strcmp(value, "0") != 0;
+}
+
+std::string segment_socket_address(std::string_view name) {
+    if (name.empty()) {
+        throw std::invalid_argument("Segment name cannot be empty");
+    }
+    if (name.find('/') != std::string_view::npos || name.find('\0') != std::string_view::npos) {
+        throw std::invalid_argument("Segment name cannot contain '/' or NUL: " + std::string(name));
+    }
+
+    std::string address = "msgq/";
+    if (const char* prefix = std::getenv("OPENPILOT_PREFIX"); prefix != nullptr && *prefix != '\0') {
+        address += prefix;
+    }
+    address += '/';
+    address += name;
+    return address;
+}
+
+std::unique_ptr<MemfdSegment> MemfdSegment::open(std::string_view name, size_t size) {
+    const std::string address = segment_socket_address(name);
+
+    for (int attempt = 0; attempt < MAX_OPEN_ATTEMPTS; ++attempt) {
+        int fd = -1;
+        int listen_fd = -1;
+        if (attach_segment(address, size, fd, listen_fd)) {
+            std::unique_ptr<MemfdSegment> segment(new MemfdSegment(fd, size));
+            segment->listen_fd_ = listen_fd;
+            segment->start_serving();
+            return segment;
+        }
+
+        std::unique_ptr<MemfdSegment> segment(new MemfdSegment(create_sealed_memfd(name, size), size));
+        if (segment->bind_address(address)) {
+            segment->created_ = true;
+            segment->start_serving();
+            return segment;
+        }
+        // Lost the race to another creator; attach to theirs instead
+    }
+
+    throw std::runtime_error("Failed to open memfd segment '" + address + "'");
+}
+
+bool MemfdSegment::bind_address(const std::string& address) {
+    // Non-blocking: every holder polls the same socket, and another one
+    // may accept the connection that woke us
+    listen_fd_ = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("Failed to create segment socket: " + errno_string());
+    }
+
+    sockaddr_un addr;
+    socklen_t len = make_abstract_address(address, addr);
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), len) < 0) {
+        int err = errno;
+        close_fd(listen_fd_);
+        if (err == EADDRINUSE) {
+            return false;
+        }
+        throw std::runtime_error("Failed to bind segment '" + address + "': " + strerror(err));
+    }
+    if (::listen(listen_fd_, SOMAXCONN) < 0) {
+        int err = errno;
+        close_fd(listen_fd_);
+        throw std::runtime_error("Failed to listen on segment '" + address + "': " + strerror(err));
+    }
+    return true;
+}
+
+void MemfdSegment::start_serving() {
+    stop_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (stop_fd_ < 0) {
+        throw std::runtime_error("Failed to create eventfd: " + errno_string());
+    }
+    server_ = std::thread(&MemfdSegment::serve_loop, this);
+}
+
+void MemfdSegment::serve_loop() noexcept {
+    const uid_t self_uid = ::geteuid();
+
+    for (;;) {
+        pollfd fds[2] = {{listen_fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents) {
+            return;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        // EAGAIN: another holder took this connection
+        int conn = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (conn < 0) {
+            continue;
+        }
+
+        // Only hand the segment to processes of the same user (or root)
+        ucred cred = {};
+        socklen_t cred_len = sizeof(cred);
+        if (::getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) == 0 &&
+            (cred.uid == self_uid || cred.uid == 0)) {
+            uint64_t size = size_;
+            iovec iov = {&size, sizeof(size)};
+            alignas(cmsghdr) char control[CMSG_SPACE(SEGMENT_FDS * sizeof(int))] = {};
+            msghdr msg = {};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(SEGMENT_FDS * sizeof(int));
+            // The peer becomes a holder too and keeps the address bound
+            const int fds[SEGMENT_FDS] = {fd_, listen_fd_};
+            std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+            ::sendmsg(conn, &msg, MSG_NOSIGNAL);
+        }
+        ::close(conn);
+    }
+}
+
+MemfdSegment::~MemfdSegment() {
+    if (server_.joinable()) {
+        uint64_t one = 1;
+        (void)::write(stop_fd_, &one, sizeof(one));
+        server_.join();
+    }
+    close_fd(listen_fd_);
+    close_fd(stop_fd_);
+    close_fd(fd_);
+}
+
+} // namespace msgq
@@ -0,0 +1,75 @@
+#pragma once
+
+/*
+ * Anonymous shared-memory segments backed by memfd_create(2)
+ *
+ * Instead of a named file under /dev/shm, the first process that opens a
+ * segment creates a sealed memfd and serves it on an abstract unix socket.
+ * Every later opener connects to that socket and receives, through
+ * SCM_RIGHTS, the memfd and the listening socket itself. Every holder
+ * serves from that shared socket, so the address stays bound for as long
+ * as anyone has the segment: whoever exits first, a later opener always
+ * reaches the same memory and never creates a second, unconnected one.
+ * Nothing is left on the filesystem: the memory and the address are
+ * released when the last holder goes away.
+ *
+ * This header is deliberately self-contained (no msgq_modern.h / msgq.h)
+ * so both the modern Queue and the legacy msgq_queue_t path can use it.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace msgq {
+
+// Environment switch for memfd segments (MSGQ_MEMFD=1)
+[[nodiscard]] bool messaging_use_memfd() noexcept;
+
+// Rendezvous address of a segment in the abstract unix socket namespace,
+// without the leading NUL. OPENPILOT_PREFIX is a separate path component,
+// so "a" under prefix "b" never aliases "b/a" without a prefix.
+// Throws std::invalid_argument for empty names or names containing '/'.
+[[nodiscard]] std::string segment_socket_address(std::string_view name);
+
+class MemfdSegment {
+public:
+    // Attach to the segment served under `name`, or create it (sealed at
+    // `size` bytes) if nobody holds it; either way this process serves it
+    // too from then on.
+    // Throws std::runtime_error if the segment cannot be created or the
+    // served segment has a different size.
+    [[nodiscard]] static std::unique_ptr<MemfdSegment> open(std::string_view name, size_t size);
+
+    // Non-copyable, non-movable (the server thread refers to this object)
+    MemfdSegment(const MemfdSegment&) = delete;
+    MemfdSegment& operator=(const MemfdSegment&) = delete;
+
+    // Stops serving from this process; the other holders keep serving and
+    // existing mappings stay valid
+    ~MemfdSegment();
+
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    // True if this process created the segment (as opposed to attaching)
+    [[nodiscard]] bool is_owner() const noexcept { return created_; }
+
+private:
+    MemfdSegment(int fd, size_t size) noexcept : fd_(fd), size_(size) {}
+
+    bool bind_address(const std::string& address);
+    void start_serving();
+    void serve_loop() noexcept;
+
+    int fd_ = -1;
+    size_t size_ = 0;
+    bool created_ = false;
+    int listen_fd_ = -1;  // Shared by every holder of the segment
+    int stop_fd_ = -1;
+    std::thread server_;
+};
+
+} // namespace msgq
@@ -0,0 +1,173 @@
+#include "msgq_modern.h"
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// msgq_drain_bench - 积压消息的排空吞吐，对比不同的预取距离
+//
+// 用法: msgq_drain_bench [--size B] [--ring MB] [--distances D1,D2,...] [--rounds R] [--work N]
+//   发布者向 MB 兆字节的环写入 B 字节的小消息直到接近写满（订阅者不读），
+//   再用末级缓存两倍大的缓冲区把环挤出缓存，然后计时 Queue::drain() 把
+//   积压全部取完。每个预取距离（SubscriberOptions::prefetch_distance，字节，
+//   0 为关闭）测 R 轮取最好的一轮（各距离在每轮内轮流测，机器状态的漂移对
+//   它们一视同仁），打印消息吞吐与每条耗时。
+//   接收缓冲来自每轮重置的单调内存池，计时里几乎只剩读环本身。
+//   --work N 让回调每条消息再随机读 N 次大表（模拟解码查表），硬件流预取器
+//   因此跟丢顺序读环，软件预取的作用才显现出来。
+// 编译: g++ -O2 -std=c++17 msgq_modern.cc memfd_segment_modern.cc crc32c_modern.cc lz4_block_modern.cc
+//       buffer_pool_modern.cc msgq_drain_bench.cc -pthread -o msgq_drain_bench
+// ============================================================================
+
+namespace {
+
+constexpr size_t MIN_EVICT_BYTES = 64 * 1024 * 1024;
+
+struct Result {
+    size_t messages = 0;
+    double seconds = 0;
+};
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [--size B] [--ring MB] [--distances D1,D2,...] [--rounds R]"
+              << " [--work N]" << std::endl;
+}
+
+std::vector<size_t> parse_distances(const char* text) {
+    std::vector<size_t> distances;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        distances.push_back(std::strtoull(item.c_str(), nullptr, 10));
+    }
+    return distances;
+}
+
+// Twice the last level cache, so streaming through it pushes the ring out
+size_t evict_bytes() {
+    const long llc = ::sysconf(_SC_LEVEL3_CACHE_SIZE);
+    return std::max(MIN_EVICT_BYTES, llc > 0 ? static_cast<size_t>(llc) * 2 : 0);
+}
+
+// Streams through a buffer bigger than the cache so the ring starts cold
+void evict_caches(std::vector<char>& buffer) {
+    for (size_t i = 0; i < buffer.size(); i += 64) {
+        buffer[i] = static_cast<char>(buffer[i] + 1);
+    }
+}
+
+Result measure(const std::string& queue_name, size_t ring, size_t payload, size_t distance, int work,
+               std::vector<char>& evict, std::vector<char>& arena_buffer) {
+    // Leave a margin so the writer never laps the idle reader
+    const size_t record = msgq::align_to_8(msgq::TOPIC_RECORD_OVERHEAD + payload);
+    const size_t count = ring / record * 9 / 10;
+
+    std::pmr::monotonic_buffer_resource arena(arena_buffer.data(), arena_buffer.size(),
+                                              std::pmr::new_delete_resource());
+    msgq::SubscriberOptions options;
+    options.prefetch_distance = distance;
+    options.memory_resource = &arena;
+
+    // A memfd segment leaves nothing behind in /dev/shm
+    msgq::Queue sub_queue = msgq::Queue::create(queue_name, ring, msgq::SegmentMode::Memfd);
+    sub_queue.init_subscriber(options);
+    msgq::Queue pub_queue = msgq::Queue::create(queue_name, ring, msgq::SegmentMode::Memfd);
+    pub_queue.init_publisher();
+
+    std::vector<char> data(payload);
+    for (size_t i = 0; i < count; ++i) {
+        std::memcpy(data.data(), &i, std::min(sizeof(i), payload));
+        pub_queue.send(gsl::span<const char>(data.data(), data.size()));
+    }
+    evict_caches(evict);
+
+    size_t checksum = 0;
+    uint64_t lcg = 1;
+    const auto start = std::chrono::steady_clock::now();
+    const size_t drained = sub_queue.drain([&](msgq::Message& msg) {
+        checksum += static_cast<unsigned char>(msg.data_ptr()[0]);
+        // Random lookups in the (cold) eviction buffer
+        for (int i = 0; i < work; ++i) {
+            lcg = lcg * 6364136223846793005ULL + 1442695040888963407ULL;
+            checksum += static_cast<unsigned char>(evict[(lcg >> 16) % evict.size()]);
+        }
+    });
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    if (drained != count) {
+        throw msgq::MessageQueueError("Drained " + std::to_string(drained) + " of " + std::to_string(count) +
+                                      " messages (checksum " + std::to_string(checksum) + ")");
+    }
+    Result result;
+    result.messages = drained;
+    result.seconds = std::chrono::duration<double>(elapsed).count();
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t payload = 64;
+    size_t ring_mb = 64;
+    int rounds = 5;
+    int work = 0;
+    std::vector<size_t> distances = {0, 64, 128, 256, 512, 1024};
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            payload = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else if (std::strcmp(argv[i], "--ring") == 0 && i + 1 < argc) {
+            ring_mb = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        } else if (std::strcmp(argv[i], "--distances") == 0 && i + 1 < argc) {
+            distances = parse_distances(argv[++i]);
+        } else if (std::strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--work") == 0 && i + 1 < argc) {
+            work = std::max(std::atoi(argv[++i]), 0);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    try {
+        const size_t ring = ring_mb * 1024 * 1024;
+        const std::string queue_name = "drain_bench_" + std::to_string(::getpid());
+        std::vector<char> evict(evict_bytes(), 1);
+        // Holds every Message of a round, so the arena never goes upstream
+        std::vector<char> arena_buffer(ring * 2);
+
+        // Distances take turns within each round, so drift in the machine
+        // (frequency, neighbours) hits them all alike
+        std::vector<Result> best(distances.size());
+        for (int round = 0; round < rounds; ++round) {
+            for (size_t i = 0; i < distances.size(); ++i) {
+                const Result r = measure(queue_name, ring, payload, distances[i], work, evict, arena_buffer);
+                if (best[i].messages == 0 || r.seconds < best[i].seconds) {
+                    best[i] = r;
+                }
+            }
+        }
+
+        std::printf("%zu-byte messages, %zu MiB ring, %d lookup(s) per message, best of %d\n", payload, ring_mb,
+                    work, rounds);
+        std::printf("%10s %10s %12s %10s\n", "prefetch", "messages", "Mmsg/s", "ns/msg");
+        for (size_t i = 0; i < distances.size(); ++i) {
+            std::printf("%10zu %10zu %12.2f %10.1f\n", distances[i], best[i].messages,
+                        best[i].messages / best[i].seconds / 1e6, best[i].seconds * 1e9 / best[i].messages);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -84,8 +84,8 @@ void example_exception_safety() {
         auto queue = msgq::Queue::create("example3", 10 * 1024 * 1024);
         queue.init_publisher();
         
-        // 尝试发送过大的消息
-        msgq::Message large_msg(10 * 1024 * 1024);  // 10MB (改小以便测试)
+        // 超过段大小的消息会被自动分片发送（订阅端透明重组）
+        msgq::Message large_msg(10 * 1024 * 1024);  // 10MB
         queue.send(large_msg);
         
     }  // ✅ 即使异常被抛出，资源也自动清理
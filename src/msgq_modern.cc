@@ -1,15 +1,42 @@
 #include "msgq_modern.h"
+#include "memfd_segment_modern.h"
+#include "crc32c_modern.h"
+#include "lz4_block_modern.h"
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <linux/futex.h>
+#include <dirent.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <mutex>
+#include <random>
+#include <optional>
+#include <set>
+#include <thread>
+#include <unordered_set>
 #include <stdexcept>
 #include <memory>
+#include <utility>
 
 namespace msgq {
 
+SegmentMode default_segment_mode() noexcept {
+    return messaging_use_memfd() ? SegmentMode::Memfd : SegmentMode::SharedFile;
+}
+
 // ============================================================================
 // RAII Guard implementations
 // ============================================================================
@@ -29,145 +56,1367 @@ void FdGuard::cleanup() noexcept {
     }
 }
 
+// ============================================================================
+// Shared segment
+// ============================================================================
+
+SharedSegment::SharedSegment() noexcept = default;
+SharedSegment::SharedSegment(SharedSegment&&) noexcept = default;
+SharedSegment& SharedSegment::operator=(SharedSegment&&) noexcept = default;
+SharedSegment::~SharedSegment() = default;
+
+SharedSegment SharedSegment::open(std::string_view name, size_t size, SegmentMode mode) {
+    if (mode == SegmentMode::Memfd) {
+        return open(name, nullptr, size, mode);
+    }
+    const std::string shm_path = std::string(TOPIC_PATH_PREFIX) + std::string(name);
+    return open(name, shm_path.c_str(), size, mode);
+}
+
+SharedSegment SharedSegment::open(std::string_view name, const char* path, size_t size, SegmentMode mode) {
+    SharedSegment segment;
+    int fd = -1;
+
+    if (mode == SegmentMode::Memfd) {
+        // Attach to (or create and serve) a sealed anonymous segment;
+        // nothing is left under /dev/shm once the last mapping goes away
+        try {
+            segment.memfd_ = MemfdSegment::open(name, size);
+        } catch (const std::exception& e) {
+            throw MessageQueueError("Failed to open memfd segment: " + std::string(e.what()));
+        }
+        fd = segment.memfd_->fd();
+    } else {
+        // Create or open shared memory object
+        for (;;) {
+            FdGuard file(::open(path, O_CREAT | O_RDWR, 0666));
+            if (!file.valid()) {
+                throw MessageQueueError("Failed to open shared memory: " + std::string(strerror(errno)));
+            }
+
+            // Shared lock for as long as the segment is open: the reaper only
+            // unlinks segments it can lock exclusively. If it unlinked this
+            // file while we waited for the lock, start over with a fresh one.
+            if (::flock(file.get(), LOCK_SH) < 0) {
+                throw MessageQueueError("Failed to lock shared memory: " + std::string(strerror(errno)));
+            }
+            struct stat st;
+            if (::fstat(file.get(), &st) < 0) {
+                throw MessageQueueError("Failed to stat shared memory: " + std::string(strerror(errno)));
+            }
+            if (st.st_nlink == 0) {
+                continue;
+            }
+
+            // Only size a new (empty) file: truncating one that is already
+            // in use with other geometry would pull pages out from under
+            // its readers. Re-check in case another opener sized it first.
+            if (st.st_size == 0 && ::ftruncate(file.get(), size) < 0) {
+                throw MessageQueueError("Failed to truncate shared memory");
+            }
+            if (st.st_size == 0 && ::fstat(file.get(), &st) < 0) {
+                throw MessageQueueError("Failed to stat shared memory: " + std::string(strerror(errno)));
+            }
+            if (static_cast<size_t>(st.st_size) != size) {
+                throw MessageQueueError("Shared memory '" + std::string(name) + "' has size " +
+                                        std::to_string(st.st_size) + ", expected " + std::to_string(size));
+            }
+
+            segment.fd_ = std::move(file);
+            fd = segment.fd_.get();
+            break;
+        }
+    }
+
+    // Map into memory
+    void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        throw MessageQueueError("Failed to mmap shared memory");
+    }
+    segment.map_ = MmapGuard(addr, size);
+    return segment;
+}
+
 // ============================================================================
 // Low-level queue implementation (opaque to user)
 // ============================================================================
 
+namespace {
+
+// Identifies a segment laid out as SegmentHeader ("MSGQSEG2", little endian).
+// Bumped on every change to the header or the record framing, so an older
+// build refuses a segment it would misread: 2 added the slot tokens and
+// the padding records of PublisherOptions::record_alignment.
+constexpr uint64_t SEGMENT_MAGIC = 0x324745535147534dULL;
+
+// True if `pid` names a running process (EPERM still means it exists)
+bool process_alive(pid_t pid) noexcept {
+    if (pid <= 0) return false;
+    return ::kill(pid, 0) == 0 || errno == EPERM;
+}
+
+// Frame in front of every record in the ring (8-byte aligned)
+struct RecordHeader {
+    uint32_t size;         // Payload bytes, or WRAP_MARKER
+    uint32_t flags;        // RECORD_* bits
+    uint32_t fragment;     // Index within a chunked message
+    uint32_t sequence;     // Message number; all fragments of a message share it
+    uint64_t tag;          // Publisher-chosen tag matched against TagFilter, 0 if untagged
+    int64_t timestamp_ns;  // Send time on CLOCK_MONOTONIC
+    uint32_t checksum;     // CRC-32C of the payload if RECORD_CHECKSUM is set
+    uint32_t reserved;
+};
+
+static_assert(sizeof(RecordHeader) % 8 == 0, "records are 8-byte aligned");
+static_assert(sizeof(RecordHeader) == TOPIC_RECORD_OVERHEAD, "topic sizes are derived from the header size");
+
+// Record size marking the rest of the ring as unused until the next cycle
+constexpr uint32_t WRAP_MARKER = UINT32_MAX;
+
+int64_t monotonic_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Record is one fragment of a message larger than the ring. Fragment 0
+// starts with the uint64_t total message size.
+constexpr uint32_t RECORD_FRAGMENT = 1u << 0;
+constexpr uint32_t RECORD_LAST_FRAGMENT = 1u << 1;
+
+// Record carries a CRC-32C of its payload that readers verify
+constexpr uint32_t RECORD_CHECKSUM = 1u << 2;
+
+// Payload is a compress_frame() frame (size prefix + LZ4 block); set on
+// every fragment of a chunked message
+constexpr uint32_t RECORD_COMPRESSED = 1u << 3;
+
+// Filler in front of a record that keeps its payload on the publisher's
+// record_alignment; readers step over it like a filtered record. Its
+// sequence and timestamp are those of the record it precedes.
+constexpr uint32_t RECORD_PADDING = 1u << 4;
+
+// Checksummed copies go in slices this big, so the CRC reads back bytes
+// that are still in cache from the memcpy
+constexpr size_t CHECKSUM_SLICE = 64 * 1024;
+
+// Copy `size` bytes to `dst`; with `checksum` set, extend `crc` over them
+// one CHECKSUM_SLICE at a time. Returns the CRC (`crc` if not computed).
+uint32_t copy_with_crc(char* dst, const char* src, size_t size, bool checksum, uint32_t crc = 0) noexcept {
+    if (size == 0) {
+        return crc;
+    }
+    if (!checksum) {
+        memcpy(dst, src, size);
+        return crc;
+    }
+    for (size_t done = 0; done < size; done += CHECKSUM_SLICE) {
+        const size_t n = std::min(CHECKSUM_SLICE, size - done);
+        memcpy(dst + done, src + done, n);
+        crc = crc32c(dst + done, n, crc);
+    }
+    return crc;
+}
+
+// How long a chunked send waits for a live reader to make room before
+// lapping it, and how often it rechecks the read pointers
+constexpr auto CHUNK_STALL_TIMEOUT = std::chrono::milliseconds(1000);
+constexpr auto CHUNK_POLL_INTERVAL = std::chrono::microseconds(50);
+
+// Empty-queue checks a blocking receive makes before sleeping on the futex;
+// short enough to cost little, long enough to catch back-to-back replies
+constexpr int RECV_SPIN_COUNT = 200;
+
+// Futex words live in a MAP_SHARED segment, so no FUTEX_PRIVATE_FLAG
+void futex_wait(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout) noexcept {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+void futex_wake_all(std::atomic<uint32_t>& word) noexcept {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// Layout at the start of every queue segment
+struct SegmentHeader {
+    std::atomic<uint64_t> magic;  // SEGMENT_MAGIC once initialized
+    std::atomic<uint64_t> write_index;    // PackedPointer(wrap cycle, offset)
+    std::atomic<uint64_t> write_reserve;  // Absolute end of the region being written
+    std::atomic<uint64_t> read_index[NUM_READERS];
+    std::atomic<uint32_t> num_readers;  // Reader slots ever taken; closed readers' slots are reused
+    uint32_t reader_uid;
+    uint64_t segment_size;
+    // Owners recorded for the reaper; 0 when the slot is unused
+    std::atomic<int32_t> writer_pid;
+    std::atomic<int32_t> reader_pids[NUM_READERS];
+    // Per-reader tag filters, so the writer only wakes readers that want
+    // the record it just wrote
+    std::atomic<uint64_t> reader_tag_mask[NUM_READERS];
+    std::atomic<uint64_t> reader_tag_value[NUM_READERS];
+    // Bumped when a matching record is written; blocked readers sleep on it
+    std::atomic<uint32_t> reader_wake[NUM_READERS];
+    std::atomic<uint32_t> sleeping_readers;
+    std::atomic<uint32_t> write_sequence;  // Sequence of the next message
+    std::atomic<int64_t> last_write_ns;    // Send time of the newest complete message
+    // Records each reader dropped because their checksum did not match
+    std::atomic<uint64_t> reader_checksum_errors[NUM_READERS];
+    std::atomic<uint32_t> record_alignment;  // Current publisher's payload alignment, 0 before one attached
+    // Identify the Queue that took each slot within its process
+    std::atomic<uint64_t> reader_tokens[NUM_READERS];
+    std::atomic<uint64_t> writer_token;
+};
+
+// Queue objects open in this process, by token. The pid in a slot cannot
+// tell those from a slot our pid left behind (a Queue that was leaked, or
+// a process that exec'd), so a slot carrying our own pid is only live if
+// its token is here.
+struct LocalQueues {
+    std::mutex mutex;
+    std::unordered_set<uint64_t> tokens;
+    std::mt19937_64 rng{std::random_device{}()};
+};
+
+LocalQueues& local_queues() {
+    static LocalQueues queues;
+    return queues;
+}
+
+uint64_t add_local_queue() {
+    auto& queues = local_queues();
+    std::lock_guard<std::mutex> lock(queues.mutex);
+    uint64_t token;
+    do {
+        token = queues.rng();
+    } while (token == 0 || !queues.tokens.insert(token).second);
+    return token;
+}
+
+void remove_local_queue(uint64_t token) {
+    auto& queues = local_queues();
+    std::lock_guard<std::mutex> lock(queues.mutex);
+    queues.tokens.erase(token);
+}
+
+// True if the Queue that recorded `pid` and `token` in a slot may still
+// use it: its process runs and, when that is this process, it is open
+bool holder_alive(pid_t pid, uint64_t token) {
+    if (pid != ::getpid()) {
+        return process_alive(pid);
+    }
+    auto& queues = local_queues();
+    std::lock_guard<std::mutex> lock(queues.mutex);
+    return queues.tokens.count(token) != 0;
+}
+
+bool reader_alive(const SegmentHeader& header, size_t slot) {
+    return holder_alive(header.reader_pids[slot].load(std::memory_order_acquire),
+                        header.reader_tokens[slot].load(std::memory_order_acquire));
+}
+
+// The data area starts on MAX_RECORD_ALIGNMENT, so a ring offset is
+// aligned exactly when the address is
+constexpr size_t DATA_OFFSET = (sizeof(SegmentHeader) + MAX_RECORD_ALIGNMENT - 1) & ~(MAX_RECORD_ALIGNMENT - 1);
+
+// Forwards to `upstream` with at least `alignment`: received Messages are
+// vectors of char, which only ask for alignof(char)
+class AlignedResource final : public std::pmr::memory_resource {
+public:
+    AlignedResource(std::pmr::memory_resource* upstream, size_t alignment) noexcept
+        : upstream_(upstream), alignment_(alignment) {}
+
+    [[nodiscard]] std::pmr::memory_resource* upstream() const noexcept { return upstream_; }
+    [[nodiscard]] size_t alignment() const noexcept { return alignment_; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return upstream_->allocate(bytes, std::max(alignment, alignment_));
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(p, bytes, std::max(alignment, alignment_));
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    size_t alignment_;
+};
+
+// One adapter per (resource, alignment), never freed: Messages keep a
+// pointer to it and may outlive the Queue that received them
+std::pmr::memory_resource* aligned_resource(std::pmr::memory_resource* upstream, size_t alignment) {
+    static std::mutex mutex;
+    static std::vector<std::unique_ptr<AlignedResource>> adapters;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& adapter : adapters) {
+        if (adapter->upstream() == upstream && adapter->alignment() == alignment) {
+            return adapter.get();
+        }
+    }
+    adapters.push_back(std::make_unique<AlignedResource>(upstream, alignment));
+    return adapters.back().get();
+}
+
+// Identifies a durable subscription's checkpoint file ("MSGQCUR1")
+constexpr uint64_t CHECKPOINT_MAGIC = 0x315255435147534dULL;
+
+// Layout of a checkpoint file. Only the subscriber holding its lock
+// writes it, so a version left odd means it died mid-update.
+struct CursorCheckpoint {
+    std::atomic<uint64_t> magic;          // CHECKPOINT_MAGIC once written
+    std::atomic<uint32_t> version;        // Odd while an update is in progress
+    std::atomic<uint32_t> next_sequence;  // Sequence of the message at the cursor
+    std::atomic<uint64_t> cursor;         // PackedPointer of the next record to read
+    std::atomic<uint64_t> segment_size;   // Size of the ring the cursor points into
+};
+
+// Smaller than a SegmentHeader and outside the top directory, so the
+// reaper never mistakes a checkpoint for a segment
+std::string checkpoint_path(std::string_view queue, std::string_view durable_name) {
+    if (durable_name.find('/') != std::string_view::npos || durable_name.find('\0') != std::string_view::npos ||
+        queue.find('/') != std::string_view::npos) {
+        throw MessageQueueError("Durable subscription names cannot contain '/' or NUL");
+    }
+    std::string path(TOPIC_PATH_PREFIX);
+    if (const char* prefix = std::getenv("OPENPILOT_PREFIX"); prefix != nullptr && *prefix != '\0') {
+        path += std::string(prefix) + "/";
+    }
+    path += "msgq_cursors/";
+    path += queue;
+    path += '/';
+    path += durable_name;
+    return path;
+}
+
+} // namespace
+
 class Queue::Impl {
 public:
-    struct Header {
-        std::atomic<uint64_t> write_index;
-        std::atomic<uint64_t> read_index[NUM_READERS];
-        uint32_t num_readers;
-        uint32_t reader_uid;
-        uint64_t segment_size;
-    };
+    using Header = SegmentHeader;
 
     // Shared memory management
-    FdGuard fd_;
-    MmapGuard mmap_;
+    SegmentMode mode_;
+    SharedSegment segment_;
     Header* header_ = nullptr;
     char* data_start_ = nullptr;
     std::string name_;
     size_t size_;
     int reader_id_ = -1;
+    uint64_t token_ = 0;                                 // Our entry in local_queues(), 0 if none
     bool is_publisher_ = false;
+    bool checksum_ = false;                              // Publisher stores payload CRCs
+    TagFilter filter_;                                   // Reader side copy of our shared filter
+    bool conflate_ = false;                              // Subscribed with conflate
+    uint32_t every_nth_ = 1;                             // Deliver one message out of every N
+    uint32_t skip_remaining_ = 0;                        // Messages to drop before the next delivery
+    std::chrono::steady_clock::duration min_interval_{0};  // Rate limit, zero if unlimited
+    std::chrono::steady_clock::time_point next_delivery_;
+    uint64_t overruns_ = 0;                              // Times we were lapped and resynced
+    std::pmr::memory_resource* resource_ = std::pmr::get_default_resource();  // Backs received Messages
+    size_t record_alignment_ = 8;                        // Publisher: payload alignment in the ring
+    size_t message_alignment_ = 8;                       // Reader: alignment message_resource_ provides
+    std::pmr::memory_resource* message_resource_ = nullptr;  // resource_, aligned to message_alignment_
+    size_t prefetch_distance_ = 0;                       // Reader: bytes to prefetch past a received record
+    uint64_t prefetched_to_ = 0;                         // Absolute ring position prefetched so far
+    std::vector<gsl::span<const char>> fragment_parts_;  // Reused by send_chunked
+    // Durable subscription
+    FdGuard checkpoint_file_;                            // Holds LOCK_EX while we are subscribed
+    MmapGuard checkpoint_map_;
+    CursorCheckpoint* checkpoint_ = nullptr;             // Null if not durable
+    bool checkpoint_on_recv_ = true;
+    PackedPointer delivered_cursor_;                     // Right after the last delivered message
+    uint32_t delivered_sequence_ = 0;                    // Sequence of the message after it
+    Queue::ResumeStatus resume_status_ = Queue::ResumeStatus::NotDurable;
 
-    Impl(std::string_view name, size_t size) 
-        : name_(name), size_(align_to_8(size)) {
-        init_shared_memory();
+    // `path` is the precomputed /dev/shm path, or null to build it from `name`
+    Impl(std::string_view name, size_t size, SegmentMode mode, const char* path = nullptr)
+        : mode_(mode), name_(name), size_(align_to_8(size)) {
+        if (size_ < sizeof(RecordHeader) || size_ > UINT32_MAX) {
+            throw MessageQueueError("Queue size must be between 8 bytes and 4 GiB");
+        }
+        init_shared_memory(path);
     }
 
     ~Impl() {
-        // Cleanup happens through guard destructors
+        if (token_ != 0) {
+            remove_local_queue(token_);
+        }
+        // Release our pid slots so the reaper sees the segment as unowned;
+        // the rest of the cleanup happens through the segment destructor
+        if (header_ == nullptr) return;
+        int32_t self = static_cast<int32_t>(::getpid());
+        if (is_publisher_ && header_->writer_token.load(std::memory_order_relaxed) == token_) {
+            header_->writer_pid.compare_exchange_strong(self, 0);
+        }
+        release_reader_slot();
     }
 
-    void init_shared_memory() {
-        // Create or open shared memory object
-        std::string shm_path = "/dev/shm/" + std::string(name_);
-        
-        FdGuard fd(::open(shm_path.c_str(), O_CREAT | O_RDWR, 0666));
-        if (!fd.valid()) {
-            throw MessageQueueError("Failed to open shared memory: " + std::string(strerror(errno)));
+    // Take the first reader slot that is free or whose holder is gone
+    // (crashed, or closed without releasing it), as init_publisher does
+    // for the writer slot. Throws if all NUM_READERS are live.
+    void claim_reader_slot() {
+        if (token_ == 0) {
+            token_ = add_local_queue();
         }
-
-        // Resize to fit header + data
-        size_t total_size = sizeof(Header) + size_;
-        if (::ftruncate(fd.get(), total_size) < 0) {
-            throw MessageQueueError("Failed to truncate shared memory");
+        const int32_t self = static_cast<int32_t>(::getpid());
+        for (size_t slot = 0; slot < NUM_READERS;) {
+            int32_t pid = header_->reader_pids[slot].load(std::memory_order_acquire);
+            uint64_t token = header_->reader_tokens[slot].load(std::memory_order_acquire);
+            if (pid != 0 && holder_alive(pid, token)) {
+                slot++;
+                continue;
+            }
+            // A lost race sends us back to look at the same slot again
+            if (pid != self && !header_->reader_pids[slot].compare_exchange_strong(pid, self, std::memory_order_acq_rel)) {
+                continue;
+            }
+            if (!header_->reader_tokens[slot].compare_exchange_strong(token, token_, std::memory_order_acq_rel)) {
+                continue;
+            }
+            uint32_t used = header_->num_readers.load(std::memory_order_relaxed);
+            while (used < slot + 1 &&
+                   !header_->num_readers.compare_exchange_weak(used, static_cast<uint32_t>(slot + 1),
+                                                                std::memory_order_acq_rel)) {
+            }
+            reader_id_ = static_cast<int>(slot);
+            return;
         }
+        throw MessageQueueError("Maximum number of subscribers reached");
+    }
 
-        // Map into memory
-        void* addr = ::mmap(nullptr, total_size, PROT_READ | PROT_WRITE, 
-                           MAP_SHARED, fd.get(), 0);
-        if (addr == MAP_FAILED) {
-            throw MessageQueueError("Failed to mmap shared memory");
+    void release_reader_slot() noexcept {
+        if (reader_id_ < 0 || header_ == nullptr) return;
+        int32_t self = static_cast<int32_t>(::getpid());
+        if (header_->reader_tokens[reader_id_].load(std::memory_order_relaxed) == token_) {
+            header_->reader_pids[reader_id_].compare_exchange_strong(self, 0);
         }
+        reader_id_ = -1;
+    }
+
+    void init_shared_memory(const char* path) {
+        segment_ = path != nullptr
+            ? SharedSegment::open(name_, path, DATA_OFFSET + size_, mode_)
+            : SharedSegment::open(name_, DATA_OFFSET + size_, mode_);
 
-        // Initialize guards
-        fd_ = std::move(fd);
-        mmap_ = MmapGuard(addr, total_size);
-        
         // Setup pointers
-        header_ = static_cast<Header*>(addr);
-        data_start_ = static_cast<char*>(addr) + sizeof(Header);
+        header_ = static_cast<Header*>(segment_.data());
+        data_start_ = static_cast<char*>(segment_.data()) + DATA_OFFSET;
+
+        uint64_t expected = 0;
+        if (!header_->magic.compare_exchange_strong(expected, SEGMENT_MAGIC) &&
+            expected != SEGMENT_MAGIC) {
+            throw MessageQueueError("Segment '" + name_ + "' is not a msgq queue segment");
+        }
+        header_->segment_size = size_;
+    }
+
+    // Absolute byte position of a ring pointer (monotonic across wraps)
+    [[nodiscard]] uint64_t absolute(PackedPointer ptr) const noexcept {
+        return static_cast<uint64_t>(ptr.cycle()) * size_ + ptr.offset();
+    }
+
+    // True if the writer may have overwritten the record at `abs_start`.
+    // Pairs with the release fence in send_parts (seqlock pattern).
+    [[nodiscard]] bool overwritten(uint64_t abs_start) const noexcept {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return header_->write_reserve.load(std::memory_order_relaxed) > abs_start + size_;
     }
 
-    void send_message(gsl::span<const char> data) {
+    // Record under a reader's cursor
+    struct RecordView {
+        PackedPointer at;        // Position of the record
+        PackedPointer next;      // Position right after it
+        PackedPointer write;     // Write pointer observed while peeking
+        RecordHeader header;
+        const char* payload;
+    };
+
+    enum class ReadStatus { Empty, Lapped, Ready };
+
+    // Where a record written at `offset` goes so its payload lands on
+    // record_alignment_: `offset` itself, or far enough past it to leave
+    // room for a RECORD_PADDING header in the gap
+    [[nodiscard]] size_t record_slot(size_t offset) const noexcept {
+        if (record_alignment_ <= 8) {
+            return offset;
+        }
+        const size_t mask = record_alignment_ - 1;
+        size_t slot = ((offset + sizeof(RecordHeader) + mask) & ~mask) - sizeof(RecordHeader);
+        while (slot != offset && slot - offset < sizeof(RecordHeader)) {
+            slot += record_alignment_;
+        }
+        return slot;
+    }
+
+    // Largest payload that still goes out as a single record
+    [[nodiscard]] size_t max_record_payload() const noexcept {
+        const size_t first = record_slot(0) + sizeof(RecordHeader);
+        return first < size_ ? (size_ - first) & ~size_t{7} : 0;
+    }
+
+    // Payload per fragment: a quarter of the ring, so the writer can fill
+    // one fragment while readers drain the previous ones
+    [[nodiscard]] size_t fragment_payload() const noexcept {
+        return std::min(((size_ / 4) & ~size_t{7}) - sizeof(RecordHeader), max_record_payload());
+    }
+
+    void send_message(gsl::span<const char> data, uint64_t tag) {
+        const gsl::span<const char> parts[1] = {data};
+        send_parts(gsl::span<const gsl::span<const char>>(parts, 1), tag);
+    }
+
+    void send_parts(gsl::span<const gsl::span<const char>> parts, uint64_t tag, uint32_t flags = 0) {
         if (!is_publisher_) {
             throw MessageQueueError("Not initialized as publisher");
         }
-        if (data.size() > size_) {
+
+        size_t payload = 0;
+        for (const auto& part : parts) {
+            payload += part.size();
+        }
+
+        const uint32_t sequence = header_->write_sequence.load(std::memory_order_relaxed);
+        RecordHeader record = {0, flags | (checksum_ ? RECORD_CHECKSUM : 0), 0, sequence, tag, monotonic_ns(), 0, 0};
+        if (payload <= max_record_payload()) {
+            record.size = static_cast<uint32_t>(payload);
+            write_record(parts, record, nullptr);
+        } else {
+            send_chunked(parts, payload, record);
+        }
+        header_->last_write_ns.store(record.timestamp_ns, std::memory_order_relaxed);
+        header_->write_sequence.store(sequence + 1, std::memory_order_release);
+    }
+
+    // Split an oversized message into fragments, streaming each one as soon
+    // as live readers have drained enough of the ring to make room for it
+    void send_chunked(gsl::span<const gsl::span<const char>> parts, size_t payload, RecordHeader record) {
+        if (size_ / 4 <= sizeof(RecordHeader) + sizeof(uint64_t)) {
             throw MessageQueueError("Message too large for queue");
         }
 
-        // Write to circular buffer (simplified - actual implementation needs lock-free logic)
+        const uint64_t message_size = payload;
+        const size_t per_fragment = fragment_payload();
+        size_t part_index = 0;
+        size_t part_offset = 0;
+        uint32_t fragment = 0;
+        uint32_t stalled = 0;  // Readers given up on for this message, by slot bit
+
+        while (payload > 0) {
+            fragment_parts_.clear();
+            size_t room = per_fragment;
+            if (fragment == 0) {
+                fragment_parts_.emplace_back(reinterpret_cast<const char*>(&message_size), sizeof(message_size));
+                room -= sizeof(message_size);
+            }
+
+            // Gather up to `room` bytes from the caller's parts
+            size_t length = 0;
+            while (room > 0 && part_index < parts.size()) {
+                const auto& part = parts[part_index];
+                size_t n = std::min(room, part.size() - part_offset);
+                if (n > 0) {
+                    fragment_parts_.emplace_back(part.data() + part_offset, n);
+                }
+                part_offset += n;
+                room -= n;
+                length += n;
+                if (part_offset == part.size()) {
+                    part_index++;
+                    part_offset = 0;
+                }
+            }
+            payload -= length;
+
+            record.flags = (record.flags & (RECORD_CHECKSUM | RECORD_COMPRESSED)) | RECORD_FRAGMENT |
+                           (payload == 0 ? RECORD_LAST_FRAGMENT : 0);
+            record.fragment = fragment;
+            record.size = static_cast<uint32_t>(length + (fragment == 0 ? sizeof(message_size) : 0));
+            // A reader that stalls is lapped for the rest of this message;
+            // the others are still waited for
+            write_record(gsl::span<const gsl::span<const char>>(fragment_parts_.data(), fragment_parts_.size()),
+                         record, &stalled);
+            fragment++;
+        }
+    }
+
+    // Write `record` followed by its payload gathered from `parts`. With
+    // `stalled`, first wait for room from live readers not in it (see
+    // wait_for_room); null writes right away.
+    void write_record(gsl::span<const gsl::span<const char>> parts, const RecordHeader& record,
+                      uint32_t* stalled) {
+        const size_t total = align_to_8(sizeof(RecordHeader) + record.size);
+
+        // Single producer: nobody else moves the write pointer
         PackedPointer write_ptr(
-            header_->write_index.load(std::memory_order_acquire)
+            header_->write_index.load(std::memory_order_relaxed)
         );
+        uint32_t cycle = write_ptr.cycle();
         uint32_t offset = write_ptr.offset();
-        
-        // Copy data
-        if (offset + data.size() > size_) {
-            // Wrap around
-            memcpy(data_start_ + offset, data.data(), size_ - offset);
-            memcpy(data_start_, data.data() + (size_ - offset), 
-                   data.size() - (size_ - offset));
-        } else {
-            memcpy(data_start_ + offset, data.data(), data.size());
+        size_t slot = record_slot(offset);
+        bool wrap = slot + total > size_;
+        if (wrap) {
+            slot = record_slot(0);
+        }
+
+        const uint64_t reserve = wrap
+            ? static_cast<uint64_t>(cycle + 1) * size_ + slot + total
+            : static_cast<uint64_t>(cycle) * size_ + slot + total;
+        if (stalled != nullptr) {
+            wait_for_room(reserve, *stalled);
         }
 
-        // Update write pointer with new cycle counter
-        PackedPointer new_ptr(write_ptr.cycle() + 1, 
-                            (offset + data.size()) % size_);
+        // Announce the region about to be overwritten before touching it
+        header_->write_reserve.store(reserve, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        if (wrap) {
+            // Records never straddle the end; mark the tail as skipped
+            if (offset + sizeof(RecordHeader) <= size_) {
+                RecordHeader marker = {WRAP_MARKER, 0, 0, 0, 0, 0, 0, 0};
+                memcpy(data_start_ + offset, &marker, sizeof(marker));
+            }
+            cycle++;
+            offset = 0;
+        }
+        if (slot != offset) {
+            RecordHeader padding = record;
+            padding.size = static_cast<uint32_t>(slot - offset - sizeof(RecordHeader));
+            padding.flags = RECORD_PADDING;
+            padding.fragment = 0;
+            padding.checksum = 0;
+            memcpy(data_start_ + offset, &padding, sizeof(padding));
+            offset = static_cast<uint32_t>(slot);
+        }
+
+        // Gather the parts straight into the ring, then the header, which
+        // needs the checksum of what was copied
+        const bool checksum = record.flags & RECORD_CHECKSUM;
+        uint32_t crc = 0;
+        char* dst = data_start_ + offset + sizeof(RecordHeader);
+        for (const auto& part : parts) {
+            crc = copy_with_crc(dst, part.data(), part.size(), checksum, crc);
+            dst += part.size();
+        }
+        RecordHeader stored = record;
+        stored.checksum = crc;
+        memcpy(data_start_ + offset, &stored, sizeof(stored));
+
+        PackedPointer new_ptr(cycle, static_cast<uint32_t>(offset + total));
         header_->write_index.store(new_ptr.raw(), std::memory_order_release);
+        wake_readers(record.tag, new_ptr);
+    }
+
+    // Wake sleeping readers whose filter matches `tag`, and filtered-out
+    // readers that lag by more than half the ring so they step over the
+    // skipped records before being lapped. The seq-cst fence pairs with
+    // the one in wait_for_data: either the reader sees the new write
+    // pointer or we see it registered as sleeping.
+    void wake_readers(uint64_t tag, PackedPointer write_ptr) noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (header_->sleeping_readers.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        for (size_t i = 0; i < header_->num_readers && i < NUM_READERS; ++i) {
+            const TagFilter filter{header_->reader_tag_mask[i].load(std::memory_order_relaxed),
+                                   header_->reader_tag_value[i].load(std::memory_order_relaxed)};
+            const PackedPointer read_ptr(header_->read_index[i].load(std::memory_order_relaxed));
+            if (filter.matches(tag) || absolute(write_ptr) - absolute(read_ptr) > size_ / 2) {
+                header_->reader_wake[i].fetch_add(1, std::memory_order_release);
+                futex_wake_all(header_->reader_wake[i]);
+            }
+        }
+    }
+
+    [[nodiscard]] bool has_data() const noexcept {
+        return header_->read_index[reader_id_].load(std::memory_order_relaxed) !=
+               header_->write_index.load(std::memory_order_acquire);
+    }
+
+    // Block until the writer publishes past our read pointer. Spins briefly,
+    // then sleeps on our wake futex. False if `deadline` passed.
+    bool wait_for_data(std::chrono::steady_clock::time_point deadline) noexcept {
+        for (int i = 0; i < RECV_SPIN_COUNT; ++i) {
+            if (has_data()) return true;
+        }
+
+        auto& wake = header_->reader_wake[reader_id_];
+        for (;;) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                return false;
+            }
+
+            // Register before checking, so a record written after the check
+            // either bumps the futex word or is seen by has_data
+            header_->sleeping_readers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const uint32_t seq = wake.load(std::memory_order_acquire);
+            if (has_data()) {
+                header_->sleeping_readers.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            // Cap each sleep so a lost reader slot or a wrapped deadline
+            // never parks us for longer than a second at a time
+            const auto remaining = std::min<std::chrono::nanoseconds>(
+                deadline - now, std::chrono::seconds(1));
+            futex_wait(wake, seq, remaining);
+            header_->sleeping_readers.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Block until every live reader outside `stalled` has consumed
+    // everything that writing up to `reserve` would overwrite. Readers
+    // still in the way after CHUNK_STALL_TIMEOUT are added to `stalled`
+    // and get lapped rather than blocking the publisher.
+    void wait_for_room(uint64_t reserve, uint32_t& stalled) {
+        const auto deadline = std::chrono::steady_clock::now() + CHUNK_STALL_TIMEOUT;
+        for (;;) {
+            uint32_t blocking = 0;
+            for (size_t i = 0; i < header_->num_readers && i < NUM_READERS; ++i) {
+                if ((stalled & (1u << i)) || !reader_alive(*header_, i)) continue;
+                PackedPointer read_ptr(header_->read_index[i].load(std::memory_order_acquire));
+                if (reserve > absolute(read_ptr) + size_) {
+                    blocking |= 1u << i;
+                }
+            }
+            if (blocking == 0) {
+                return;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                stalled |= blocking;
+                return;
+            }
+            std::this_thread::sleep_for(CHUNK_POLL_INTERVAL);
+        }
+    }
+
+    // Position `view` on the record under the read pointer, consuming wrap
+    // markers on the way. The record itself is not consumed.
+    ReadStatus peek_record(RecordView& view) {
+        auto& read_index = header_->read_index[reader_id_];
+        for (;;) {
+            PackedPointer read_ptr(read_index.load(std::memory_order_relaxed));
+            PackedPointer write_ptr(
+                header_->write_index.load(std::memory_order_acquire)
+            );
+
+            if (read_ptr == write_ptr) {
+                return ReadStatus::Empty;
+            }
+
+            const uint32_t offset = read_ptr.offset();
+            PackedPointer wrapped(read_ptr.cycle() + 1, 0);
+
+            if (offset + sizeof(RecordHeader) > size_) {
+                read_index.store(wrapped.raw(), std::memory_order_release);
+                continue;
+            }
+
+            memcpy(&view.header, data_start_ + offset, sizeof(view.header));
+            if (overwritten(absolute(read_ptr))) {
+                // Lapped by the writer: resync to the newest position
+                read_index.store(write_ptr.raw(), std::memory_order_release);
+                overruns_++;
+                return ReadStatus::Lapped;
+            }
+
+            if (view.header.size == WRAP_MARKER) {
+                read_index.store(wrapped.raw(), std::memory_order_release);
+                continue;
+            }
+
+            const size_t total = align_to_8(sizeof(RecordHeader) + static_cast<size_t>(view.header.size));
+            if (offset + total > size_) {
+                throw MessageQueueError("Corrupt record in queue '" + name_ + "'");
+            }
+            PackedPointer next(read_ptr.cycle(), static_cast<uint32_t>(offset + total));
+
+            if ((view.header.flags & RECORD_PADDING) || !filter_.matches(view.header.tag)) {
+                // Alignment padding or filtered out: step over it having read only the header
+                read_index.store(next.raw(), std::memory_order_release);
+                continue;
+            }
+
+            view.at = read_ptr;
+            view.next = next;
+            view.write = write_ptr;
+            view.payload = data_start_ + offset + sizeof(RecordHeader);
+            return ReadStatus::Ready;
+        }
+    }
+
+    // Prefetch the ring after the record under `view`, up to
+    // prefetch_distance_ bytes and no further than the writer, so the next
+    // headers (and the start of their payloads) are in cache by the time
+    // we get to them. Lines already requested are not requested again,
+    // which keeps a backlog drain at one prefetch per line.
+    void prefetch_after(const RecordView& view) noexcept {
+        if (prefetch_distance_ == 0) {
+            return;
+        }
+        constexpr uint64_t LINE = 64;
+        const uint64_t next = absolute(view.next);
+        const uint64_t end = std::min(next + prefetch_distance_, absolute(view.write));
+        uint64_t at = std::max(next, prefetched_to_);
+        if (at >= end) {
+            return;
+        }
+        prefetched_to_ = end;
+        size_t offset = view.next.offset() + static_cast<size_t>(at - next);
+        for (; at < end; at += LINE, offset += LINE) {
+            if (offset >= size_) {
+                offset -= size_;
+            }
+            __builtin_prefetch(data_start_ + offset, 0, 3);
+        }
+    }
+
+    [[nodiscard]] static std::chrono::steady_clock::time_point deadline_after(int timeout_ms) noexcept {
+        if (timeout_ms < 0) {
+            return std::chrono::steady_clock::time_point::max();
+        }
+        if (timeout_ms == 0) {
+            // Already passed, without a clock read per message of a drain
+            return std::chrono::steady_clock::time_point::min();
+        }
+        return std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    }
+
+    // Like peek_record, but waits up to `deadline` for the writer
+    ReadStatus wait_record(RecordView& view, std::chrono::steady_clock::time_point deadline) {
+        for (;;) {
+            ReadStatus status = peek_record(view);
+            if (status != ReadStatus::Empty || !wait_for_data(deadline)) {
+                return status;
+            }
+        }
+    }
+
+    void advance(PackedPointer next) {
+        header_->read_index[reader_id_].store(next.raw(), std::memory_order_release);
+    }
+
+    // Called when the writer overwrote the record we were copying
+    void resync() {
+        overruns_++;
+        advance(PackedPointer(header_->write_index.load(std::memory_order_acquire)));
+    }
+
+    [[nodiscard]] static bool starts_message(const RecordHeader& header) noexcept {
+        return !(header.flags & RECORD_FRAGMENT) || header.fragment == 0;
+    }
+
+    // Conflate: move the cursor to the start of the newest message by
+    // walking record headers only; skipped payloads are never copied
+    void skip_to_newest() {
+        RecordView view;
+        PackedPointer newest;
+        bool found = false;
+        while (peek_record(view) == ReadStatus::Ready) {
+            if (starts_message(view.header)) {
+                newest = view.at;
+                found = true;
+            }
+            if (view.next == view.write) break;
+            advance(view.next);
+        }
+        if (found) {
+            advance(newest);
+        }
     }
 
     Message receive_message(int timeout_ms, bool conflate) {
+        std::optional<Message> msg = try_receive(timeout_ms, conflate);
+        if (!msg) {
+            return Message();
+        }
+        return std::move(*msg);
+    }
+
+    // As receive_message(), but nullopt when nothing was delivered, so a
+    // zero-length message is told apart from none
+    std::optional<Message> try_receive(int timeout_ms, bool conflate) {
         if (reader_id_ < 0) {
             throw MessageQueueError("Not initialized as subscriber");
         }
 
-        // Simplified: actual implementation needs proper synchronization
-        PackedPointer read_ptr(
-            header_->read_index[reader_id_].load(std::memory_order_acquire)
-        );
-        PackedPointer write_ptr(
-            header_->write_index.load(std::memory_order_acquire)
-        );
+        const auto deadline = deadline_after(timeout_ms);
+
+        // Rate limit: hold back until the window opens, then the newest wins
+        if (min_interval_ != std::chrono::steady_clock::duration::zero()) {
+            if (std::chrono::steady_clock::now() < next_delivery_) {
+                if (deadline < next_delivery_) {
+                    std::this_thread::sleep_until(deadline);
+                    return std::nullopt;
+                }
+                std::this_thread::sleep_until(next_delivery_);
+            }
+            conflate = true;
+        }
+
+        if (conflate || conflate_) {
+            skip_to_newest();
+        }
+
+        RecordView view;
+        for (;;) {
+            if (wait_record(view, deadline) != ReadStatus::Ready) {
+                return std::nullopt;
+            }
+            prefetch_after(view);
+
+            if (starts_message(view.header) && skip_remaining_ > 0) {
+                // Decimation: step over the whole message by its headers;
+                // its later fragments are dropped as mid-message joins
+                skip_remaining_--;
+                advance(view.next);
+                continue;
+            }
+
+            if (view.header.flags & RECORD_FRAGMENT) {
+                if (view.header.fragment != 0) {
+                    // Joined in the middle of a chunked message
+                    advance(view.next);
+                    continue;
+                }
+                const bool compressed = view.header.flags & RECORD_COMPRESSED;
+                const uint32_t sequence = view.header.sequence;
+                Message result = receive_chunked(view, deadline);
+                if (compressed && !result.empty()) {
+                    result = expand(result);
+                }
+                if (result.empty()) {
+                    return std::nullopt;
+                }
+                delivered(sequence);
+                return result;
+            }
+
+            Message result(static_cast<size_t>(view.header.size), message_resource());
+            const uint32_t crc = copy_with_crc(result.data_ptr(), view.payload, result.size(),
+                                               view.header.flags & RECORD_CHECKSUM);
+            if (overwritten(absolute(view.at))) {
+                resync();
+                return std::nullopt;
+            }
+            if (!verify(view.header, crc)) {
+                advance(view.next);
+                continue;
+            }
+            advance(view.next);
+            if (view.header.flags & RECORD_COMPRESSED) {
+                result = expand(result);
+                if (result.empty()) {
+                    continue;
+                }
+            }
+            delivered(view.header.sequence);
+            return result;
+        }
+    }
+
+    // Position on the newest message for Queue::snapshot(). Returns true
+    // with `view` on a record to read in place, false with `copy` holding
+    // the message (chunked or compressed), or empty on timeout. `copy`
+    // takes over the buffer built from message_resource() (Message move
+    // assignment adopts it), keeping the subscriber's resource and alignment.
+    bool take_snapshot(int timeout_ms, RecordView& view, Message& copy) {
+        if (reader_id_ < 0) {
+            throw MessageQueueError("Not initialized as subscriber");
+        }
+
+        const auto deadline = deadline_after(timeout_ms);
+        skip_to_newest();
+        for (;;) {
+            if (wait_record(view, deadline) != ReadStatus::Ready) {
+                return false;
+            }
+            const uint32_t sequence = view.header.sequence;
+            const bool compressed = view.header.flags & RECORD_COMPRESSED;
+
+            if (view.header.flags & RECORD_FRAGMENT) {
+                if (view.header.fragment != 0) {
+                    advance(view.next);
+                    continue;
+                }
+                copy = receive_chunked(view, deadline);
+                if (compressed && !copy.empty()) {
+                    copy = expand(copy);
+                }
+                if (!copy.empty()) {
+                    delivered(sequence);
+                }
+                return false;
+            }
 
+            if (overwritten(absolute(view.at))) {
+                resync();
+                return false;
+            }
+            if (compressed) {
+                Message frame(static_cast<size_t>(view.header.size), message_resource());
+                const uint32_t crc = copy_with_crc(frame.data_ptr(), view.payload, frame.size(),
+                                                   view.header.flags & RECORD_CHECKSUM);
+                if (overwritten(absolute(view.at))) {
+                    resync();
+                    return false;
+                }
+                advance(view.next);
+                if (!verify(view.header, crc)) {
+                    continue;
+                }
+                copy = expand(frame);
+                if (copy.empty()) {
+                    continue;
+                }
+                delivered(sequence);
+                return false;
+            }
+
+            // In place: consumed now, the bytes stay until the writer laps them
+            advance(view.next);
+            delivered(sequence);
+            return true;
+        }
+    }
+
+    // Pending data for this reader from the cursors and the header of the
+    // oldest record; nothing is copied and no syscall is made
+    Queue::Backlog backlog() const noexcept {
+        Queue::Backlog result;
+        const PackedPointer read_ptr(header_->read_index[reader_id_].load(std::memory_order_acquire));
+        const PackedPointer write_ptr(header_->write_index.load(std::memory_order_acquire));
         if (read_ptr == write_ptr) {
-            return Message();  // No new data
+            return result;
+        }
+
+        const uint64_t write_abs = absolute(write_ptr);
+        uint64_t at = absolute(read_ptr);
+        if (write_abs - at > size_) {
+            result.lapped = true;
+            result.bytes = size_;
+            return result;
+        }
+        result.bytes = write_abs - at;
+
+        // Oldest record, stepping over a wrap tail
+        RecordHeader oldest;
+        oldest.size = WRAP_MARKER;
+        if (read_ptr.offset() + sizeof(RecordHeader) <= size_) {
+            memcpy(&oldest, data_start_ + read_ptr.offset(), sizeof(oldest));
+        }
+        if (oldest.size == WRAP_MARKER) {
+            at = static_cast<uint64_t>(read_ptr.cycle() + 1) * size_;
+            if (at >= write_abs) {
+                return result;
+            }
+            memcpy(&oldest, data_start_, sizeof(oldest));
+        }
+        if (overwritten(at)) {
+            result.lapped = true;
+            return result;
         }
 
-        // Extract message size (simplified - needs proper framing)
-        // In real implementation, this would read from message header at offset
-        Message result;
-        
-        // Update read pointer
-        header_->read_index[reader_id_].store(write_ptr.raw(), 
-                                             std::memory_order_release);
+        // The sequence is bumped once the whole message is out, so a message
+        // still being written counts as one
+        const uint32_t next = header_->write_sequence.load(std::memory_order_acquire);
+        result.messages = std::max<uint32_t>(next - oldest.sequence, 1);
+        result.oldest_age = std::chrono::nanoseconds(std::max<int64_t>(monotonic_ns() - oldest.timestamp_ns, 0));
         return result;
     }
+
+    Queue::Freshness freshness() const noexcept {
+        const Queue::Backlog pending = backlog();
+        Queue::Freshness result;
+        const int64_t newest_ns = header_->last_write_ns.load(std::memory_order_relaxed);
+        if (newest_ns != 0) {
+            result.newest_timestamp = std::chrono::steady_clock::time_point(
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(newest_ns)));
+        }
+        result.backlog_messages = pending.messages;
+        result.backlog_bytes = pending.bytes;
+        // A lap not yet noticed by recv counts already
+        result.overruns = overruns_ + (pending.lapped ? 1 : 0);
+        return result;
+    }
+
+    // Resource for received Messages: resource_, or an adapter over it
+    // while the publisher asks for more than the usual 8 bytes
+    std::pmr::memory_resource* message_resource() {
+        const size_t alignment = std::max<size_t>(header_->record_alignment.load(std::memory_order_relaxed), 8);
+        if (alignment != message_alignment_ || message_resource_ == nullptr) {
+            message_alignment_ = alignment;
+            message_resource_ = alignment > 8 ? aligned_resource(resource_, alignment) : resource_;
+        }
+        return message_resource_;
+    }
+
+    // Check `crc`, computed by copy_with_crc() over the record's payload as
+    // it was copied out, against the stored one; a mismatch is counted
+    // against this reader
+    bool verify(const RecordHeader& header, uint32_t crc) noexcept {
+        if (!(header.flags & RECORD_CHECKSUM) || crc == header.checksum) {
+            return true;
+        }
+        header_->reader_checksum_errors[reader_id_].fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Decode a RECORD_COMPRESSED frame into the payload it carries. A frame
+    // that does not decode is corrupt: counted like a checksum mismatch,
+    // and an empty Message is returned.
+    Message expand(const Message& frame) {
+        uint64_t raw_size;
+        if (frame.size() >= sizeof(raw_size)) {
+            memcpy(&raw_size, frame.data_ptr(), sizeof(raw_size));
+            const size_t block = frame.size() - sizeof(raw_size);
+            // Bound the allocation by what a block of this size can expand to
+            if (raw_size <= block * 255) {
+                Message result(static_cast<size_t>(raw_size), message_resource());
+                if (lz4::decompress(frame.data_ptr() + sizeof(raw_size), block, result.data_ptr(), result.size())) {
+                    return result;
+                }
+            }
+        }
+        header_->reader_checksum_errors[reader_id_].fetch_add(1, std::memory_order_relaxed);
+        return Message();
+    }
+
+    // Start the next decimation round and rate-limit window
+    // Called once message `sequence` was handed out, with the cursor right
+    // after it
+    void delivered(uint32_t sequence) noexcept {
+        skip_remaining_ = every_nth_ - 1;
+        if (min_interval_ != std::chrono::steady_clock::duration::zero()) {
+            next_delivery_ = std::chrono::steady_clock::now() + min_interval_;
+        }
+        if (checkpoint_ != nullptr) {
+            delivered_cursor_ = PackedPointer(header_->read_index[reader_id_].load(std::memory_order_relaxed));
+            delivered_sequence_ = sequence + 1;
+            if (checkpoint_on_recv_) {
+                save_checkpoint();
+            }
+        }
+    }
+
+    // Seqlock-style update: a crash in the middle leaves the version odd
+    void save_checkpoint() noexcept {
+        const uint32_t version = checkpoint_->version.load(std::memory_order_relaxed);
+        checkpoint_->version.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        checkpoint_->cursor.store(delivered_cursor_.raw(), std::memory_order_relaxed);
+        checkpoint_->next_sequence.store(delivered_sequence_, std::memory_order_relaxed);
+        checkpoint_->segment_size.store(size_, std::memory_order_relaxed);
+        checkpoint_->magic.store(CHECKPOINT_MAGIC, std::memory_order_relaxed);
+        checkpoint_->version.store(version + 2, std::memory_order_release);
+    }
+
+    // Open (creating it if needed) and lock the checkpoint of `durable_name`
+    void open_checkpoint(const std::string& durable_name) {
+        const std::string path = checkpoint_path(name_, durable_name);
+        try {
+            std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+        } catch (const std::exception& e) {
+            throw MessageQueueError("Failed to create checkpoint directory: " + std::string(e.what()));
+        }
+
+        FdGuard file(::open(path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0666));
+        if (!file.valid()) {
+            throw MessageQueueError("Failed to open checkpoint " + path + ": " + std::string(strerror(errno)));
+        }
+        // Two live readers sharing one cursor would each skip the other's
+        // messages; the lock goes away with the process, so a crash frees it
+        if (::flock(file.get(), LOCK_EX | LOCK_NB) < 0) {
+            throw MessageQueueError("Durable subscription '" + durable_name + "' is already in use");
+        }
+        if (::ftruncate(file.get(), sizeof(CursorCheckpoint)) < 0) {
+            throw MessageQueueError("Failed to size checkpoint: " + std::string(strerror(errno)));
+        }
+        void* addr = ::mmap(nullptr, sizeof(CursorCheckpoint), PROT_READ | PROT_WRITE, MAP_SHARED, file.get(), 0);
+        if (addr == MAP_FAILED) {
+            throw MessageQueueError("Failed to mmap checkpoint");
+        }
+        checkpoint_map_ = MmapGuard(addr, sizeof(CursorCheckpoint));
+        checkpoint_file_ = std::move(file);
+        checkpoint_ = static_cast<CursorCheckpoint*>(addr);
+    }
+
+    // True if the records from `cursor` on are still in the ring and the
+    // one under it is message `sequence`. A checkpoint taken while a
+    // message was being published may name the one before it, hence the
+    // off-by-one slack.
+    [[nodiscard]] bool checkpoint_in_ring(PackedPointer cursor, uint32_t sequence) const noexcept {
+        if (cursor.offset() > size_) {
+            return false;
+        }
+        for (;;) {
+            const PackedPointer write_ptr(header_->write_index.load(std::memory_order_acquire));
+            const uint64_t at = absolute(cursor);
+            const uint64_t write_abs = absolute(write_ptr);
+            if (at > write_abs || write_abs - at > size_) {
+                return false;  // Another ring, or lapped
+            }
+
+            uint32_t found;
+            if (cursor == write_ptr) {
+                found = header_->write_sequence.load(std::memory_order_acquire);
+            } else if (cursor.offset() + sizeof(RecordHeader) > size_) {
+                cursor = PackedPointer(cursor.cycle() + 1, 0);
+                continue;
+            } else {
+                RecordHeader record;
+                memcpy(&record, data_start_ + cursor.offset(), sizeof(record));
+                if (overwritten(at)) {
+                    return false;
+                }
+                if (record.size == WRAP_MARKER) {
+                    cursor = PackedPointer(cursor.cycle() + 1, 0);
+                    continue;
+                }
+                found = record.sequence;
+            }
+            return found == sequence || found == sequence + 1;
+        }
+    }
+
+    // Position a new durable reader: at its checkpoint if still usable,
+    // at the newest message otherwise
+    void resume_from_checkpoint() {
+        const PackedPointer newest(header_->write_index.load(std::memory_order_acquire));
+        const uint32_t newest_sequence = header_->write_sequence.load(std::memory_order_acquire);
+
+        const bool written = checkpoint_->magic.load(std::memory_order_acquire) == CHECKPOINT_MAGIC;
+        const uint32_t version = checkpoint_->version.load(std::memory_order_acquire);
+        const PackedPointer cursor(checkpoint_->cursor.load(std::memory_order_relaxed));
+        const uint32_t sequence = checkpoint_->next_sequence.load(std::memory_order_relaxed);
+        const uint64_t segment_size = checkpoint_->segment_size.load(std::memory_order_relaxed);
+
+        if (!written) {
+            resume_status_ = Queue::ResumeStatus::Started;
+        } else if ((version & 1) == 0 && segment_size == size_ && checkpoint_in_ring(cursor, sequence)) {
+            resume_status_ = Queue::ResumeStatus::Resumed;
+        } else {
+            resume_status_ = Queue::ResumeStatus::Lapped;
+            overruns_++;
+        }
+
+        if (resume_status_ == Queue::ResumeStatus::Resumed) {
+            delivered_cursor_ = cursor;
+            delivered_sequence_ = sequence;
+        } else {
+            delivered_cursor_ = newest;
+            delivered_sequence_ = newest_sequence;
+            save_checkpoint();
+        }
+        // A lap from here on is caught by peek_record like any other
+        header_->read_index[reader_id_].store(delivered_cursor_.raw(), std::memory_order_release);
+    }
+
+    // Reassemble a chunked message starting at fragment 0 under `view`.
+    // Memory is bounded by the message itself; each fragment is copied
+    // once, straight into the result.
+    // Once fragment 0 is consumed the rest is waited for past `deadline`
+    // (even a polling recv(0)), up to CHUNK_STALL_TIMEOUT per fragment:
+    // giving up would drop what was already consumed. A publisher that
+    // stops waiting for us laps us, which ends the wait too.
+    Message receive_chunked(RecordView& view, std::chrono::steady_clock::time_point deadline) {
+        uint64_t message_size;
+        memcpy(&message_size, view.payload, sizeof(message_size));
+        if (overwritten(absolute(view.at))) {
+            resync();
+            return Message();
+        }
+
+        Message result(message_size, message_resource());
+        size_t filled = 0;
+        uint32_t expected = 0;
+
+        for (;;) {
+            const RecordHeader& header = view.header;
+            if (!(header.flags & RECORD_FRAGMENT) || header.fragment != expected) {
+                // Lost a fragment; leave the record for the next receive
+                return Message();
+            }
+
+            const char* data = view.payload;
+            size_t length = static_cast<size_t>(header.size);
+            if (expected == 0) {
+                data += sizeof(message_size);
+                length -= sizeof(message_size);
+            }
+            if (filled + length > message_size) {
+                advance(view.next);
+                return Message();
+            }
+
+            // Fragment 0's checksum also covers the size prefix
+            const bool checksum = header.flags & RECORD_CHECKSUM;
+            const uint32_t seed = checksum && expected == 0 ? crc32c(&message_size, sizeof(message_size)) : 0;
+            const uint32_t crc = copy_with_crc(result.data_ptr() + filled, data, length, checksum, seed);
+            if (overwritten(absolute(view.at))) {
+                resync();
+                return Message();
+            }
+            if (!verify(header, crc)) {
+                advance(view.next);
+                return Message();
+            }
+            advance(view.next);
+            filled += length;
+            expected++;
+
+            if (header.flags & RECORD_LAST_FRAGMENT) {
+                if (filled != message_size) {
+                    return Message();
+                }
+                return result;  // Not via ?:, which would copy into the default resource
+            }
+
+            const auto stall_deadline = std::chrono::steady_clock::now() + CHUNK_STALL_TIMEOUT;
+            if (wait_record(view, std::max(deadline, stall_deadline)) != ReadStatus::Ready) {
+                return Message();
+            }
+        }
+    }
 };
 
 // ============================================================================
 // Queue public interface
 // ============================================================================
 
-Queue Queue::create(std::string_view name, size_t size) {
-    auto impl = std::make_unique<Impl>(name, size);
+Queue Queue::create(std::string_view name, size_t size, SegmentMode mode) {
+    auto impl = std::make_unique<Impl>(name, size, mode);
     return Queue(std::move(impl));
 }
 
-void Queue::send(gsl::span<const char> data) {
+Queue Queue::create(const TopicInfo& topic, SegmentMode mode) {
+    auto impl = std::make_unique<Impl>(topic.name, topic.segment_size, mode, topic.c_path());
+    return Queue(std::move(impl));
+}
+
+void Queue::send(gsl::span<const char> data, uint64_t tag) {
     if (!impl_) throw MessageQueueError("Queue not initialized");
-    impl_->send_message(data);
+    impl_->send_message(data, tag);
 }
 
-void Queue::send(const Message& msg) {
+void Queue::send(const Message& msg, uint64_t tag) {
     if (!impl_) throw MessageQueueError("Queue not initialized");
-    impl_->send_message(msg.data());
+    impl_->send_message(msg.data(), tag);
+}
+
+void Queue::sendv(gsl::span<const gsl::span<const char>> parts, uint64_t tag) {
+    if (!impl_) throw MessageQueueError("Queue not initialized");
+    impl_->send_parts(parts, tag);
+}
+
+void Queue::send_compressed(gsl::span<const char> frame, uint64_t tag) {
+    if (!impl_) throw MessageQueueError("Queue not initialized");
+    const gsl::span<const char> parts[1] = {frame};
+    impl_->send_parts(gsl::span<const gsl::span<const char>>(parts, 1), tag, RECORD_COMPRESSED);
 }
 
 Message Queue::recv(int timeout_ms, bool conflate) {
@@ -175,6 +1424,11 @@ Message Queue::recv(int timeout_ms, bool conflate) {
     return impl_->receive_message(timeout_ms, conflate);
 }
 
+std::optional<Message> Queue::try_recv(int timeout_ms) {
+    if (!impl_) throw MessageQueueError("Queue not initialized");
+    return impl_->try_receive(timeout_ms, false);
+}
+
 bool Queue::msg_ready() const {
     if (!impl_) return false;
     auto read_ptr = impl_->header_->read_index[impl_->reader_id_].load(
@@ -187,20 +1441,220 @@ bool Queue::msg_ready() const {
 }
 
 void Queue::init_publisher() {
+    init_publisher(PublisherOptions{});
+}
+
+void Queue::init_publisher(const PublisherOptions& options) {
     if (!impl_) throw MessageQueueError("Queue not initialized");
+    const size_t alignment = options.record_alignment;
+    if (alignment != 8 && alignment != 16 && alignment != 64 && alignment != MAX_RECORD_ALIGNMENT) {
+        throw MessageQueueError("Record alignment must be 8, 16, 64 or 4096");
+    }
+    impl_->record_alignment_ = alignment;
+    if (impl_->max_record_payload() <= sizeof(RecordHeader) + sizeof(uint64_t)) {
+        throw MessageQueueError("Queue too small for a record alignment of " + std::to_string(alignment));
+    }
+    if (impl_->token_ == 0) {
+        impl_->token_ = add_local_queue();
+    }
+
+    // Single producer: a second publisher would corrupt the ring. Take the
+    // slot only if it is free or its holder is gone (crashed or closed);
+    // the pid settles races between processes, the token within one.
+    auto& header = *impl_->header_;
+    const int32_t self = static_cast<int32_t>(getpid());
+    for (;;) {
+        int32_t writer = header.writer_pid.load(std::memory_order_acquire);
+        uint64_t token = header.writer_token.load(std::memory_order_acquire);
+        if (writer == self && token == impl_->token_) {
+            break;  // Already ours
+        }
+        if (holder_alive(writer, token)) {
+            throw MessageQueueError("Queue '" + impl_->name_ + "' already has a publisher (pid " +
+                                    std::to_string(writer) + ")");
+        }
+        if (writer != self && !header.writer_pid.compare_exchange_strong(writer, self, std::memory_order_acq_rel)) {
+            continue;
+        }
+        if (header.writer_token.compare_exchange_strong(token, impl_->token_, std::memory_order_acq_rel)) {
+            break;
+        }
+    }
+
     impl_->is_publisher_ = true;
+    impl_->checksum_ = options.checksum;
+    header.record_alignment.store(static_cast<uint32_t>(alignment), std::memory_order_relaxed);
 }
 
-void Queue::init_subscriber(bool conflate) {
+void Queue::init_subscriber(bool conflate, TagFilter filter) {
+    SubscriberOptions options;
+    options.conflate = conflate;
+    options.filter = filter;
+    init_subscriber(options);
+}
+
+void Queue::init_subscriber(const SubscriberOptions& options) {
     if (!impl_) throw MessageQueueError("Queue not initialized");
+    if (options.every_nth == 0 || options.max_rate_hz < 0.0) {
+        throw MessageQueueError("Invalid decimation settings");
+    }
     
-    // Assign reader ID
-    uint32_t reader_uid = static_cast<uint32_t>(getpid()) << 16;
-    impl_->reader_id_ = impl_->header_->num_readers++;
-    
-    if (impl_->reader_id_ >= NUM_READERS) {
-        throw MessageQueueError("Maximum number of subscribers reached");
+    if (impl_->reader_id_ < 0) {
+        impl_->claim_reader_slot();
+    }
+
+    // Published so the writer can skip waking us for records we'd drop
+    impl_->filter_ = options.filter;
+    impl_->header_->reader_tag_mask[impl_->reader_id_].store(options.filter.mask, std::memory_order_relaxed);
+    impl_->header_->reader_tag_value[impl_->reader_id_].store(options.filter.value, std::memory_order_relaxed);
+
+    impl_->header_->reader_checksum_errors[impl_->reader_id_].store(0, std::memory_order_relaxed);
+    impl_->resource_ = options.memory_resource != nullptr
+        ? options.memory_resource : std::pmr::get_default_resource();
+    impl_->message_resource_ = nullptr;
+    impl_->prefetch_distance_ = options.prefetch_distance;
+    impl_->conflate_ = options.conflate;
+    impl_->every_nth_ = options.every_nth;
+    impl_->skip_remaining_ = 0;
+    impl_->min_interval_ = std::chrono::steady_clock::duration::zero();
+    if (options.max_rate_hz > 0.0) {
+        impl_->min_interval_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / options.max_rate_hz));
+    }
+
+    impl_->checkpoint_on_recv_ = options.checkpoint_on_recv;
+    if (!options.durable_name.empty()) {
+        try {
+            impl_->open_checkpoint(options.durable_name);
+            impl_->resume_from_checkpoint();
+        } catch (...) {
+            // E.g. the name is held by another subscriber: give the slot back
+            impl_->release_reader_slot();
+            throw;
+        }
+        return;
+    }
+
+    // New readers start at the current write position
+    impl_->header_->read_index[impl_->reader_id_].store(
+        impl_->header_->write_index.load(std::memory_order_acquire),
+        std::memory_order_release
+    );
+}
+
+Queue::Backlog Queue::backlog() const {
+    if (!impl_) throw MessageQueueError("Queue not initialized");
+    if (impl_->reader_id_ < 0) {
+        throw MessageQueueError("Not initialized as subscriber");
+    }
+    return impl_->backlog();
+}
+
+Queue::Freshness Queue::freshness() const {
+    if (!impl_) throw MessageQueueError("Queue not initialized");
+    if (impl_->reader_id_ < 0) {
+        throw MessageQueueError("Not initialized as subscriber");
+    }
+    return impl_->freshness();
+}
+
+uint64_t Queue::checksum_errors() const {
+    if (!impl_) throw MessageQueueError("Queue not initialized");
+    if (impl_->reader_id_ < 0) {
+        throw MessageQueueError("Not initialized as subscriber");
+    }
+    return impl_->header_->reader_checksum_errors[impl_->reader_id_].load(std::memory_order_relaxed);
+}
+
+Queue::Snapshot Queue::snapshot(int timeout_ms) {
+    if (!impl_) throw MessageQueueError("Queue not initialized");
+    Snapshot result;
+    Impl::RecordView view;
+    if (impl_->take_snapshot(timeout_ms, view, result.copy_)) {
+        result.impl_ = impl_.get();
+        result.data_ = view.payload;
+        result.size_ = view.header.size;
+        result.position_ = impl_->absolute(view.at);
+        result.checksum_ = view.header.flags & RECORD_CHECKSUM;
+        result.expected_crc_ = view.header.checksum;
+    } else {
+        result.data_ = result.copy_.data_ptr();
+        result.size_ = result.copy_.size();
+    }
+    return result;
+}
+
+Queue::Snapshot::Snapshot(Snapshot&& other) noexcept
+    : impl_(std::exchange(other.impl_, nullptr)),
+      data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      position_(other.position_),
+      checksum_(other.checksum_),
+      expected_crc_(other.expected_crc_),
+      copy_(std::move(other.copy_)) {
+    if (impl_ == nullptr) {
+        data_ = copy_.data_ptr();  // A copy lives in copy_, wherever its buffer went
+    }
+}
+
+Queue::Snapshot& Queue::Snapshot::operator=(Snapshot&& other) noexcept {
+    if (this != &other) {
+        impl_ = std::exchange(other.impl_, nullptr);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        position_ = other.position_;
+        checksum_ = other.checksum_;
+        expected_crc_ = other.expected_crc_;
+        copy_ = std::move(other.copy_);
+        if (impl_ == nullptr) {
+            data_ = copy_.data_ptr();
+        }
+    }
+    return *this;
+}
+
+bool Queue::Snapshot::valid() const noexcept {
+    return impl_ == nullptr || !impl_->overwritten(position_);
+}
+
+bool Queue::Snapshot::release() noexcept {
+    bool ok = valid();
+    if (ok && impl_ != nullptr && checksum_) {
+        const bool match = crc32c(data_, size_) == expected_crc_;
+        // A mismatch only counts if it was not the writer lapping us meanwhile
+        ok = match && valid();
+        if (!match && valid()) {
+            impl_->header_->reader_checksum_errors[impl_->reader_id_].fetch_add(1, std::memory_order_relaxed);
+        }
     }
+    impl_ = nullptr;
+    data_ = nullptr;
+    size_ = 0;
+    copy_ = Message();
+    return ok;
+}
+
+Queue::ResumeStatus Queue::resume_status() const {
+    if (!impl_) throw MessageQueueError("Queue not initialized");
+    return impl_->resume_status_;
+}
+
+void Queue::checkpoint() {
+    if (!impl_) throw MessageQueueError("Queue not initialized");
+    if (impl_->checkpoint_ == nullptr) {
+        throw MessageQueueError("Not a durable subscriber");
+    }
+    impl_->save_checkpoint();
+}
+
+uint64_t Queue::write_position() const {
+    if (!impl_) throw MessageQueueError("Queue not initialized");
+    return impl_->absolute(PackedPointer(impl_->header_->write_index.load(std::memory_order_acquire)));
+}
+
+bool Queue::overwritten(uint64_t position) const {
+    if (!impl_) throw MessageQueueError("Queue not initialized");
+    return impl_->overwritten(position);
 }
 
 size_t Queue::num_readers() const {
@@ -226,6 +1680,36 @@ bool Queue::all_readers_updated() const {
     return true;
 }
 
+size_t Queue::reclaim_idle_pages() {
+    if (!impl_) throw MessageQueueError("Queue not initialized");
+    if (!impl_->is_publisher_) {
+        throw MessageQueueError("Not initialized as publisher");
+    }
+
+    // Only an idle ring is reclaimed: with every reader caught up no byte of
+    // the data area will be read again, and since only the publisher writes
+    // there is no concurrent writer to race with.
+    if (!all_readers_updated()) {
+        return 0;
+    }
+
+    const uintptr_t page = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+    uintptr_t begin = reinterpret_cast<uintptr_t>(impl_->data_start_);
+    uintptr_t end = begin + impl_->size_;
+    begin = (begin + page - 1) & ~(page - 1);  // Keep the page shared with the header
+    end &= ~(page - 1);
+    if (end <= begin) {
+        return 0;
+    }
+
+    // MADV_REMOVE rather than MADV_DONTNEED: on a shared tmpfs/memfd mapping
+    // DONTNEED only drops our page tables, REMOVE frees the backing pages
+    if (::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_REMOVE) < 0) {
+        throw MessageQueueError("Failed to reclaim idle pages: " + std::string(strerror(errno)));
+    }
+    return end - begin;
+}
+
 std::string_view Queue::name() const {
     if (!impl_) return "";
     return impl_->name_;
@@ -239,6 +1723,176 @@ const void* Queue::raw_handle() const noexcept {
     return impl_.get();
 }
 
+// ============================================================================
+// Payload compression
+// ============================================================================
+
+bool compress_frame(gsl::span<const char> data, ByteBuffer& frame) {
+    const uint64_t raw_size = data.size();
+    if (raw_size <= sizeof(raw_size) + 1) {
+        return false;
+    }
+    // Anything that does not fit in one byte less than the payload is a loss
+    frame.resize(sizeof(raw_size) + std::min(lz4::compress_bound(data.size()), data.size() - sizeof(raw_size) - 1));
+    memcpy(frame.data(), &raw_size, sizeof(raw_size));
+    const size_t block = lz4::compress(data.data(), data.size(), frame.data() + sizeof(raw_size),
+                                       frame.size() - sizeof(raw_size));
+    if (block == 0) {
+        return false;
+    }
+    frame.resize(sizeof(raw_size) + block);
+    return true;
+}
+
+// ============================================================================
+// Stale segment reaper
+// ============================================================================
+
+namespace {
+
+// Header of a legacy msgq_queue_t segment (msgq_header_t in msgq.h, which
+// cannot be included next to this header). Those segments carry no magic.
+struct LegacySegmentHeader {
+    uint64_t num_readers;
+    uint64_t write_pointer;              // Wrap cycle << 32 | offset
+    uint64_t write_uid;                  // Random << 32 | publisher pid, 0 until one attached
+    uint64_t read_pointers[NUM_READERS];
+    uint64_t read_valids[NUM_READERS];
+    uint64_t read_uids[NUM_READERS];     // Random << 32 | reader pid
+};
+
+// Reader count in range, pointers 8-byte aligned inside the data area,
+// valid flags boolean, and a publisher or reader registered at some point
+bool looks_like_legacy_segment(const LegacySegmentHeader& header, size_t file_size) noexcept {
+    const uint64_t data_size = file_size - sizeof(LegacySegmentHeader);
+    auto pointer_ok = [data_size](uint64_t ptr) {
+        const uint64_t offset = ptr & 0xFFFFFFFFULL;
+        return offset <= data_size && offset % 8 == 0;
+    };
+    if (header.num_readers > NUM_READERS || !pointer_ok(header.write_pointer)) {
+        return false;
+    }
+    if (header.write_uid == 0 && header.num_readers == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < header.num_readers; ++i) {
+        if (!pointer_ok(header.read_pointers[i]) || header.read_valids[i] > 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool legacy_owner_alive(const LegacySegmentHeader& header) noexcept {
+    if (header.write_uid != 0 && process_alive(static_cast<pid_t>(header.write_uid & 0xFFFFFFFFULL))) {
+        return true;
+    }
+    for (size_t i = 0; i < header.num_readers; ++i) {
+        if (header.read_uids[i] != 0 && process_alive(static_cast<pid_t>(header.read_uids[i] & 0xFFFFFFFFULL))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// (device, inode) of every file another process has mapped, from
+// /proc/<pid>/maps. Legacy queues close their fd right after mmap and take
+// no lock, so a mapping is all a process that has not registered yet
+// leaves behind. Processes whose maps we may not read are not seen.
+std::set<std::pair<dev_t, ino_t>> files_mapped_by_others() {
+    std::set<std::pair<dev_t, ino_t>> mapped;
+    std::unique_ptr<DIR, int (*)(DIR*)> proc(::opendir("/proc"), ::closedir);
+    if (!proc) {
+        return mapped;
+    }
+    const std::string self = std::to_string(::getpid());
+    while (dirent* entry = ::readdir(proc.get())) {
+        if (entry->d_name[0] < '1' || entry->d_name[0] > '9' || self == entry->d_name) continue;
+        const std::string path = std::string("/proc/") + entry->d_name + "/maps";
+        std::unique_ptr<FILE, int (*)(FILE*)> maps(::fopen(path.c_str(), "re"), ::fclose);
+        if (!maps) continue;
+        char line[512];
+        while (::fgets(line, sizeof(line), maps.get()) != nullptr) {
+            unsigned int major = 0;
+            unsigned int minor = 0;
+            unsigned long inode = 0;
+            if (std::sscanf(line, "%*s %*s %*s %x:%x %lu", &major, &minor, &inode) == 3 && inode != 0) {
+                mapped.emplace(makedev(major, minor), static_cast<ino_t>(inode));
+            }
+        }
+    }
+    return mapped;
+}
+
+} // namespace
+
+ReapResult reap_stale_segments(const ReapOptions& options) {
+    ReapResult result;
+
+    std::unique_ptr<DIR, int (*)(DIR*)> dir(::opendir(options.directory.c_str()), ::closedir);
+    if (!dir) {
+        throw MessageQueueError("Failed to open " + options.directory + ": " + std::string(strerror(errno)));
+    }
+
+    // Read once, at the first legacy candidate
+    std::optional<std::set<std::pair<dev_t, ino_t>>> mapped;
+
+    const time_t now = ::time(nullptr);
+    while (dirent* entry = ::readdir(dir.get())) {
+        if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN) continue;
+
+        const std::string path = options.directory + "/" + entry->d_name;
+        FdGuard fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+        if (!fd.valid()) continue;
+
+        struct stat st;
+        if (::fstat(fd.get(), &st) < 0 || !S_ISREG(st.st_mode)) continue;
+        const size_t file_size = static_cast<size_t>(st.st_size);
+        if (file_size < sizeof(SegmentHeader) && (!options.legacy || file_size <= sizeof(LegacySegmentHeader))) continue;
+        // Grace period: the creator may not have registered its pid yet
+        if (now - st.st_mtime < options.min_age.count()) continue;
+
+        // Any open Queue holds LOCK_SH; holding LOCK_EX until the unlink
+        // also keeps new openers out while we decide
+        if (::flock(fd.get(), LOCK_EX | LOCK_NB) < 0) continue;
+
+        const size_t header_size = std::max(sizeof(SegmentHeader), sizeof(LegacySegmentHeader));
+        const size_t map_size = std::min(file_size, header_size);
+        void* addr = ::mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd.get(), 0);
+        if (addr == MAP_FAILED) continue;
+        MmapGuard map(addr, map_size);
+
+        if (file_size >= sizeof(SegmentHeader) &&
+            static_cast<const SegmentHeader*>(addr)->magic.load(std::memory_order_acquire) == SEGMENT_MAGIC) {
+            const auto* header = static_cast<const SegmentHeader*>(addr);
+            bool alive = process_alive(header->writer_pid.load(std::memory_order_acquire));
+            for (size_t i = 0; i < NUM_READERS && !alive; ++i) {
+                alive = process_alive(header->reader_pids[i].load(std::memory_order_acquire));
+            }
+            if (alive) continue;
+        } else if (options.legacy) {
+            // Legacy openers take no lock: go by the recorded pids, then
+            // make sure no process still maps the file
+            LegacySegmentHeader header;
+            memcpy(&header, addr, sizeof(header));
+            if (!looks_like_legacy_segment(header, file_size) || legacy_owner_alive(header)) continue;
+            if (!mapped) {
+                mapped = files_mapped_by_others();
+            }
+            if (mapped->count({st.st_dev, st.st_ino}) != 0) continue;
+        } else {
+            // Never touch files that are not ours (legacy msgq unless asked, event state, ...)
+            continue;
+        }
+
+        if (!options.dry_run && ::unlink(path.c_str()) < 0) continue;
+        result.reaped.push_back(path);
+        result.bytes_freed += static_cast<size_t>(st.st_blocks) * 512;
+    }
+
+    return result;
+}
+
 } // namespace msgq
 
 // Queue implementation - constructors and destructors
@@ -5,199 +5,82 @@
  * This header provides RAII-based, type-safe abstractions over the low-level msgq implementation
  */
 
+#include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <string>
 #include <vector>
 #include <memory>
+#include <memory_resource>
+#include <new>
+#include <optional>
 #include <atomic>
 #include <stdexcept>
 
-// C++20 std::span support
-#if __cplusplus >= 202002L
-  #include <span>
-#endif
-
-// Optional: GSL support
-// Install: sudo apt-get install gsl-lite-dev (Ubuntu/Debian)
-//          brew install gsl (macOS)
-#ifdef __has_include
-  #if __has_include(<gsl/gsl>)
-    #include <gsl/gsl>
-    #define MSGQ_HAS_GSL 1
-  #else
-    #define MSGQ_HAS_GSL 0
-  #endif
-#else
-  #define MSGQ_HAS_GSL 0
-#endif
+#include "span_modern.h"
+#include "default_init_allocator_modern.h"
+#include "topic_modern.h"
+
+namespace msgq {
 
 // ============================================================================
-// Span abstraction - unified interface for C++20 std::span and fallback
+// Compile-time constants and utilities
 // ============================================================================
 
-namespace msgq {
-  
-  #if __cplusplus >= 202002L
-    // C++20: Use std::span directly
-    template<typename T>
-    using span = std::span<T>;
-    
-    // Mark that we're using std::span
-    #define MSGQ_USING_STD_SPAN 1
-    
-    // Helper for creating spans with deduction
-    template<typename T>
-    constexpr span<T> make_span(T* data, size_t size) noexcept {
-      return span<T>(data, size);
-    }
-    
-    template<typename Container>
-    constexpr auto make_span(Container& c) noexcept {
-      return span<typename Container::value_type>(c);
-    }
-    
-    template<typename Container>
-    constexpr auto make_span(const Container& c) noexcept {
-      return span<const typename Container::value_type>(c);
-    }
-  
-  #elif MSGQ_HAS_GSL
-    // C++17 with GSL: Use gsl::span
-    using gsl::span;
-    
-    #undef MSGQ_USING_STD_SPAN
-    
-    template<typename T>
-    constexpr span<T> make_span(T* data, size_t size) noexcept {
-      return span<T>(data, size);
-    }
-    
-    template<typename Container>
-    constexpr auto make_span(Container& c) noexcept {
-      return span<typename Container::value_type>(c);
-    }
-    
-    template<typename Container>
-    constexpr auto make_span(const Container& c) noexcept {
-      return span<const typename Container::value_type>(c);
-    }
-  
-  #else
-    // C++17 fallback: Minimal span implementation
-    template<typename T>
-    class span {
-    private:
-      T* data_;
-      size_t size_;
-    
-    public:
-      // Constructors
-      constexpr span() noexcept : data_(nullptr), size_(0) {}
-      
-      constexpr span(T* data, size_t size) noexcept 
-        : data_(data), size_(size) {}
-      
-      // From containers (SFINAE-enabled)
-      template<typename Container>
-      constexpr span(Container& c) noexcept 
-        : data_(c.data()), size_(c.size()) {}
-      
-      template<typename Container>
-      constexpr span(const Container& c) noexcept 
-        : data_(const_cast<T*>(c.data())), size_(c.size()) {}
-      
-      // Copy constructor and assignment
-      constexpr span(const span&) noexcept = default;
-      constexpr span& operator=(const span&) noexcept = default;
-      
-      // Element access
-      [[nodiscard]] constexpr T* data() const noexcept { return data_; }
-      [[nodiscard]] constexpr size_t size() const noexcept { return size_; }
-      [[nodiscard]] constexpr size_t size_bytes() const noexcept { 
-        return size_ * sizeof(T); 
-      }
-      [[nodiscard]] constexpr bool empty() const noexcept { return size_ == 0; }
-      
-      // Indexed access
-      [[nodiscard]] constexpr T& operator[](size_t idx) const noexcept {
-        return data_[idx];
-      }
-      
-      [[nodiscard]] constexpr T& front() const noexcept {
-        return data_[0];
-      }
-      
-      [[nodiscard]] constexpr T& back() const noexcept {
-        return data_[size_ - 1];
-      }
-      
-      // Iterator support
-      [[nodiscard]] constexpr T* begin() const noexcept { return data_; }
-      [[nodiscard]] constexpr T* end() const noexcept { return data_ + size_; }
-      [[nodiscard]] constexpr const T* cbegin() const noexcept { return data_; }
-      [[nodiscard]] constexpr const T* cend() const noexcept { return data_ + size_; }
-      
-      // Subspan
-      [[nodiscard]] constexpr span subspan(size_t offset, size_t count = -1) const noexcept {
-        if (count == (size_t)-1) count = size_ - offset;
-        return span(data_ + offset, count);
-      }
-      
-      [[nodiscard]] constexpr span first(size_t count) const noexcept {
-        return span(data_, count);
-      }
-      
-      [[nodiscard]] constexpr span last(size_t count) const noexcept {
-        return span(data_ + size_ - count, count);
-      }
-      
-      // Comparison
-      constexpr bool operator==(const span& other) const noexcept {
-        return data_ == other.data_ && size_ == other.size_;
-      }
-      
-      constexpr bool operator!=(const span& other) const noexcept {
-        return !(*this == other);
-      }
-    };
-    
-    #undef MSGQ_USING_STD_SPAN
-    
-    // Helper functions for span creation
-    template<typename T>
-    constexpr span<T> make_span(T* data, size_t size) noexcept {
-      return span<T>(data, size);
-    }
+constexpr size_t DEFAULT_SEGMENT_SIZE = 10 * 1024 * 1024;
+constexpr size_t NUM_READERS = 15;
+constexpr size_t DEFAULT_TIMEOUT_MS = 100;
+
+static_assert(DEFAULT_SEGMENT_SIZE == TOPIC_DEFAULT_SEGMENT_SIZE, "untyped topics use the default size");
+
+// How a queue's backing segment is created and shared between processes
+enum class SegmentMode {
+    SharedFile,  // Named file under /dev/shm (default)
+    Memfd        // Sealed memfd handed to peers over a unix socket
+};
+
+// SegmentMode::Memfd when MSGQ_MEMFD is set, SegmentMode::SharedFile otherwise
+[[nodiscard]] SegmentMode default_segment_mode() noexcept;
+
+// Subscriber-side record filter: a record tagged `tag` is delivered when
+// (tag & mask) == value. The default (mask 0) accepts every record.
+struct TagFilter {
+    uint64_t mask = 0;
+    uint64_t value = 0;
     
-    template<typename Container>
-    constexpr auto make_span(Container& c) noexcept {
-      return span<typename Container::value_type>(c);
+    [[nodiscard]] static constexpr TagFilter exact(uint64_t tag) noexcept {
+        return TagFilter{~uint64_t{0}, tag};
     }
     
-    template<typename Container>
-    constexpr auto make_span(const Container& c) noexcept {
-      return span<const typename Container::value_type>(c);
+    [[nodiscard]] constexpr bool matches(uint64_t tag) const noexcept {
+        return (tag & mask) == value;
     }
-  
-  #endif // Span implementation selection
-  
-} // namespace msgq
-
-// Make gsl::span available as an alias
-namespace gsl {
-  using msgq::span;
-}
+};
 
-namespace msgq {
+// Everything a subscriber can ask for when attaching to a queue
+struct SubscriberOptions {
+    bool conflate = false;       // Always receive the newest message only
+    TagFilter filter{};          // Drop records whose tag does not match
+    uint32_t every_nth = 1;      // Deliver one message out of every N
+    double max_rate_hz = 0.0;    // Deliver at most this often, newest wins (0 = unlimited)
+    std::pmr::memory_resource* memory_resource = nullptr;  // Backs received Messages (null = default)
+    std::string durable_name;    // Resume from this named checkpoint after a restart (empty = start at the newest)
+    bool checkpoint_on_recv = true;  // Durable only: checkpoint every delivered message, else only in checkpoint()
+    size_t prefetch_distance = 128;  // Ring bytes past the received record to prefetch (0 = off)
+};
 
-// ============================================================================
-// Compile-time constants and utilities
-// ============================================================================
+// Everything a publisher can ask for when attaching to a queue
+struct PublisherOptions {
+    bool checksum = false;  // Store a CRC-32C of every record; readers verify it
+    // Payloads start at this alignment in the ring, and recv() allocates
+    // Messages with it, so as_span<T>() can feed aligned SIMD loads:
+    // 8, 16, 64 (cache line / AVX-512) or 4096 (O_DIRECT)
+    size_t record_alignment = 8;
+};
 
-constexpr size_t DEFAULT_SEGMENT_SIZE = 10 * 1024 * 1024;
-constexpr size_t NUM_READERS = 15;
-constexpr size_t DEFAULT_TIMEOUT_MS = 100;
+// Largest PublisherOptions::record_alignment; the ring starts on it
+constexpr size_t MAX_RECORD_ALIGNMENT = 4096;
 
 // Alignment helper
 constexpr size_t align_to_8(size_t n) noexcept {
@@ -241,40 +124,68 @@ public:
 
 class Message {
 private:
-    std::vector<char> data_;
+    // pmr so a consumer can hand recv() an arena (e.g. a per-cycle
+    // std::pmr::monotonic_buffer_resource) and drop every buffer at once.
+    // Sizing does not zero-fill: the bytes are always overwritten next.
+    ByteBuffer data_;
 
 public:
-    // Constructors
+    // Constructors. `resource` must outlive the Message; the default is
+    // std::pmr::get_default_resource() (new/delete unless changed).
     Message() = default;
     
-    explicit Message(size_t size) : data_(size) {}
+    explicit Message(std::pmr::memory_resource* resource) : data_(resource) {}
+    
+    // The buffer is left uninitialized
+    explicit Message(size_t size, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : data_(size, resource) {}
     
-    Message(gsl::span<const char> data) : data_(data.begin(), data.end()) {}
+    Message(gsl::span<const char> data, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : data_(copy_bytes(data.data(), data.size(), resource)) {}
     
     // Constructor for any span type (C++20 or with custom span)
     template<typename T>
-    explicit Message(gsl::span<T> data) noexcept
-      : data_(reinterpret_cast<const char*>(data.data()), 
-              reinterpret_cast<const char*>(data.data()) + data.size() * sizeof(T)) {}
+    explicit Message(gsl::span<T> data, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : data_(copy_bytes(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(T), resource)) {}
     
     // C++20 std::span constructor (only if std::span is different from msgq::span)
     #if __cplusplus >= 202002L && !defined(MSGQ_USING_STD_SPAN)
-    Message(std::span<const char> data) : data_(data.begin(), data.end()) {}
+    Message(std::span<const char> data, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : data_(copy_bytes(data.data(), data.size(), resource)) {}
     
     template<typename T>
-    explicit Message(std::span<T> data) noexcept
-      : data_(reinterpret_cast<const char*>(data.data()), 
-              reinterpret_cast<const char*>(data.data()) + data.size() * sizeof(T)) {}
+    explicit Message(std::span<T> data, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : data_(copy_bytes(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(T), resource)) {}
     #endif
     
     template<typename Iterator>
-    Message(Iterator begin, Iterator end) : data_(begin, end) {}
-    
-    // Rule of Five - use defaults (std::vector handles everything)
-    Message(const Message&) = default;
-    Message& operator=(const Message&) = default;
+    Message(Iterator begin, Iterator end, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : data_(begin, end, resource) {}
+    
+    // Rule of Five. Copy construction uses the default resource and copy
+    // assignment keeps the target's. Moves, including move assignment,
+    // adopt the source's buffer and resource (so its alignment survives
+    // `m = queue.recv()`) and never allocate. Copies go through memcpy:
+    // the vector's own would construct byte by byte, as it does for any
+    // allocator but std::allocator.
+    Message(const Message& other)
+        : data_(copy_bytes(other.data_.data(), other.data_.size(), std::pmr::get_default_resource())) {}
+    Message& operator=(const Message& other) {
+        if (this != &other) {
+            assign_bytes(data_, other.data_.data(), other.data_.size());
+        }
+        return *this;
+    }
     Message(Message&&) noexcept = default;
-    Message& operator=(Message&&) noexcept = default;
+    Message& operator=(Message&& other) noexcept {
+        // A defaulted assignment would copy into our resource whenever the
+        // two differ; rebuild the buffer around the source's instead
+        if (this != &other) {
+            data_.~ByteBuffer();
+            new (&data_) ByteBuffer(std::move(other.data_));
+        }
+        return *this;
+    }
     ~Message() = default;
     
     // Accessors
@@ -296,9 +207,12 @@ public:
         return std::span<char>(data_.data(), data_.size());
     }
     
-    // Generic typed span access for C++20
+    // Generic typed span access for C++20. Messages from recv() start at
+    // the publisher's record_alignment, so T may be a SIMD vector type;
+    // debug builds assert that the payload is aligned for T.
     template<typename T>
     [[nodiscard]] std::span<const T> as_span() const noexcept {
+        assert(aligned_to(alignof(T)));
         return std::span<const T>(
             reinterpret_cast<const T*>(data_.data()),
             data_.size() / sizeof(T)
@@ -307,6 +221,7 @@ public:
     
     template<typename T>
     [[nodiscard]] std::span<T> as_span() noexcept {
+        assert(aligned_to(alignof(T)));
         return std::span<T>(
             reinterpret_cast<T*>(data_.data()),
             data_.size() / sizeof(T)
@@ -316,13 +231,22 @@ public:
     
     [[nodiscard]] size_t size() const noexcept { return data_.size(); }
     
+    // The payload can be read in place with loads of `alignment` bytes
+    [[nodiscard]] bool aligned_to(size_t alignment) const noexcept {
+        return reinterpret_cast<uintptr_t>(data_.data()) % alignment == 0;
+    }
+    
     [[nodiscard]] bool empty() const noexcept { return data_.empty(); }
     
-    // Resize
+    // Resize; added bytes are uninitialized
     void resize(size_t new_size) { data_.resize(new_size); }
     
     void clear() noexcept { data_.clear(); }
     
+    [[nodiscard]] std::pmr::memory_resource* memory_resource() const noexcept {
+        return data_.get_allocator().resource();
+    }
+    
     // Raw access for compatibility
     [[nodiscard]] char* data_ptr() noexcept { return data_.data(); }
     [[nodiscard]] const char* data_ptr() const noexcept { return data_.data(); }
@@ -415,6 +339,40 @@ private:
     void cleanup() noexcept;
 };
 
+// ============================================================================
+// SharedSegment - mapped shared memory, named (/dev/shm) or memfd-backed
+// ============================================================================
+
+class MemfdSegment;
+
+class SharedSegment {
+private:
+    std::unique_ptr<MemfdSegment> memfd_;  // Memfd mode only; owns the fd
+    FdGuard fd_;                           // Named mode; holds LOCK_SH for the reaper
+    MmapGuard map_;
+
+public:
+    SharedSegment() noexcept;
+    
+    // Non-copyable, moveable
+    SharedSegment(const SharedSegment&) = delete;
+    SharedSegment& operator=(const SharedSegment&) = delete;
+    SharedSegment(SharedSegment&&) noexcept;
+    SharedSegment& operator=(SharedSegment&&) noexcept;
+    ~SharedSegment();
+    
+    // Open (creating if needed) and map `size` bytes of segment `name`
+    [[nodiscard]] static SharedSegment open(std::string_view name, size_t size, SegmentMode mode);
+    
+    // Same, with the /dev/shm path of a named segment already built
+    // (TopicInfo::c_path()); `path` is unused in memfd mode
+    [[nodiscard]] static SharedSegment open(std::string_view name, const char* path, size_t size,
+                                            SegmentMode mode);
+    
+    [[nodiscard]] void* data() const noexcept { return map_.get(); }
+    [[nodiscard]] size_t size() const noexcept { return map_.size(); }
+};
+
 // ============================================================================
 // Queue - Thread-safe lock-free queue wrapper
 // ============================================================================
@@ -428,6 +386,10 @@ private:
     // Private constructor for factory
     explicit Queue(std::unique_ptr<Impl> impl);
     
+    // recv() without conflation that returns nullopt when nothing was
+    // delivered, so drain() does not stop at a zero-length message
+    [[nodiscard]] std::optional<Message> try_recv(int timeout_ms);
+    
 public:
     // Non-copyable, moveable
     Queue(const Queue&) = delete;
@@ -437,11 +399,26 @@ public:
     ~Queue();
     
     // Factory methods
-    [[nodiscard]] static Queue create(std::string_view name, size_t size = DEFAULT_SEGMENT_SIZE);
+    [[nodiscard]] static Queue create(std::string_view name, size_t size = DEFAULT_SEGMENT_SIZE,
+                                      SegmentMode mode = default_segment_mode());
+    
+    // Open the queue of a registered topic, with its size and path fixed at
+    // compile time
+    [[nodiscard]] static Queue create(const TopicInfo& topic, SegmentMode mode = default_segment_mode());
+    
+    // Send message (single producer). `tag` travels in the record header
+    // and is matched against each subscriber's TagFilter.
+    void send(gsl::span<const char> data, uint64_t tag = 0);
+    void send(const Message& msg, uint64_t tag = 0);
+    
+    // Scatter-gather send: the parts are concatenated into one record,
+    // copied straight into the ring without a temporary buffer
+    void sendv(gsl::span<const gsl::span<const char>> parts, uint64_t tag = 0);
     
-    // Send message (single producer)
-    void send(gsl::span<const char> data);
-    void send(const Message& msg);
+    // Send a frame built by compress_frame() (e.g. on a CompressionPool
+    // worker). The record is flagged compressed and recv() hands
+    // subscribers the original payload.
+    void send_compressed(gsl::span<const char> frame, uint64_t tag = 0);
     
     // C++20 std::span overloads (only if std::span is different from msgq::span)
     #if __cplusplus >= 202002L && !defined(MSGQ_USING_STD_SPAN)
@@ -462,19 +439,154 @@ public:
     }
     #endif
     
-    // Receive message (multiple consumers)
+    // Receive message (multiple consumers). Blocks on a futex for up to
+    // timeout_ms (0 polls, negative waits forever); empty Message on timeout.
     [[nodiscard]] Message recv(int timeout_ms = DEFAULT_TIMEOUT_MS, bool conflate = false);
     [[nodiscard]] bool msg_ready() const;
     
-    // Publisher control
+    // View of the newest message, read in place in the ring instead of
+    // copied out. The writer is not held back: read through data(), then
+    // check valid() (or release()), and only trust what was read if it
+    // says true. Chunked and compressed messages have no contiguous
+    // plaintext in the ring; those are copied, and stay valid.
+    // The Queue must outlive its Snapshots.
+    class Snapshot {
+    public:
+        Snapshot() = default;
+        Snapshot(Snapshot&& other) noexcept;
+        Snapshot& operator=(Snapshot&& other) noexcept;
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        ~Snapshot() = default;
+        
+        [[nodiscard]] gsl::span<const char> data() const noexcept {
+            return gsl::span<const char>(data_, size_);
+        }
+        [[nodiscard]] size_t size() const noexcept { return size_; }
+        [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+        
+        // Points into the ring (false: a private copy)
+        [[nodiscard]] bool in_place() const noexcept { return impl_ != nullptr; }
+        
+        // The writer has not reached the record yet, so everything read
+        // from data() before this call was intact
+        [[nodiscard]] bool valid() const noexcept;
+        
+        // Final check and drop the view. With PublisherOptions::checksum
+        // the payload is also verified (one CRC pass over it, no copy);
+        // a mismatch is counted in checksum_errors().
+        bool release() noexcept;
+        
+    private:
+        friend class Queue;
+        
+        const Impl* impl_ = nullptr;  // Null when empty or copied
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        uint64_t position_ = 0;       // Absolute ring position of the record
+        bool checksum_ = false;       // Record carries a CRC of the payload
+        uint32_t expected_crc_ = 0;
+        Message copy_;
+    };
+    
+    // Conflate to the newest message and return a view of it, waiting up
+    // to timeout_ms for one; empty Snapshot on timeout. The cursor moves
+    // past it as with recv(). For large state topics read now and then,
+    // where copying every message out costs more than the reading.
+    [[nodiscard]] Snapshot snapshot(int timeout_ms = DEFAULT_TIMEOUT_MS);
+    
+    // Hand the messages already waiting, up to `max_messages`, to
+    // `handler(Message&)` without blocking; returns how many it got,
+    // zero-length messages included. Each receive prefetches the records
+    // after the one it returns (SubscriberOptions::prefetch_distance), so
+    // their headers arrive while the handler runs.
+    template <typename Handler>
+    size_t drain(Handler&& handler, size_t max_messages = SIZE_MAX) {
+        size_t count = 0;
+        while (count < max_messages) {
+            std::optional<Message> msg = try_recv(0);
+            if (!msg) {
+                break;
+            }
+            handler(*msg);
+            count++;
+        }
+        return count;
+    }
+    
+    // Publisher control. A queue has one publisher: this throws while
+    // another Queue (in any process) still holds the slot; the slot is
+    // taken over once that Queue is destroyed or its process died.
     void init_publisher();
-    void init_subscriber(bool conflate = false);
+    // With options.checksum each record carries a CRC-32C of its payload
+    // (SSE4.2 / ARMv8 CRC instructions); records that fail the check are
+    // dropped by the reader and counted in checksum_errors()
+    void init_publisher(const PublisherOptions& options);
+    // Records not matching `filter` are skipped by reading their header
+    // only; they are never copied and never wake this subscriber
+    void init_subscriber(bool conflate = false, TagFilter filter = {});
+    
+    // Decimated / rate-limited subscription. Skipped messages are stepped
+    // over in the cursor advance and never copied into a Message.
+    void init_subscriber(const SubscriberOptions& options);
+    
+    // What is waiting for this subscriber, computed from the cursors and
+    // the oldest record's header (no syscalls, nothing copied)
+    struct Backlog {
+        size_t messages = 0;                     // Pending messages, before tag filtering
+        size_t bytes = 0;                        // Ring bytes between our cursor and the writer
+        std::chrono::nanoseconds oldest_age{0};  // Time since the oldest pending message was sent
+        bool lapped = false;                     // Writer overran us; the next recv resyncs
+    };
+    [[nodiscard]] Backlog backlog() const;
+    
+    // Watchdog view of the topic: how old the newest message is and how far
+    // behind this subscriber is. Reads only the shared header and the oldest
+    // record's header; the cursor does not move.
+    struct Freshness {
+        std::chrono::steady_clock::time_point newest_timestamp{};  // Send time of the newest message, epoch if none yet
+        size_t backlog_messages = 0;  // As in Backlog::messages
+        size_t backlog_bytes = 0;     // As in Backlog::bytes
+        uint64_t overruns = 0;        // Times the writer lapped this subscriber
+    };
+    [[nodiscard]] Freshness freshness() const;
+    
+    // Records this subscriber dropped because their checksum did not match
+    [[nodiscard]] uint64_t checksum_errors() const;
+    
+    // Durable subscriptions (SubscriberOptions::durable_name): the cursor and
+    // the sequence number of the next message are kept in a small file under
+    // /dev/shm/[OPENPILOT_PREFIX/]msgq_cursors/<queue>/, locked while the
+    // subscriber is open. init_subscriber resumes from it when those records
+    // are still in the ring, and starts at the newest message otherwise.
+    enum class ResumeStatus {
+        NotDurable,  // No durable_name
+        Started,     // No checkpoint yet; started at the newest message
+        Resumed,     // Continued where the checkpoint left off
+        Lapped,      // The checkpointed records were overwritten (or the ring was recreated)
+    };
+    [[nodiscard]] ResumeStatus resume_status() const;
+    
+    // Save the position after the last delivered message. With
+    // checkpoint_on_recv off this is the only time the checkpoint moves, so
+    // a restart redelivers everything received since (at-least-once).
+    void checkpoint();
+    
+    // Publisher side: ring position right after the newest record. Once
+    // overwritten(position) is true, no reader can receive the records
+    // written before it any more (they were lapped).
+    [[nodiscard]] uint64_t write_position() const;
+    [[nodiscard]] bool overwritten(uint64_t position) const;
     
     // Status queries
     [[nodiscard]] size_t num_readers() const;
     [[nodiscard]] bool all_readers_updated() const;
     [[nodiscard]] std::string_view name() const;
     
+    // Publisher only: return the data pages of an idle ring (every reader
+    // caught up) to the kernel. Returns the number of bytes released.
+    size_t reclaim_idle_pages();
+    
     // For low-level access if needed
     [[nodiscard]] void* raw_handle() noexcept;
     [[nodiscard]] const void* raw_handle() const noexcept;
@@ -490,6 +602,42 @@ public:
         : std::runtime_error(msg) {}
 };
 
+// ============================================================================
+// Payload compression
+// ============================================================================
+
+// Encode `data` as a compressed frame for Queue::send_compressed(): the
+// uint64_t payload size followed by an LZ4 block (lz4_block_modern.h).
+// Returns false, with `frame` unspecified, if the frame would not be
+// smaller than `data`; send it uncompressed then.
+[[nodiscard]] bool compress_frame(gsl::span<const char> data, ByteBuffer& frame);
+
+// ============================================================================
+// Stale segment reaper
+// ============================================================================
+
+struct ReapOptions {
+    std::string directory = "/dev/shm";
+    std::chrono::seconds min_age{60};  // Skip recently modified segments
+    bool dry_run = false;              // Report only, do not unlink
+    bool legacy = false;               // Also reap legacy msgq segments (MSGQPubSocket / MSGQSubSocket)
+};
+
+struct ReapResult {
+    std::vector<std::string> reaped;   // Paths unlinked (or that would be)
+    size_t bytes_freed = 0;            // tmpfs blocks released
+};
+
+// Unlink queue segments in `options.directory` that no process has open and
+// whose recorded publisher and reader pids are all dead. Files that are not
+// Queue segments are never touched.
+// Legacy msgq segments have no magic and take no lock. With options.legacy
+// they are recognized by their header (a consistent msgq_header_t with a
+// registered publisher or reader) and reaped when those pids are dead and
+// no process maps the file; only point that at directories holding msgq
+// segments alone.
+[[nodiscard]] ReapResult reap_stale_segments(const ReapOptions& options = {});
+
 // ============================================================================
 // Backward compatibility layer - C-style API wrappers
 // ============================================================================
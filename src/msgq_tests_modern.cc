@@ -4,15 +4,42 @@
 /// @date 2024
 
 #include <catch2/catch.hpp>
+// 现代头文件须在 msgq.h 之前：后者把 NUM_READERS 等定义成宏
+#include <msgq/msgq_modern.h>
+#include <msgq/buffer_pool_modern.h>
 #include <msgq/msgq.h>
-
+#include <msgq/memfd_segment_modern.h>
+#include <msgq/crc32c_modern.h>
+#include <msgq/lz4_block_modern.h>
+#include <msgq/unix_socket_modern.h>
+#include <msgq/multicast_socket_modern.h>
+#include <msgq/realtime_modern.h>
+#include <msgq/rpc_modern.h>
+#include <msgq/clock_modern.h>
+#include <msgq/event_modern.h>
+#include <msgq/poll_scheduler_modern.h>
+#include <msgq/topic_modern.h>
+#include <msgq/compression_pool_modern.h>
+
+#include <algorithm>
+#include <csignal>
 #include <cstring>
 #include <filesystem>
 #include <chrono>
 #include <iostream>
 #include <sstream>
+#include <system_error>
 #include <random>
 #include <memory>
+#include <memory_resource>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <sched.h>
 
 // ============================================================================
 // 测试工具类
@@ -439,6 +466,1536 @@ TEST_CASE_METHOD(MessageQueueTestFixture, "msgq_init_subscriber init 2 subscribe
   REQUIRE(q2.reader_id == 1);
 }
 
+TEST_CASE_METHOD(MessageQueueTestFixture, "memfd segment attach shares memory", "[unit]") {
+  TestLogger::debug("Testing memfd segment rendezvous");
+
+  const size_t seg_size = 4096;
+  auto owner = msgq::MemfdSegment::open(queue_name, seg_size);
+  auto peer = msgq::MemfdSegment::open(queue_name, seg_size);
+
+  REQUIRE(owner->is_owner());
+  REQUIRE_FALSE(peer->is_owner());
+
+  char* a = (char *)mmap(nullptr, seg_size, PROT_READ | PROT_WRITE, MAP_SHARED, owner->fd(), 0);
+  char* b = (char *)mmap(nullptr, seg_size, PROT_READ | PROT_WRITE, MAP_SHARED, peer->fd(), 0);
+  REQUIRE(a != MAP_FAILED);
+  REQUIRE(b != MAP_FAILED);
+
+  a[100] = 42;
+  REQUIRE(b[100] == 42);
+
+  // 已密封：不能改变大小；也不会在 /dev/shm 留下文件
+  REQUIRE(ftruncate(peer->fd(), seg_size * 2) < 0);
+  REQUIRE(access(queue_path.c_str(), F_OK) != 0);
+
+  // 大小不一致的打开请求被拒绝
+  REQUIRE_THROWS(msgq::MemfdSegment::open(queue_name, seg_size * 2));
+
+  // 创建者先退出：后来者仍连到同一块内存，而不是另建一个段
+  munmap(a, seg_size);
+  owner.reset();
+  auto late = msgq::MemfdSegment::open(queue_name, seg_size);
+  REQUIRE_FALSE(late->is_owner());
+  char* c = (char *)mmap(nullptr, seg_size, PROT_READ | PROT_WRITE, MAP_SHARED, late->fd(), 0);
+  REQUIRE(c != MAP_FAILED);
+  REQUIRE(c[100] == 42);
+
+  // 所有持有者都退出后才会新建
+  munmap(b, seg_size);
+  munmap(c, seg_size);
+  peer.reset();
+  late.reset();
+  auto fresh = msgq::MemfdSegment::open(queue_name, seg_size);
+  REQUIRE(fresh->is_owner());
+}
+
+TEST_CASE("crc32c matches reference values", "[unit]") {
+  TestLogger::debug("Testing CRC-32C kernels");
+
+  // RFC 3720 附录 B.4 的检查值
+  REQUIRE(msgq::crc32c("123456789", 9) == 0xE3069283u);
+  std::vector<unsigned char> zeros(32, 0);
+  REQUIRE(msgq::crc32c(zeros.data(), zeros.size()) == 0x8A9136AAu);
+
+  // 跨越多通道分块边界、非对齐起点，并分段续算
+  std::mt19937 rng(42);
+  std::vector<unsigned char> data(3 * 8192 * 2 + 1000);
+  for (auto& c : data) {
+    c = static_cast<unsigned char>(rng());
+  }
+  uint32_t bitwise = ~0u;
+  for (size_t i = 1; i < data.size(); ++i) {
+    bitwise ^= data[i];
+    for (int k = 0; k < 8; ++k) {
+      bitwise = (bitwise & 1) ? (bitwise >> 1) ^ 0x82f63b78u : bitwise >> 1;
+    }
+  }
+  bitwise = ~bitwise;
+
+  const size_t split = 12345;
+  const uint32_t head = msgq::crc32c(data.data() + 1, split);
+  REQUIRE(msgq::crc32c(data.data() + 1, data.size() - 1) == bitwise);
+  REQUIRE(msgq::crc32c(data.data() + 1 + split, data.size() - 1 - split, head) == bitwise);
+}
+
+TEST_CASE("lz4 block codec round trips", "[unit]") {
+  TestLogger::debug("Testing LZ4 block codec");
+
+  std::mt19937 rng(7);
+  for (size_t size : {size_t{0}, size_t{1}, size_t{12}, size_t{13}, size_t{1000}, size_t{300000}}) {
+    // 短周期重复（重叠拷贝）、随机片段与长段回溯混合
+    std::vector<char> input(size);
+    for (size_t i = 0; i < size; ++i) {
+      input[i] = (i > 16 && rng() % 4 != 0) ? input[i - 1 - rng() % 16] : static_cast<char>(rng());
+    }
+    std::vector<char> block(msgq::lz4::compress_bound(size));
+    const size_t n = msgq::lz4::compress(input.data(), size, block.data(), block.size());
+    REQUIRE(n > 0);
+
+    std::vector<char> output(size);
+    REQUIRE(msgq::lz4::decompress(block.data(), n, output.data(), output.size()));
+    REQUIRE(output == input);
+
+    // 截断的块与错误的原始大小都必须被拒绝
+    if (n > 1) {
+      REQUIRE_FALSE(msgq::lz4::decompress(block.data(), n - 1, output.data(), output.size()));
+    }
+    std::vector<char> larger(size + 1);
+    REQUIRE_FALSE(msgq::lz4::decompress(block.data(), n, larger.data(), larger.size()));
+  }
+
+  // 放不下时返回 0，而不是越界写
+  std::vector<char> random(4096);
+  for (auto& c : random) {
+    c = static_cast<char>(rng());
+  }
+  std::vector<char> small(random.size() / 2);
+  REQUIRE(msgq::lz4::compress(random.data(), random.size(), small.data(), small.size()) == 0);
+}
+
+/// @brief 返回一个已退出并被回收的子进程的 pid
+static pid_t dead_pid() {
+  pid_t pid = fork();
+  if (pid == 0) {
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+  return pid;
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "reaper removes segments of dead processes", "[unit]") {
+  TestLogger::debug("Testing stale segment reaping");
+
+  const std::string dir = "/dev/shm/reap_" + queue_name;
+  std::filesystem::create_directory(dir);
+
+  // 子进程建好队列、登记为发布者后直接退出，段文件留在 /dev/shm
+  pid_t child = fork();
+  if (child == 0) {
+    msgq::Queue queue = msgq::Queue::create(queue_name, 64 * 1024);
+    queue.init_publisher();
+    _exit(0);
+  }
+  int status = 0;
+  waitpid(child, &status, 0);
+  REQUIRE(WIFEXITED(status));
+  std::filesystem::rename(queue_path, dir + "/modern");
+
+  // 旧版 msgq 段：没有魔数，只有 msgq_header_t（3 + 3 * 15 个 uint64）
+  auto write_legacy = [&](const std::string& name, pid_t writer) {
+    std::vector<uint64_t> segment(8192 / sizeof(uint64_t), 0);
+    segment[1] = 128;                                          // write_pointer
+    segment[2] = (uint64_t{0x1234} << 32) | static_cast<uint32_t>(writer);  // write_uid
+    std::FILE* f = std::fopen((dir + "/" + name).c_str(), "wb");
+    REQUIRE(f != nullptr);
+    std::fwrite(segment.data(), sizeof(uint64_t), segment.size(), f);
+    std::fclose(f);
+  };
+  write_legacy("legacy_stale", dead_pid());
+  write_legacy("legacy_live", getpid());
+  // 不认识的文件
+  std::vector<char> junk(8192, 'x');
+  std::FILE* f = std::fopen((dir + "/junk").c_str(), "wb");
+  std::fwrite(junk.data(), 1, junk.size(), f);
+  std::fclose(f);
+
+  auto names = [](const msgq::ReapResult& result) {
+    std::vector<std::string> out;
+    for (const auto& path : result.reaped) {
+      out.push_back(std::filesystem::path(path).filename().string());
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+  };
+
+  msgq::ReapOptions options;
+  options.directory = dir;
+  options.min_age = std::chrono::seconds(0);
+
+  // 默认只认现代段；--dry-run 只报告不删除
+  options.dry_run = true;
+  REQUIRE(names(msgq::reap_stale_segments(options)) == std::vector<std::string>{"modern"});
+  options.legacy = true;
+  REQUIRE(names(msgq::reap_stale_segments(options)) == std::vector<std::string>{"legacy_stale", "modern"});
+  REQUIRE(std::filesystem::exists(dir + "/modern"));
+  REQUIRE(std::filesystem::exists(dir + "/legacy_stale"));
+
+  // 仍被某个进程映射的旧版段不删，即使登记的 pid 都已退出
+  int fd = open((dir + "/legacy_stale").c_str(), O_RDONLY);
+  REQUIRE(fd >= 0);
+  int pipe_fds[2];
+  REQUIRE(pipe(pipe_fds) == 0);
+  pid_t mapper = fork();
+  if (mapper == 0) {
+    void* addr = mmap(nullptr, 8192, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    char ready = addr != MAP_FAILED ? 1 : 0;
+    (void)!write(pipe_fds[1], &ready, 1);
+    pause();
+    _exit(0);
+  }
+  close(fd);
+  char ready = 0;
+  REQUIRE(read(pipe_fds[0], &ready, 1) == 1);
+  REQUIRE(ready == 1);
+  options.dry_run = false;
+  REQUIRE(names(msgq::reap_stale_segments(options)) == std::vector<std::string>{"modern"});
+  kill(mapper, SIGKILL);
+  waitpid(mapper, nullptr, 0);
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+
+  REQUIRE(names(msgq::reap_stale_segments(options)) == std::vector<std::string>{"legacy_stale"});
+  REQUIRE_FALSE(std::filesystem::exists(dir + "/modern"));
+  REQUIRE_FALSE(std::filesystem::exists(dir + "/legacy_stale"));
+  REQUIRE(std::filesystem::exists(dir + "/legacy_live"));
+  REQUIRE(std::filesystem::exists(dir + "/junk"));
+
+  std::filesystem::remove_all(dir);
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "Queue::sendv round trips across a wrap", "[unit]") {
+  TestLogger::debug("Testing scatter-gather send through the ring");
+
+  msgq::Queue sub = msgq::Queue::create(queue_name, 4096);
+  sub.init_subscriber();
+  msgq::Queue pub = msgq::Queue::create(queue_name, 4096);
+  pub.init_publisher();
+
+  // 每轮先积压几条再读，消息长度各异，几轮下来必然跨过环尾回绕
+  std::mt19937 rng(78);
+  size_t sent_bytes = 0;
+  for (int round = 0; round < 80; ++round) {
+    std::vector<std::string> expected;
+    for (int i = 0; i < 3; ++i) {
+      std::string head(1 + rng() % 40, static_cast<char>('a' + round % 26));
+      std::string body(rng() % 200, static_cast<char>('A' + i));
+      std::string tail(rng() % 3, '!');
+      const gsl::span<const char> parts[] = {
+        {head.data(), head.size()}, {}, {body.data(), body.size()}, {tail.data(), tail.size()}};
+      pub.sendv(gsl::span<const gsl::span<const char>>(parts, 4));
+      expected.push_back(head + body + tail);
+      sent_bytes += expected.back().size();
+    }
+    for (const auto& want : expected) {
+      msgq::Message msg = sub.recv(0);
+      REQUIRE(std::string(msg.data().data(), msg.size()) == want);
+    }
+  }
+  REQUIRE(sent_bytes > 4 * 4096);
+  REQUIRE(sub.recv(0).empty());
+}
+
+/// @brief 生成可校验内容的大消息
+static std::string chunked_payload(size_t size, char seed) {
+  std::string payload(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    payload[i] = static_cast<char>(seed + i * 7 + i / 4096);
+  }
+  return payload;
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "chunked messages reach healthy readers past a stalled one", "[unit]") {
+  TestLogger::debug("Testing chunked send with a stalled reader");
+
+  msgq::Queue healthy = msgq::Queue::create(queue_name, 64 * 1024);
+  healthy.init_subscriber();
+  msgq::Queue stalled = msgq::Queue::create(queue_name, 64 * 1024);
+  stalled.init_subscriber();
+  msgq::Queue pub = msgq::Queue::create(queue_name, 64 * 1024);
+  pub.init_publisher();
+
+  // 一条消息横跨十几个分片；停住的读者只拖住发送一次超时，
+  // 健康的读者仍被等待并收到完整消息
+  const std::string first = chunked_payload(1024 * 1024, 'a');
+  const std::string second = chunked_payload(512 * 1024, 'b');
+  std::thread sender([&] {
+    pub.send(gsl::span<const char>(first.data(), first.size()));
+    pub.send(gsl::span<const char>(second.data(), second.size()));
+  });
+
+  // 健康的读者也晚到一会儿：发送者必须等它，而不是连它一起套圈
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  msgq::Message got_first = healthy.recv(5000);
+  msgq::Message got_second = healthy.recv(5000);
+  sender.join();
+  REQUIRE(std::string(got_first.data().data(), got_first.size()) == first);
+  REQUIRE(std::string(got_second.data().data(), got_second.size()) == second);
+
+  // 停住的读者被套圈：收不到残缺的消息
+  for (msgq::Message msg = stalled.recv(0); !msg.empty(); msg = stalled.recv(0)) {
+    const std::string text(msg.data().data(), msg.size());
+    REQUIRE((text == first || text == second));
+  }
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "chunked messages arrive through recv(0)", "[unit]") {
+  TestLogger::debug("Testing chunked reassembly with polling receives");
+
+  msgq::Queue sub = msgq::Queue::create(queue_name, 64 * 1024);
+  sub.init_subscriber();
+  msgq::Queue pub = msgq::Queue::create(queue_name, 64 * 1024);
+  pub.init_publisher();
+
+  const std::string payload = chunked_payload(1024 * 1024, 'z');
+  std::thread sender([&] {
+    for (int i = 0; i < 3; ++i) {
+      pub.send(gsl::span<const char>(payload.data(), payload.size()));
+    }
+  });
+
+  // 轮询接收：分片 0 读出后，其余分片不因超时为 0 而被丢弃
+  int received = 0;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (received < 3 && std::chrono::steady_clock::now() < deadline) {
+    msgq::Message msg = sub.recv(0);
+    if (msg.empty()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
+    }
+    REQUIRE(std::string(msg.data().data(), msg.size()) == payload);
+    received++;
+  }
+  sender.join();
+  REQUIRE(received == 3);
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "subscribers receive only records matching their tag filter", "[unit]") {
+  TestLogger::debug("Testing tag-filtered subscriptions");
+
+  msgq::Queue all = msgq::Queue::create(queue_name, 64 * 1024);
+  all.init_subscriber();
+  msgq::Queue even = msgq::Queue::create(queue_name, 64 * 1024);
+  even.init_subscriber(false, msgq::TagFilter{1, 0});
+  msgq::Queue seven = msgq::Queue::create(queue_name, 64 * 1024);
+  seven.init_subscriber(false, msgq::TagFilter::exact(7));
+  msgq::Queue pub = msgq::Queue::create(queue_name, 64 * 1024);
+  pub.init_publisher();
+
+  auto text = [](const msgq::Message& msg) { return std::string(msg.data().data(), msg.size()); };
+  for (uint64_t tag = 0; tag < 20; ++tag) {
+    const std::string payload = std::to_string(tag);
+    pub.send(gsl::span<const char>(payload.data(), payload.size()), tag);
+  }
+  for (uint64_t tag = 0; tag < 20; ++tag) {
+    REQUIRE(text(all.recv(0)) == std::to_string(tag));
+  }
+  for (uint64_t tag = 0; tag < 20; tag += 2) {
+    REQUIRE(text(even.recv(0)) == std::to_string(tag));
+  }
+  REQUIRE(text(seven.recv(0)) == "7");
+  REQUIRE(all.recv(0).empty());
+  REQUIRE(even.recv(0).empty());
+  REQUIRE(seven.recv(0).empty());
+
+  // 分片消息的每个分片都带标签：匹配的读者收到完整消息，其余读者跳过
+  const std::string big = chunked_payload(256 * 1024, 'q');
+  msgq::Message got_all;
+  std::thread reader([&] { got_all = all.recv(5000); });
+  std::thread sender([&] { pub.send(gsl::span<const char>(big.data(), big.size()), 2); });
+  msgq::Message got_even = even.recv(5000);
+  sender.join();
+  reader.join();
+  REQUIRE(text(got_all) == big);
+  REQUIRE(text(got_even) == big);
+  REQUIRE(seven.recv(0).empty());
+
+  // 被过滤的流量远超环大小时，阻塞中的读者落后半个环就被唤醒去跳过，
+  // 不被套圈，仍收到之后匹配的记录
+  const uint64_t overruns = seven.freshness().overruns;
+  msgq::Message got_late;
+  std::thread receiver([&] { got_late = seven.recv(5000); });
+  const std::string filler(100, 'f');
+  for (int i = 0; i < 2000; ++i) {
+    pub.send(gsl::span<const char>(filler.data(), filler.size()), 1);
+    if (i % 100 == 99) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  }
+  const std::string late = "late";
+  pub.send(gsl::span<const char>(late.data(), late.size()), 7);
+  receiver.join();
+  REQUIRE(text(got_late) == "late");
+  REQUIRE(seven.recv(0).empty());
+  REQUIRE(seven.freshness().overruns == overruns);
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "decimated subscriptions skip messages within one deadline", "[unit]") {
+  TestLogger::debug("Testing decimated and rate-limited subscriptions");
+
+  msgq::SubscriberOptions every_third;
+  every_third.every_nth = 3;
+  msgq::Queue sub = msgq::Queue::create(queue_name, 64 * 1024);
+  sub.init_subscriber(every_third);
+  msgq::SubscriberOptions rate;
+  rate.max_rate_hz = 10.0;
+  msgq::Queue limited = msgq::Queue::create(queue_name, 64 * 1024);
+  limited.init_subscriber(rate);
+  msgq::Queue pub = msgq::Queue::create(queue_name, 64 * 1024);
+  pub.init_publisher();
+
+  auto send = [&](const std::string& text) { pub.send(gsl::span<const char>(text.data(), text.size())); };
+  auto text = [](const msgq::Message& msg) { return std::string(msg.data().data(), msg.size()); };
+
+  // 每 3 条投递一条
+  for (int i = 0; i < 9; ++i) {
+    send(std::to_string(i));
+  }
+  std::string got;
+  for (msgq::Message msg = sub.recv(0); !msg.empty(); msg = sub.recv(0)) {
+    got += text(msg);
+  }
+  REQUIRE(got == "036");
+
+  // 限速：窗口内最新的一条胜出，下一条要等窗口打开
+  REQUIRE(text(limited.recv(0)) == "8");
+  REQUIRE(limited.recv(0).empty());
+  send("a");
+  send("b");
+  auto start = std::chrono::steady_clock::now();
+  REQUIRE(text(limited.recv(1000)) == "b");
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  REQUIRE(elapsed >= std::chrono::milliseconds(50));
+  REQUIRE(elapsed < std::chrono::milliseconds(500));
+
+  // 窗口在超时之后才打开：按超时返回，不等到窗口
+  send("c");
+  start = std::chrono::steady_clock::now();
+  REQUIRE(limited.recv(20).empty());
+  REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(80));
+
+  // 等待中跳过的消息不延长超时：整个 recv 受同一个截止时间约束
+  while (!sub.recv(0).empty()) {
+  }
+  send("x");
+  REQUIRE(text(sub.recv(0)) == "x");
+  std::thread sender([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    send("skipped");
+  });
+  start = std::chrono::steady_clock::now();
+  REQUIRE(sub.recv(200).empty());
+  elapsed = std::chrono::steady_clock::now() - start;
+  sender.join();
+  REQUIRE(elapsed >= std::chrono::milliseconds(190));
+  REQUIRE(elapsed < std::chrono::milliseconds(300));
+}
+
+TEST_CASE("poll scheduler orders by priority, deadline and starvation", "[unit]") {
+  TestLogger::debug("Testing poll result ordering");
+
+  using namespace std::chrono_literals;
+  int a = 0, b = 0, c = 0, d = 0;
+  msgq::PollScheduler scheduler;
+  scheduler.set_options(&b, msgq::PollOptions{5, 0ms});
+  scheduler.set_options(&c, msgq::PollOptions{5, 0ms});
+  scheduler.set_options(&d, msgq::PollOptions{-1, 20ms});
+  const auto t0 = msgq::PollScheduler::Clock::time_point{} + 1s;
+
+  // 高优先级在前；同优先级、同时就绪时保持注册顺序
+  std::vector<int*> ready = {&a, &b, &c, &d};
+  scheduler.order(ready, t0);
+  REQUIRE(ready == std::vector<int*>{&b, &c, &a, &d});
+
+  // 同优先级按等待时长：c 持续就绪，b 被读空后重新就绪
+  ready = {&a, &c, &d};
+  scheduler.order(ready, t0 + 5ms);
+  ready = {&a, &b, &c, &d};
+  scheduler.order(ready, t0 + 10ms);
+  REQUIRE(ready == std::vector<int*>{&c, &b, &a, &d});
+  REQUIRE(scheduler.pending_age(&c, t0 + 10ms) == 10ms);
+  REQUIRE(scheduler.pending_age(&b, t0 + 10ms) == 0ms);
+
+  // 超过截止时间的低优先级套接字排到最前
+  ready = {&a, &b, &c, &d};
+  scheduler.order(ready, t0 + 20ms);
+  REQUIRE(ready.front() == &d);
+
+  // 防饿死：等待超过上限的套接字都被提前，等待最久者优先
+  ready = {&b, &a};
+  scheduler.order(ready, t0 + 30ms);
+  REQUIRE(ready == std::vector<int*>{&b, &a});
+  ready = {&b, &a};
+  scheduler.order(ready, t0 + 100ms);
+  REQUIRE(ready == std::vector<int*>{&a, &b});  // a 已等 100ms，b 只等了 90ms
+
+  // 关闭防饿死后只按优先级
+  scheduler.set_starvation_limit(0ms);
+  ready = {&a, &b};
+  scheduler.order(ready, t0 + 200ms);
+  REQUIRE(ready == std::vector<int*>{&b, &a});
+
+  // 未登记选项的套接字按默认优先级 0 处理
+  int e = 0;
+  std::vector<int*> unknown = {&e, &b};
+  scheduler.order(unknown, t0 + 210ms);
+  REQUIRE(unknown == std::vector<int*>{&b, &e});
+  REQUIRE(scheduler.pending_age(&a, t0 + 210ms) == 0ms);
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "backlog counts pending messages from sequences", "[unit]") {
+  TestLogger::debug("Testing Queue::backlog");
+
+  msgq::Queue sub = msgq::Queue::create(queue_name, 64 * 1024);
+  sub.init_subscriber();
+  msgq::Queue pub = msgq::Queue::create(queue_name, 64 * 1024);
+  pub.init_publisher();
+
+  REQUIRE(sub.backlog().messages == 0);
+  REQUIRE(sub.backlog().bytes == 0);
+
+  const std::string payload(100, 'p');
+  for (int i = 0; i < 10; ++i) {
+    pub.send(gsl::span<const char>(payload.data(), payload.size()));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  msgq::Queue::Backlog backlog = sub.backlog();
+  REQUIRE(backlog.messages == 10);
+  REQUIRE(backlog.bytes >= 10 * payload.size());
+  REQUIRE(backlog.oldest_age >= std::chrono::milliseconds(5));
+  REQUIRE_FALSE(backlog.lapped);
+
+  REQUIRE(sub.recv(0).size() == payload.size());
+  REQUIRE(sub.backlog().messages == 9);
+  REQUIRE(sub.backlog().bytes < backlog.bytes);
+
+  while (!sub.recv(0).empty()) {
+  }
+  REQUIRE(sub.backlog().messages == 0);
+  REQUIRE(sub.backlog().bytes == 0);
+
+  // 跨过回绕：计数仍然来自序号，不随环的位置变化
+  for (int round = 0; round < 50; ++round) {
+    for (int i = 0; i < 20; ++i) {
+      pub.send(gsl::span<const char>(payload.data(), payload.size()));
+    }
+    REQUIRE(sub.backlog().messages == 20);
+    while (!sub.recv(0).empty()) {
+    }
+    REQUIRE(sub.backlog().messages == 0);
+  }
+
+  // 被套圈后报告 lapped，下一次 recv 重新同步
+  for (int i = 0; i < 2000; ++i) {
+    pub.send(gsl::span<const char>(payload.data(), payload.size()));
+  }
+  REQUIRE(sub.backlog().lapped);
+  (void)sub.recv(0);
+  REQUIRE_FALSE(sub.backlog().lapped);
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "freshness reports topic age, backlog and overruns", "[unit]") {
+  TestLogger::debug("Testing Queue::freshness");
+
+  msgq::Queue sub = msgq::Queue::create(queue_name, 64 * 1024);
+  sub.init_subscriber();
+  msgq::Queue pub = msgq::Queue::create(queue_name, 64 * 1024);
+  pub.init_publisher();
+
+  // 还没有消息：时间为纪元值
+  msgq::Queue::Freshness fresh = sub.freshness();
+  REQUIRE(fresh.newest_timestamp == std::chrono::steady_clock::time_point{});
+  REQUIRE(fresh.backlog_messages == 0);
+  REQUIRE(fresh.overruns == 0);
+
+  const std::string payload(100, 'f');
+  const auto before = std::chrono::steady_clock::now();
+  pub.send(gsl::span<const char>(payload.data(), payload.size()));
+  pub.send(gsl::span<const char>(payload.data(), payload.size()));
+  const auto after = std::chrono::steady_clock::now();
+  fresh = sub.freshness();
+  REQUIRE(fresh.newest_timestamp >= before);
+  REQUIRE(fresh.newest_timestamp <= after);
+  REQUIRE(fresh.backlog_messages == 2);
+  REQUIRE(fresh.backlog_bytes >= 2 * payload.size());
+
+  // 查询不消费消息
+  REQUIRE(sub.freshness().backlog_messages == 2);
+  REQUIRE(sub.recv(0).size() == payload.size());
+  REQUIRE(sub.freshness().backlog_messages == 1);
+
+  // 看门狗：发布者停下后，最新消息的时间不再前进
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  REQUIRE(std::chrono::steady_clock::now() - sub.freshness().newest_timestamp >= std::chrono::milliseconds(30));
+
+  // 套圈在 recv 之前就计入，recv 之后保持
+  const auto flood = std::chrono::steady_clock::now();
+  for (int i = 0; i < 2000; ++i) {
+    pub.send(gsl::span<const char>(payload.data(), payload.size()));
+  }
+  REQUIRE(sub.freshness().overruns == 1);
+  (void)sub.recv(0);
+  REQUIRE(sub.freshness().overruns == 1);
+  REQUIRE(sub.freshness().newest_timestamp >= flood);
+}
+
+namespace {
+struct TopicTestPose {
+  double x, y, heading;
+};
+inline constexpr msgq::Topic<TopicTestPose> TOPIC_TEST_POSE{"topicTestPose"};
+inline constexpr msgq::Topic<> TOPIC_TEST_LOG{"topicTestLog", 1024 * 1024};
+inline constexpr auto TOPIC_TEST_TABLE = msgq::make_topic_table(TOPIC_TEST_POSE, TOPIC_TEST_LOG);
+
+// 查找在编译期可用
+static_assert(TOPIC_TEST_TABLE.find("topicTestPose") != nullptr);
+static_assert(TOPIC_TEST_TABLE.find("topicTestPose")->message_size == sizeof(TopicTestPose));
+static_assert(TOPIC_TEST_TABLE.find(msgq::topic_hash("topicTestLog"))->segment_size == 1024 * 1024);
+static_assert(TOPIC_TEST_TABLE.find("missing") == nullptr);
+}  // namespace
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "topic registry finds topics by name and id", "[unit]") {
+  TestLogger::debug("Testing the compile-time topic registry");
+
+  REQUIRE(TOPIC_TEST_TABLE.size() == 2);
+  const msgq::TopicInfo* pose = TOPIC_TEST_TABLE.find("topicTestPose");
+  REQUIRE(pose != nullptr);
+  REQUIRE(pose->id == msgq::topic_hash("topicTestPose"));
+  REQUIRE(TOPIC_TEST_TABLE.find(pose->id) == pose);
+  REQUIRE(std::string(pose->c_path()) == "/dev/shm/topicTestPose");
+  // 按消息类型推导的段大小：按页取整，不小于下限
+  REQUIRE(pose->segment_size == msgq::TOPIC_MIN_SEGMENT_SIZE);
+  REQUIRE(TOPIC_TEST_TABLE.find("topicTestLog")->message_size == 0);
+  REQUIRE(TOPIC_TEST_TABLE.find("topicTest") == nullptr);
+  REQUIRE(TOPIC_TEST_TABLE.find(uint64_t{0}) == nullptr);
+
+  // 运行期构造时同样校验（常量求值时是编译错误）
+  REQUIRE_THROWS_AS(msgq::Topic<>(""), std::invalid_argument);
+  REQUIRE_THROWS_AS(msgq::Topic<>("a/b"), std::invalid_argument);
+  REQUIRE_THROWS_AS(msgq::Topic<>(std::string(msgq::MAX_TOPIC_NAME + 1, 'x')), std::invalid_argument);
+  REQUIRE_THROWS_AS(msgq::make_topic_table(TOPIC_TEST_LOG, msgq::Topic<>("topicTestLog")), std::invalid_argument);
+
+  // 按话题打开队列：段大小与路径来自话题常量
+  const msgq::Topic<TopicTestPose> topic{queue_name};
+  msgq::Queue sub = msgq::Queue::create(topic, msgq::SegmentMode::SharedFile);
+  sub.init_subscriber();
+  msgq::Queue pub = msgq::Queue::create(topic, msgq::SegmentMode::SharedFile);
+  pub.init_publisher();
+  REQUIRE(std::filesystem::exists(queue_path));
+  const TopicTestPose sent{1.0, 2.0, 0.5};
+  pub.send(gsl::span<const char>(reinterpret_cast<const char*>(&sent), sizeof(sent)));
+  msgq::Message msg = sub.recv(1000);
+  REQUIRE(msg.size() == sizeof(TopicTestPose));
+  TopicTestPose got;
+  std::memcpy(&got, msg.data_ptr(), sizeof(got));
+  REQUIRE(got.y == 2.0);
+}
+
+// 把每次分配都填成 0xAB 的内存资源，用来观察 resize 是否清零
+class PatternResource : public std::pmr::memory_resource {
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    void* ptr = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    std::memset(ptr, 0xAB, bytes);
+    return ptr;
+  }
+  void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+    std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+  }
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+TEST_CASE("byte buffers size without zero-filling", "[unit]") {
+  TestLogger::debug("Testing ByteBuffer resize semantics");
+
+  PatternResource pattern;
+  auto untouched = [](const char* bytes, size_t count) {
+    return std::all_of(bytes, bytes + count, [](char c) { return c == static_cast<char>(0xAB); });
+  };
+
+  SECTION("Sizing constructors and resize leave new bytes as allocated") {
+    msgq::ByteBuffer buffer(4096, &pattern);
+    REQUIRE(buffer.size() == 4096);
+    REQUIRE(untouched(buffer.data(), buffer.size()));
+
+    msgq::Message msg(4096, &pattern);
+    REQUIRE(msg.size() == 4096);
+    REQUIRE(untouched(msg.data_ptr(), msg.size()));
+    REQUIRE(msg.memory_resource() == &pattern);
+  }
+
+  SECTION("Growing keeps the old bytes and the resource") {
+    msgq::Message msg(gsl::span<const char>("abcd", 4), &pattern);
+    msg.resize(1024 * 1024);
+    REQUIRE(std::string(msg.data_ptr(), 4) == "abcd");
+    REQUIRE(untouched(msg.data_ptr() + 4, msg.size() - 4));
+    REQUIRE(msg.memory_resource() == &pattern);
+
+    msg.resize(2);
+    REQUIRE(msg.size() == 2);
+    REQUIRE(std::string(msg.data_ptr(), 2) == "ab");
+  }
+
+  SECTION("Explicit values are still written") {
+    msgq::ByteBuffer buffer(&pattern);
+    buffer.resize(64, 'z');
+    REQUIRE(std::all_of(buffer.begin(), buffer.end(), [](char c) { return c == 'z'; }));
+    buffer.assign(16, '\0');
+    REQUIRE(std::all_of(buffer.begin(), buffer.end(), [](char c) { return c == '\0'; }));
+  }
+
+  SECTION("Copies use the default resource, copy assignment keeps the target's") {
+    msgq::Message msg(gsl::span<const char>("copy", 4), &pattern);
+    msgq::Message copy(msg);
+    REQUIRE(copy.memory_resource() == std::pmr::get_default_resource());
+    REQUIRE(std::string(copy.data_ptr(), copy.size()) == "copy");
+
+    msgq::Message target(&pattern);
+    target = copy;
+    REQUIRE(target.memory_resource() == &pattern);
+    REQUIRE(std::string(target.data_ptr(), target.size()) == "copy");
+    const msgq::Message& alias = target;
+    target = alias;
+    REQUIRE(std::string(target.data_ptr(), target.size()) == "copy");
+  }
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "message move assignment adopts the source buffer", "[unit]") {
+  TestLogger::debug("Testing Message move assignment");
+
+  // 移动赋值接管源的缓冲区和内存资源，不拷贝到目标的资源里
+  alignas(64) char arena[1024];
+  std::pmr::monotonic_buffer_resource pool(arena, sizeof(arena), std::pmr::null_memory_resource());
+  msgq::Message source(gsl::span<const char>("arena", 5), &pool);
+  const char* bytes = source.data_ptr();
+  const std::string filler(64, 'x');
+  msgq::Message target(gsl::span<const char>(filler.data(), filler.size()));
+  target = std::move(source);
+  REQUIRE(target.memory_resource() == &pool);
+  REQUIRE(target.data_ptr() == bytes);
+  REQUIRE(std::string(target.data_ptr(), target.size()) == "arena");
+
+  // recv() 按发布者的对齐分配，赋值给已有的 Message 后仍然对齐
+  msgq::Queue pub = msgq::Queue::create(queue_name, 64 * 1024, msgq::SegmentMode::Memfd);
+  msgq::PublisherOptions options;
+  options.record_alignment = 4096;
+  pub.init_publisher(options);
+  msgq::Queue sub = msgq::Queue::create(queue_name, 64 * 1024, msgq::SegmentMode::Memfd);
+  sub.init_subscriber();
+  const std::string payload = chunked_payload(100, 'm');
+  pub.send(gsl::span<const char>(payload.data(), payload.size()));
+  msgq::Message received;
+  received = sub.recv(100);
+  REQUIRE(received.size() == payload.size());
+  REQUIRE(received.aligned_to(4096));
+}
+
+// 第 index 条测试消息：偶数条是可压缩的重复字节，奇数条是随机字节，长度各不相同
+static std::string compression_payload(uint32_t index) {
+  std::string payload(2048 + (index % 7) * 1536, static_cast<char>('a' + index % 26));
+  if (index % 2 == 1) {
+    std::mt19937 rng(index);
+    for (auto& c : payload) {
+      c = static_cast<char>(rng());
+    }
+  }
+  memcpy(&payload[0], &index, sizeof(index));
+  return payload;
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "compressed records expand on recv and keep publish order", "[unit]") {
+  TestLogger::debug("Testing compression pool and send_compressed");
+
+  msgq::Queue pub = msgq::Queue::create(queue_name, 4 * 1024 * 1024, msgq::SegmentMode::Memfd);
+  pub.init_publisher();
+  msgq::Queue sub = msgq::Queue::create(queue_name, 4 * 1024 * 1024, msgq::SegmentMode::Memfd);
+  sub.init_subscriber();
+
+  SECTION("send_compressed frames arrive as the original payload") {
+    const std::string small = std::string(64 * 1024, 'g');
+    const std::string big = chunked_payload(3 * 1024 * 1024, 'c');  // 帧超过环的 1/4，走分片
+    for (const std::string* payload : {&small, &big}) {
+      msgq::ByteBuffer frame;
+      REQUIRE(msgq::compress_frame(gsl::span<const char>(payload->data(), payload->size()), frame));
+      REQUIRE(frame.size() < payload->size());
+      pub.send_compressed(gsl::span<const char>(frame.data(), frame.size()), 5);
+      msgq::Message msg = sub.recv(1000);
+      REQUIRE(msg.size() == payload->size());
+      REQUIRE(memcmp(msg.data_ptr(), payload->data(), payload->size()) == 0);
+    }
+
+    // 不可压缩的数据：compress_frame 返回 false，按原样发送
+    const std::string noise = compression_payload(1);
+    msgq::ByteBuffer frame;
+    REQUIRE_FALSE(msgq::compress_frame(gsl::span<const char>(noise.data(), noise.size()), frame));
+
+    // 解不开的帧按校验错误计数并丢弃
+    uint64_t bogus[2] = {UINT64_MAX, 0};
+    pub.send_compressed(gsl::span<const char>(reinterpret_cast<const char*>(bogus), sizeof(bogus)));
+    REQUIRE(sub.recv(0).empty());
+    REQUIRE(sub.checksum_errors() == 1);
+  }
+
+  SECTION("A pool sends each queue's messages in publish order") {
+    const std::string other_name = queue_name + "_other";
+    msgq::Queue other_pub = msgq::Queue::create(other_name, 4 * 1024 * 1024, msgq::SegmentMode::Memfd);
+    other_pub.init_publisher();
+    msgq::Queue other_sub = msgq::Queue::create(other_name, 4 * 1024 * 1024, msgq::SegmentMode::Memfd);
+    other_sub.init_subscriber();
+
+    constexpr uint32_t COUNT = 64;
+    msgq::CompressionOptions options;
+    options.workers = 4;
+    options.max_pending = 8;
+    {
+      msgq::CompressionPool pool(options);
+      REQUIRE(pool.workers() == 4);
+      for (uint32_t i = 0; i < COUNT; ++i) {
+        const std::string payload = compression_payload(i);
+        pool.publish(pub, gsl::span<const char>(payload.data(), payload.size()), i);
+        pool.publish(other_pub, gsl::span<const char>(payload.data(), payload.size()));
+      }
+      pool.flush();
+
+      const msgq::CompressionPool::Stats stats = pool.stats(pub);
+      REQUIRE(stats.messages == COUNT);
+      REQUIRE(stats.compressed == COUNT / 2);
+      REQUIRE(stats.sent_bytes < stats.raw_bytes);
+    }
+
+    for (msgq::Queue* queue : {&sub, &other_sub}) {
+      for (uint32_t i = 0; i < COUNT; ++i) {
+        const std::string expected = compression_payload(i);
+        msgq::Message msg = queue->recv(0);
+        REQUIRE(msg.size() == expected.size());
+        REQUIRE(memcmp(msg.data_ptr(), expected.data(), expected.size()) == 0);
+      }
+      REQUIRE(queue->recv(0).empty());
+    }
+  }
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "payloads keep the record alignment across wraps", "[unit]") {
+  TestLogger::debug("Testing record alignment padding");
+
+  for (size_t alignment : {size_t{16}, size_t{64}, size_t{4096}}) {
+    const std::string name = queue_name + "_" + std::to_string(alignment);
+    msgq::Queue pub = msgq::Queue::create(name, 64 * 1024, msgq::SegmentMode::Memfd);
+    msgq::PublisherOptions options;
+    options.record_alignment = alignment;
+    pub.init_publisher(options);
+    msgq::Queue sub = msgq::Queue::create(name, 64 * 1024, msgq::SegmentMode::Memfd);
+    sub.init_subscriber();
+
+    // 订阅者自带的内存资源同样按对齐分配
+    std::pmr::unsynchronized_pool_resource pool;
+    msgq::SubscriberOptions pooled;
+    pooled.memory_resource = &pool;
+    msgq::Queue pooled_sub = msgq::Queue::create(name, 64 * 1024, msgq::SegmentMode::Memfd);
+    pooled_sub.init_subscriber(pooled);
+
+    // 长度各异、总量为环的数倍，填充记录会落在环尾和回绕处
+    const size_t sizes[] = {1, 100, 1000, 3000, 5000, 8};
+    const uint64_t start = pub.write_position();
+    for (size_t i = 0; i < 240; ++i) {
+      const std::string payload = chunked_payload(sizes[i % 6], static_cast<char>('a' + i % 26));
+      pub.send(gsl::span<const char>(payload.data(), payload.size()));
+      for (msgq::Queue* reader : {&sub, &pooled_sub}) {
+        msgq::Message msg = reader->recv(0);
+        REQUIRE(msg.size() == payload.size());
+        REQUIRE(msg.aligned_to(alignment));
+        REQUIRE(memcmp(msg.data_ptr(), payload.data(), payload.size()) == 0);
+      }
+    }
+    REQUIRE(pub.write_position() - start > 4 * 64 * 1024);
+    REQUIRE(sub.freshness().overruns == 0);
+  }
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "drain hands over waiting messages including empty ones", "[unit]") {
+  TestLogger::debug("Testing Queue::drain");
+
+  msgq::Queue pub = msgq::Queue::create(queue_name, 64 * 1024, msgq::SegmentMode::Memfd);
+  pub.init_publisher();
+  msgq::Queue sub = msgq::Queue::create(queue_name, 64 * 1024, msgq::SegmentMode::Memfd);
+  sub.init_subscriber();
+
+  std::vector<size_t> sizes;
+  auto collect = [&](msgq::Message& msg) { sizes.push_back(msg.size()); };
+  REQUIRE(sub.drain(collect) == 0);
+
+  // 零长度消息不会让 drain 提前停下
+  const std::string payload = chunked_payload(300, 'd');
+  for (size_t size : {size_t{10}, size_t{0}, size_t{300}, size_t{0}, size_t{0}, size_t{20}}) {
+    pub.send(gsl::span<const char>(payload.data(), size));
+  }
+  REQUIRE(sub.drain(collect, 3) == 3);
+  REQUIRE(sizes == std::vector<size_t>{10, 0, 300});
+  REQUIRE(sub.drain(collect) == 3);
+  REQUIRE(sizes == std::vector<size_t>{10, 0, 300, 0, 0, 20});
+  REQUIRE(sub.drain(collect) == 0);
+
+  // 超过环大小的分片消息整条交给处理函数（发送要等读者腾出空间）
+  const std::string big = chunked_payload(160 * 1024, 'D');
+  std::thread sender([&] {
+    pub.send(gsl::span<const char>(big.data(), big.size()));
+    pub.send(gsl::span<const char>(payload.data(), 0));
+  });
+  sizes.clear();
+  const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (sizes.size() < 2 && std::chrono::steady_clock::now() < until) {
+    (void)sub.drain(collect);
+  }
+  sender.join();
+  REQUIRE(sizes == std::vector<size_t>{big.size(), 0});
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "snapshots read in place until lapped and copy large messages", "[unit]") {
+  TestLogger::debug("Testing Queue::snapshot");
+
+  msgq::Queue pub = msgq::Queue::create(queue_name, 64 * 1024, msgq::SegmentMode::Memfd);
+  msgq::PublisherOptions options;
+  options.record_alignment = 4096;
+  pub.init_publisher(options);
+  msgq::Queue sub = msgq::Queue::create(queue_name, 64 * 1024, msgq::SegmentMode::Memfd);
+  sub.init_subscriber();
+
+  SECTION("An in-place snapshot turns invalid once the writer laps it") {
+    const std::string payload = chunked_payload(1000, 's');
+    pub.send(gsl::span<const char>(payload.data(), payload.size()));
+    msgq::Queue::Snapshot snap = sub.snapshot(0);
+    REQUIRE(snap.in_place());
+    REQUIRE(snap.size() == payload.size());
+    REQUIRE(memcmp(snap.data().data(), payload.data(), payload.size()) == 0);
+    REQUIRE(snap.valid());
+
+    for (int i = 0; i < 100; ++i) {
+      pub.send(gsl::span<const char>(payload.data(), payload.size()));
+    }
+    REQUIRE_FALSE(snap.valid());
+    REQUIRE_FALSE(snap.release());
+    REQUIRE(snap.empty());
+  }
+
+  SECTION("Compressed messages are copied with the record alignment and survive moves") {
+    const std::string big(40 * 1024, 'S');
+    msgq::ByteBuffer frame;
+    REQUIRE(msgq::compress_frame(gsl::span<const char>(big.data(), big.size()), frame));
+    pub.send_compressed(gsl::span<const char>(frame.data(), frame.size()));
+    msgq::Queue::Snapshot snap = sub.snapshot(0);
+    REQUIRE_FALSE(snap.in_place());
+    REQUIRE(snap.size() == big.size());
+    REQUIRE(reinterpret_cast<uintptr_t>(snap.data().data()) % 4096 == 0);
+
+    // 移动构造和移动赋值后 data() 仍指向自己的副本
+    msgq::Queue::Snapshot moved(std::move(snap));
+    msgq::Queue::Snapshot target;
+    target = std::move(moved);
+    REQUIRE(target.size() == big.size());
+    REQUIRE(memcmp(target.data().data(), big.data(), big.size()) == 0);
+    REQUIRE(reinterpret_cast<uintptr_t>(target.data().data()) % 4096 == 0);
+
+    // 副本不受写者套圈影响
+    for (int i = 0; i < 100; ++i) {
+      pub.send(gsl::span<const char>(big.data(), 1000));
+    }
+    REQUIRE(target.valid());
+    REQUIRE(target.release());
+  }
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "durable subscriptions resume from their checkpoint", "[unit]") {
+  TestLogger::debug("Testing durable subscriptions");
+
+  auto open = [&] { return msgq::Queue::create(queue_name, 64 * 1024, msgq::SegmentMode::SharedFile); };
+  auto pub = std::make_unique<msgq::Queue>(open());
+  pub->init_publisher();
+  auto send = [&](uint32_t value) {
+    pub->send(gsl::span<const char>(reinterpret_cast<const char*>(&value), sizeof(value)));
+  };
+  auto value = [](const msgq::Message& msg) {
+    uint32_t v = UINT32_MAX;
+    if (msg.size() == sizeof(v)) {
+      memcpy(&v, msg.data_ptr(), sizeof(v));
+    }
+    return v;
+  };
+  msgq::SubscriberOptions durable;
+  durable.durable_name = "logger";
+
+  // 首次订阅从最新处开始；同名的第二个持有者被拒绝
+  {
+    msgq::Queue sub = open();
+    sub.init_subscriber(durable);
+    REQUIRE(sub.resume_status() == msgq::Queue::ResumeStatus::Started);
+    msgq::Queue other = open();
+    REQUIRE_THROWS_AS(other.init_subscriber(durable), msgq::MessageQueueError);
+
+    for (uint32_t i = 0; i < 5; ++i) {
+      send(i);
+    }
+    for (uint32_t i = 0; i < 3; ++i) {
+      REQUIRE(value(sub.recv(0)) == i);
+    }
+  }
+
+  // 重启后从检查点继续，包括离线期间发布的消息
+  send(5);
+  {
+    msgq::Queue sub = open();
+    sub.init_subscriber(durable);
+    REQUIRE(sub.resume_status() == msgq::Queue::ResumeStatus::Resumed);
+    for (uint32_t i = 3; i < 6; ++i) {
+      REQUIRE(value(sub.recv(0)) == i);
+    }
+    REQUIRE(sub.recv(0).empty());
+  }
+
+  // 离线期间检查点被套圈：从最新处开始并计一次超限
+  for (uint32_t i = 6; i < 6000; ++i) {
+    send(i);
+  }
+  {
+    msgq::Queue sub = open();
+    sub.init_subscriber(durable);
+    REQUIRE(sub.resume_status() == msgq::Queue::ResumeStatus::Lapped);
+    REQUIRE(sub.recv(0).empty());
+    send(7000);
+    REQUIRE(value(sub.recv(0)) == 7000);
+  }
+
+  // 环被重建后旧检查点不再适用
+  pub.reset();
+  std::filesystem::remove(queue_path);
+  pub = std::make_unique<msgq::Queue>(open());
+  pub->init_publisher();
+  send(8000);
+  {
+    msgq::Queue sub = open();
+    sub.init_subscriber(durable);
+    REQUIRE(sub.resume_status() == msgq::Queue::ResumeStatus::Lapped);
+    send(8001);
+    REQUIRE(value(sub.recv(0)) == 8001);
+  }
+
+  std::filesystem::remove_all(std::string(msgq::TOPIC_PATH_PREFIX) + "msgq_cursors/" + queue_name);
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "reader slots of closed and dead subscribers are reused", "[unit]") {
+  TestLogger::debug("Testing reader slot reclamation");
+
+  auto open = [&] { return msgq::Queue::create(queue_name, 4096, msgq::SegmentMode::SharedFile); };
+  msgq::Queue pub = open();
+  pub.init_publisher();
+
+  // 反复打开关闭远多于 NUM_READERS 个订阅者
+  for (size_t i = 0; i < 3 * NUM_READERS; ++i) {
+    msgq::Queue sub = open();
+    sub.init_subscriber();
+  }
+  REQUIRE(pub.num_readers() == 1);
+
+  // 被杀死的子进程占着一个槽位，其余槽位由本进程占满
+  int ready[2];
+  REQUIRE(pipe(ready) == 0);
+  pid_t child = fork();
+  if (child == 0) {
+    msgq::Queue holder = open();
+    holder.init_subscriber();
+    (void)!write(ready[1], "x", 1);
+    pause();
+    _exit(0);
+  }
+  char byte;
+  REQUIRE(read(ready[0], &byte, 1) == 1);
+  close(ready[0]);
+  close(ready[1]);
+
+  std::vector<msgq::Queue> subs;
+  for (size_t i = 0; i + 1 < NUM_READERS; ++i) {
+    subs.push_back(open());
+    subs.back().init_subscriber();
+  }
+  msgq::Queue extra = open();
+  REQUIRE_THROWS_AS(extra.init_subscriber(), msgq::MessageQueueError);
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+  extra.init_subscriber();
+  REQUIRE(pub.num_readers() == NUM_READERS);
+
+  // 接管的槽位从最新处开始读
+  const char payload[] = "slot";
+  pub.send(gsl::span<const char>(payload, 4));
+  REQUIRE(extra.recv(0).size() == 4);
+  REQUIRE(subs.front().recv(0).size() == 4);
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "buffer pool holds frames for slow readers", "[unit]") {
+  TestLogger::debug("Testing buffer pool publish, pin and release");
+
+  const std::string pool_name = queue_name + "_pool";
+  msgq::Queue sub = msgq::Queue::create(queue_name, 4096, msgq::SegmentMode::SharedFile);
+  sub.init_subscriber();
+  msgq::Queue pub = msgq::Queue::create(queue_name, 4096, msgq::SegmentMode::SharedFile);
+  pub.init_publisher();
+  {
+    msgq::BufferPool pool = msgq::BufferPool::create(pool_name, 4096, 2, msgq::SegmentMode::SharedFile);
+
+    // 读者还没来得及 pin：两块缓冲都为它保留，不会被回收重用
+    for (char fill : {'a', 'b'}) {
+      auto buffer = pool.acquire(pub);
+      REQUIRE(buffer);
+      std::memset(buffer->data().data(), fill, 100);
+      pool.publish(pub, std::move(*buffer), 100);
+    }
+    REQUIRE(pool.available() == 0);
+    REQUIRE_FALSE(pool.acquire(pub));
+
+    for (char fill : {'a', 'b'}) {
+      msgq::BufferPool::Frame frame = pool.receive(sub, 0);
+      REQUIRE(frame);
+      REQUIRE(frame.size() == 100);
+      REQUIRE(std::string(frame.data().data(), frame.size()) == std::string(100, fill));
+    }
+    // Frame 析构即释放
+    REQUIRE(pool.available() == 2);
+
+    // 从不 pin 的读者：描述符被环覆盖后，为它保留的缓冲过期归还
+    auto buffer = pool.acquire(pub);
+    REQUIRE(buffer);
+    pool.publish(pub, std::move(*buffer), 10);
+    REQUIRE(pool.available() == 1);
+    std::vector<char> filler(512, 'x');
+    for (int i = 0; i < 32; ++i) {
+      pub.send(gsl::span<const char>(filler.data(), filler.size()));
+    }
+    auto leased = pool.acquire(pub);
+    REQUIRE(leased);
+    leased.reset();
+    REQUIRE(pool.available() == 2);
+  }
+  std::filesystem::remove("/dev/shm/" + pool_name);
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "buffer pool rejects other geometry without truncating", "[unit]") {
+  TestLogger::debug("Testing buffer pool geometry mismatch");
+
+  const std::string pool_name = queue_name + "_pool";
+  const std::string pool_path = "/dev/shm/" + pool_name;
+  msgq::Queue sub = msgq::Queue::create(queue_name, 4096, msgq::SegmentMode::SharedFile);
+  sub.init_subscriber();
+  msgq::Queue pub = msgq::Queue::create(queue_name, 4096, msgq::SegmentMode::SharedFile);
+  pub.init_publisher();
+  {
+    msgq::BufferPool pool = msgq::BufferPool::create(pool_name, 8192, 2, msgq::SegmentMode::SharedFile);
+    const auto size = std::filesystem::file_size(pool_path);
+
+    auto buffer = pool.acquire(pub);
+    REQUIRE(buffer);
+    std::memset(buffer->data().data(), 'q', 8192);
+    pool.publish(pub, std::move(*buffer), 8192);
+
+    // 更小或更大的几何都被拒绝，已有段的大小和内容不受影响
+    REQUIRE_THROWS_AS(msgq::BufferPool::create(pool_name, 4096, 2, msgq::SegmentMode::SharedFile),
+                      msgq::MessageQueueError);
+    REQUIRE_THROWS_AS(msgq::BufferPool::create(pool_name, 8192, 3, msgq::SegmentMode::SharedFile),
+                      msgq::MessageQueueError);
+    REQUIRE(std::filesystem::file_size(pool_path) == size);
+
+    msgq::BufferPool::Frame frame = pool.receive(sub, 0);
+    REQUIRE(frame);
+    REQUIRE(std::string(frame.data().data(), frame.size()) == std::string(8192, 'q'));
+
+    // 相同几何可以再次打开
+    msgq::BufferPool again = msgq::BufferPool::create(pool_name, 8192, 2, msgq::SegmentMode::SharedFile);
+    REQUIRE(again.count() == 2);
+  }
+  std::filesystem::remove(pool_path);
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "a queue refuses a second live publisher", "[unit]") {
+  TestLogger::debug("Testing single-publisher enforcement");
+
+  auto open = [&] { return msgq::Queue::create(queue_name, 4096, msgq::SegmentMode::SharedFile); };
+  auto first = std::make_unique<msgq::Queue>(open());
+  first->init_publisher();
+  first->init_publisher();  // 重复调用不算第二个发布者
+
+  // 同进程的另一个 Queue 被拒绝，第一个关闭后即可接管
+  auto second = std::make_unique<msgq::Queue>(open());
+  REQUIRE_THROWS_AS(second->init_publisher(), msgq::MessageQueueError);
+  first.reset();
+  second->init_publisher();
+
+  // 其他进程同样被拒绝
+  pid_t child = fork();
+  if (child == 0) {
+    try {
+      open().init_publisher();
+    } catch (const msgq::MessageQueueError&) {
+      _exit(0);
+    }
+    _exit(1);
+  }
+  int status = 0;
+  waitpid(child, &status, 0);
+  REQUIRE((WIFEXITED(status) && WEXITSTATUS(status) == 0));
+  second.reset();
+
+  // 发布者进程被杀后，它的槽位可以被接管
+  int ready[2];
+  REQUIRE(pipe(ready) == 0);
+  child = fork();
+  if (child == 0) {
+    msgq::Queue holder = open();
+    holder.init_publisher();
+    (void)!write(ready[1], "x", 1);
+    pause();
+    _exit(0);
+  }
+  char byte;
+  REQUIRE(read(ready[0], &byte, 1) == 1);
+  close(ready[0]);
+  close(ready[1]);
+  msgq::Queue third = open();
+  REQUIRE_THROWS_AS(third.init_publisher(), msgq::MessageQueueError);
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+  third.init_publisher();
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "blocking recv wakes on send and honours its timeout", "[unit]") {
+  TestLogger::debug("Testing futex receive path");
+
+  msgq::Queue sub = msgq::Queue::create(queue_name, 4096, msgq::SegmentMode::Memfd);
+  sub.init_subscriber();
+  msgq::Queue pub = msgq::Queue::create(queue_name, 4096, msgq::SegmentMode::Memfd);
+  pub.init_publisher();
+
+  // 空队列：recv(50) 等满超时后返回空消息
+  auto start = std::chrono::steady_clock::now();
+  REQUIRE(sub.recv(50).empty());
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  REQUIRE(elapsed >= std::chrono::milliseconds(45));
+  REQUIRE(elapsed < std::chrono::milliseconds(500));
+
+  // 阻塞中的 recv(1000) 被另一线程的 send 唤醒，而不是等到超时
+  std::thread sender([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const char payload[] = "wake";
+    pub.send(gsl::span<const char>(payload, 4));
+  });
+  start = std::chrono::steady_clock::now();
+  msgq::Message msg = sub.recv(1000);
+  elapsed = std::chrono::steady_clock::now() - start;
+  sender.join();
+  REQUIRE(msg.size() == 4);
+  REQUIRE(elapsed < std::chrono::milliseconds(500));
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "rpc calls return replies, errors and timeouts", "[unit]") {
+  TestLogger::debug("Testing request/reply RPC");
+
+  using namespace std::chrono_literals;
+  msgq::rpc::Server server = msgq::rpc::Server::create(
+    queue_name,
+    [](gsl::span<const char> request) {
+      const std::string text(request.data(), request.size());
+      if (text == "fail") {
+        throw std::runtime_error("handler failed");
+      }
+      if (text == "slow") {
+        std::this_thread::sleep_for(200ms);
+      }
+      return msgq::Message(gsl::span<const char>(text.data(), text.size()));
+    },
+    64 * 1024, msgq::SegmentMode::Memfd);
+  server.start();
+  msgq::rpc::Client client = msgq::rpc::Client::create(queue_name, 64 * 1024, msgq::SegmentMode::Memfd);
+
+  // 每个服务只允许一个客户端
+  REQUIRE_THROWS_AS(msgq::rpc::Client::create(queue_name, 64 * 1024, msgq::SegmentMode::Memfd),
+                    msgq::MessageQueueError);
+
+  // 多线程并发调用，各自拿到自己的应答
+  std::vector<std::thread> callers;
+  std::atomic<int> matched{0};
+  for (int t = 0; t < 4; ++t) {
+    callers.emplace_back([&, t] {
+      for (int i = 0; i < 50; ++i) {
+        const std::string request = std::to_string(t) + ":" + std::to_string(i);
+        auto reply = client.call(gsl::span<const char>(request.data(), request.size()), 1000ms);
+        if (reply && std::string(reply->data_ptr(), reply->size()) == request) {
+          matched++;
+        }
+      }
+    });
+  }
+  for (auto& caller : callers) {
+    caller.join();
+  }
+  REQUIRE(matched == 200);
+
+  // 处理函数抛出的异常回到调用方
+  const std::string fail = "fail";
+  REQUIRE_THROWS_AS(client.call(gsl::span<const char>(fail.data(), fail.size()), 1000ms),
+                    msgq::MessageQueueError);
+
+  // 超过期限返回 nullopt，迟到的应答被丢弃，不会串到下一次调用
+  const std::string slow = "slow";
+  REQUIRE_FALSE(client.call(gsl::span<const char>(slow.data(), slow.size()), 50ms).has_value());
+  REQUIRE(client.outstanding() == 0);
+  const std::string next = "next";
+  auto reply = client.call(gsl::span<const char>(next.data(), next.size()), 1000ms);
+  REQUIRE(reply.has_value());
+  REQUIRE(std::string(reply->data_ptr(), reply->size()) == "next");
+
+  server.stop();
+  server.wait();
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "unix socket publisher reaches subscribers", "[unit]") {
+  TestLogger::debug("Testing SEQPACKET transport");
+
+  auto pub = msgq::UnixPublisher::bind(queue_name);
+  auto sub = msgq::UnixSubscriber::connect(queue_name);
+  REQUIRE(sub->fd() >= 0);
+
+  // 同一话题只能有一个发布者
+  try {
+    (void)msgq::UnixPublisher::bind(queue_name);
+    FAIL("second publisher was allowed");
+  } catch (const std::system_error& e) {
+    REQUIRE(e.code().value() == EADDRINUSE);
+  }
+
+  // 单包、分片（两段聚集发送）与 memfd 三条路径
+  msgq::ByteBuffer out;
+  for (size_t size : {size_t{0}, size_t{100}, msgq::UNIX_PACKET_PAYLOAD * 3 + 7, size_t{1024 * 1024}}) {
+    std::vector<char> data(size);
+    for (size_t i = 0; i < size; ++i) {
+      data[i] = static_cast<char>(i * 31 + size);
+    }
+    const size_t half = size / 2;
+    const msgq::span<const char> parts[2] = {{data.data(), half}, {data.data() + half, size - half}};
+    REQUIRE(pub->send(msgq::span<const msgq::span<const char>>(parts, 2)) == 1);
+    REQUIRE(sub->receive(out, 1000));
+    REQUIRE(std::vector<char>(out.begin(), out.end()) == data);
+  }
+  REQUIRE_FALSE(sub->receive(out, 0));
+  REQUIRE(pub->all_readers_updated());
+
+  // 发布者重启后订阅者自动重连
+  pub.reset();
+  pub = msgq::UnixPublisher::bind(queue_name);
+  REQUIRE_FALSE(sub->receive(out, 10));
+  REQUIRE(sub->fd() >= 0);
+  const char hello[] = "hello";
+  const msgq::span<const char> part(hello, 5);
+  REQUIRE(pub->send(msgq::span<const msgq::span<const char>>(&part, 1)) == 1);
+  REQUIRE(sub->receive(out, 1000));
+  REQUIRE(out.size() == 5);
+
+  // 订阅者先于发布者创建：只用 receive(out, 0) 轮询也能连上并收到消息
+  pub.reset();
+  auto early = msgq::UnixSubscriber::connect(queue_name);
+  REQUIRE(early->fd() < 0);
+  pub = msgq::UnixPublisher::bind(queue_name);
+  bool received = false;
+  const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (!received && std::chrono::steady_clock::now() < until) {
+    (void)pub->send(msgq::span<const msgq::span<const char>>(&part, 1));
+    received = early->receive(out, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  REQUIRE(received);
+  REQUIRE(early->fd() >= 0);
+  REQUIRE(out.size() == 5);
+}
+
+TEST_CASE_METHOD(MessageQueueTestFixture, "multicast subscribers repair lost datagrams", "[unit]") {
+  TestLogger::debug("Testing multicast transport on loopback");
+
+  auto reliable = msgq::MulticastSubscriber::join(queue_name);
+  // 小接收缓冲区保证突发发送时丢包，只能靠 NACK 修复
+  msgq::MulticastOptions small;
+  small.receive_buffer = 32 * 1024;
+  auto lossy = msgq::MulticastSubscriber::join(queue_name, small);
+  auto pub = msgq::MulticastPublisher::create(queue_name);
+
+  std::vector<std::vector<char>> sent;
+  for (int n = 0; n < 20; ++n) {
+    std::vector<char> data(200000);
+    for (size_t i = 0; i < data.size(); ++i) {
+      data[i] = static_cast<char>(i * 31 + n);
+    }
+    const msgq::span<const char> part(data.data(), data.size());
+    pub->send(msgq::span<const msgq::span<const char>>(&part, 1));
+    sent.push_back(std::move(data));
+  }
+
+  // 每条消息只发送一次，两个订阅者都按发布顺序完整收到
+  msgq::ByteBuffer out;
+  for (auto* sub : {lossy.get(), reliable.get()}) {
+    for (const auto& data : sent) {
+      REQUIRE(sub->receive(out, 2000));
+      REQUIRE(std::vector<char>(out.begin(), out.end()) == data);
+    }
+    REQUIRE(sub->stats().lost == 0);
+  }
+  REQUIRE(lossy->stats().nacks > 0);
+  REQUIRE(pub->retransmitted() > 0);
+
+  // 空消息
+  const msgq::span<const char> empty;
+  pub->send(msgq::span<const msgq::span<const char>>(&empty, 1));
+  REQUIRE(reliable->receive(out, 1000));
+  REQUIRE(out.empty());
+}
+
+TEST_CASE("realtime setup reports what took effect", "[unit]") {
+  TestLogger::debug("Testing realtime thread configuration");
+
+  msgq::RealtimeOptions options;
+  options.cpus = {sched_getcpu()};
+  options.prefault_stack = 128 * 1024;
+  options.priority = 10;
+
+  // 在新线程上配置，不影响测试主线程；FIFO 需要 CAP_SYS_NICE，失败时必须出现在报告里
+  msgq::RealtimeThread thread(options, [] {});
+  const msgq::RealtimeReport& report = thread.report();
+  REQUIRE(report.cpus == options.cpus);
+  REQUIRE(report.stack_prefaulted == options.prefault_stack);
+  const bool fifo = report.policy == SCHED_FIFO && report.priority == 10;
+  REQUIRE(report.ok() == fifo);
+  TestLogger::debug(report.describe());
+
+  // 自检能发现未生效的设置
+  REQUIRE_FALSE(msgq::inspect_current_thread(options).ok());
+
+  msgq::RealtimeOptions invalid;
+  invalid.priority = 1000;
+  REQUIRE_THROWS_AS(msgq::configure_current_thread(invalid), std::invalid_argument);
+  REQUIRE(msgq::parse_cpu_list("3,0-1") == std::vector<int>{0, 1, 3});
+  REQUIRE_THROWS_AS(msgq::parse_cpu_list("1-"), std::invalid_argument);
+}
+
+TEST_CASE("event sets report the ready event and time out", "[unit]") {
+  TestLogger::debug("Testing EventSet");
+
+  std::vector<msgq::event::Event> events;
+  msgq::event::EventSet set;
+  for (size_t i = 0; i < 3; ++i) {
+    events.emplace_back(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    REQUIRE(set.add(events.back()) == i);
+  }
+  REQUIRE(set.size() == 3);
+  REQUIRE_THROWS_AS(set.add(-1), std::invalid_argument);
+
+  // 一个就绪时返回它的下标，多个就绪时取最小的
+  events[2].set();
+  REQUIRE(set.wait(1) == 2);
+  REQUIRE(set.wait(1) == 2);  // 不消费事件，清除之前一直就绪
+  events[1].set();
+  REQUIRE(set.wait(1) == 1);
+  REQUIRE(msgq::event::Event::wait_for_one(events, 1) == 1);
+  events[1].clear();
+  events[2].clear();
+
+  // 没有事件就绪时等满超时后抛出
+  const auto start = std::chrono::steady_clock::now();
+  REQUIRE_THROWS_AS(set.wait(1), std::runtime_error);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  REQUIRE(elapsed >= std::chrono::milliseconds(950));
+  REQUIRE(elapsed < std::chrono::seconds(3));
+
+  // 另一线程设置事件会唤醒阻塞中的 wait
+  std::thread setter([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    events[0].set();
+  });
+  REQUIRE(set.wait(5) == 0);
+  setter.join();
+
+  set.clear();
+  REQUIRE_THROWS_AS(set.wait(0), std::invalid_argument);
+  for (auto& event : events) {
+    ::close(event.fd());
+  }
+}
+
+TEST_CASE("virtual clock drives timeouts in fake mode", "[unit]") {
+  TestLogger::debug("Testing virtual clock");
+
+  ::setenv("CEREAL_FAKE", "1", 1);
+  {
+    msgq::clock::VirtualClock clock(std::chrono::seconds(100));
+    REQUIRE(msgq::clock::is_virtual());
+    REQUIRE(msgq::clock::now().time_since_epoch() == std::chrono::seconds(100));
+    REQUIRE_THROWS_AS(clock.set(msgq::clock::Clock::time_point(std::chrono::seconds(1))), std::invalid_argument);
+
+    // 控制器以远快于真实时间的速度推进：5 秒的虚拟超时只需几十毫秒
+    std::atomic<bool> stop{false};
+    std::thread controller([&] {
+      while (!stop.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        clock.advance(std::chrono::milliseconds(100));
+      }
+    });
+    msgq::event::Event event(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE_THROWS_AS(event.wait(5), std::runtime_error);
+    msgq::clock::sleep_for(std::chrono::seconds(2));
+    const auto real = std::chrono::steady_clock::now() - start;
+    stop.store(true);
+    controller.join();
+    ::close(event.fd());
+
+    REQUIRE(msgq::clock::now().time_since_epoch() >= std::chrono::seconds(107));
+    REQUIRE(real < std::chrono::seconds(3));
+  }
+
+  // 控制器退出后回到真实时间
+  REQUIRE_FALSE(msgq::clock::is_virtual());
+
+  // 默认从当前 steady 时间起步：控制器出现前已开始的等待不会因时间倒退而挂住
+  {
+    std::atomic<bool> slept{false};
+    std::thread sleeper([&] {
+      msgq::clock::sleep_for(std::chrono::seconds(1));
+      slept.store(true);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const auto before = std::chrono::steady_clock::now().time_since_epoch();
+    msgq::clock::VirtualClock clock;
+    REQUIRE(clock.now().time_since_epoch() >= before);
+    REQUIRE(msgq::clock::now() == clock.now());
+
+    const auto start = std::chrono::steady_clock::now();
+    while (!slept.load() && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      clock.advance(std::chrono::milliseconds(100));
+    }
+    const auto real = std::chrono::steady_clock::now() - start;
+    sleeper.join();
+    REQUIRE(slept.load());
+    REQUIRE(real < std::chrono::milliseconds(900));
+  }
+  ::unsetenv("CEREAL_FAKE");
+  REQUIRE_FALSE(msgq::clock::is_virtual());
+}
+
 // ============================================================================
 // 集成测试
 // ============================================================================
@@ -0,0 +1,640 @@
+#include "multicast_socket_modern.h"
+#include "topic_modern.h"
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+namespace msgq {
+
+namespace {
+
+constexpr uint32_t WIRE_MAGIC = 0x434d514d;  // "MQMC"
+constexpr uint16_t WIRE_DATA = 1;
+constexpr uint16_t WIRE_HEARTBEAT = 2;
+constexpr uint16_t WIRE_NACK = 3;
+
+// Leading bytes of every datagram. Host byte order: publishers and
+// subscribers are expected to share an architecture, as with the
+// shared-memory queues.
+struct WireHeader {
+    uint32_t magic;
+    uint16_t type;
+    uint16_t reserved;
+    uint64_t topic;
+    uint64_t session;    // Publisher start time (ns since the epoch), so a restart is noticed
+    uint64_t sequence;   // DATA: this datagram; HEARTBEAT: the next one; NACK: unused
+    uint32_t index;      // DATA: fragment index; NACK: number of ranges that follow
+    uint32_t fragments;  // DATA: fragments in the message
+    uint64_t size;       // DATA: message size
+};
+static_assert(sizeof(WireHeader) == 48, "WireHeader layout");
+
+// A missing run of datagrams in a NACK
+struct NackRange {
+    uint64_t first;
+    uint64_t count;
+};
+
+constexpr size_t MAX_NACK_RANGES = 64;
+constexpr uint64_t MAX_REPAIR_PER_NACK = 4096;   // Datagrams one NACK can ask for
+constexpr size_t REPAIR_BATCH = 64;              // Retransmissions per sendmmsg(2)
+constexpr auto REPAIR_HOLDOFF = MULTICAST_NACK_INTERVAL / 2;  // Ignore repeat requests this soon
+constexpr size_t MAX_DRAIN_BATCHES = 8;          // recvmmsg(2) calls per pump()
+constexpr uint64_t MAX_MESSAGE_SIZE = 1ull << 31;
+constexpr int SEND_BUFFER_SIZE = 4 * 1024 * 1024;
+constexpr uint16_t DEFAULT_PORT_BASE = 45000;
+constexpr uint16_t PORT_RANGE = 10000;
+
+void close_fd(int& fd) noexcept {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+in_addr parse_address(const char* variable, const char* fallback) {
+    const char* value = std::getenv(variable);
+    if (value == nullptr || *value == '\0') {
+        value = fallback;
+    }
+    in_addr addr;
+    if (::inet_pton(AF_INET, value, &addr) != 1) {
+        throw std::invalid_argument(std::string("Invalid ") + variable + ": " + value);
+    }
+    return addr;
+}
+
+// Send all datagrams, retrying partial sendmmsg(2) results. UDP send
+// errors are not fatal: receivers repair what did not go out.
+void send_all(int fd, struct mmsghdr* packets, size_t count) {
+    size_t sent = 0;
+    while (sent < count) {
+        const int n = ::sendmmsg(fd, packets + sent, static_cast<unsigned>(std::min<size_t>(count - sent, UIO_MAXIOV)), 0);
+        if (n > 0) {
+            sent += n;
+        } else if (errno != EINTR) {
+            sent++;  // Skip the datagram the kernel refused
+        }
+    }
+}
+
+} // namespace
+
+bool messaging_use_multicast() noexcept {
+    const char* value = std::getenv("MSGQ_MULTICAST");
+    return value != nullptr && std::strcmp(value, "0") != 0;
+}
+
+MulticastEndpoint multicast_endpoint(std::string_view name) {
+    if (name.empty()) {
+        throw std::invalid_argument("Topic name cannot be empty");
+    }
+
+    std::string qualified;
+    if (const char* prefix = std::getenv("OPENPILOT_PREFIX"); prefix != nullptr && *prefix != '\0') {
+        qualified = prefix;
+    }
+    qualified += '/';
+    qualified += name;
+
+    MulticastEndpoint endpoint{};
+    endpoint.topic = topic_hash(qualified);
+
+    uint16_t base = DEFAULT_PORT_BASE;
+    if (const char* port = std::getenv("MSGQ_MULTICAST_PORT"); port != nullptr && *port != '\0') {
+        const long value = std::strtol(port, nullptr, 10);
+        if (value <= 0 || value > 65535 - PORT_RANGE) {
+            throw std::invalid_argument(std::string("Invalid MSGQ_MULTICAST_PORT: ") + port);
+        }
+        base = static_cast<uint16_t>(value);
+    }
+
+    endpoint.group.sin_family = AF_INET;
+    endpoint.group.sin_addr = parse_address("MSGQ_MULTICAST_GROUP", "239.255.77.1");
+    endpoint.group.sin_port = htons(static_cast<uint16_t>(base + endpoint.topic % PORT_RANGE));
+    if (!IN_MULTICAST(ntohl(endpoint.group.sin_addr.s_addr))) {
+        throw std::invalid_argument("MSGQ_MULTICAST_GROUP is not a multicast address");
+    }
+    endpoint.interface = parse_address("MSGQ_MULTICAST_IF", "127.0.0.1");
+    return endpoint;
+}
+
+// ----------------------------------------------------------------------------
+// MulticastPublisher
+// ----------------------------------------------------------------------------
+
+std::unique_ptr<MulticastPublisher> MulticastPublisher::create(std::string_view name, const MulticastOptions& options) {
+    if (options.fragment_size == 0 || options.fragment_size > MULTICAST_MAX_FRAGMENT || options.history == 0) {
+        throw std::invalid_argument("Invalid multicast options");
+    }
+    const MulticastEndpoint endpoint = multicast_endpoint(name);
+
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw_errno("Failed to create multicast socket");
+    }
+    const unsigned char ttl = static_cast<unsigned char>(std::clamp(options.ttl, 0, 255));
+    const unsigned char loop = 1;
+    if (::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &endpoint.interface, sizeof(endpoint.interface)) < 0 ||
+        ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+        ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "Failed to configure multicast socket");
+    }
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &SEND_BUFFER_SIZE, sizeof(SEND_BUFFER_SIZE));
+
+    int stop_fd = ::eventfd(0, EFD_CLOEXEC);
+    if (stop_fd < 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "Failed to create eventfd");
+    }
+    return std::unique_ptr<MulticastPublisher>(new MulticastPublisher(fd, stop_fd, endpoint, options));
+}
+
+MulticastPublisher::MulticastPublisher(int fd, int stop_fd, const MulticastEndpoint& endpoint,
+                                       const MulticastOptions& options)
+    : fd_(fd), stop_fd_(stop_fd), endpoint_(endpoint), options_(options), history_(options.history) {
+    // Wall-clock start time, so subscribers can tell a restart from a
+    // straggler of the previous instance
+    session_ = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    repair_thread_ = std::thread([this] { repair_loop(); });
+}
+
+MulticastPublisher::~MulticastPublisher() {
+    const uint64_t one = 1;
+    if (::write(stop_fd_, &one, sizeof(one)) < 0) {
+        // eventfd writes only fail on overflow
+    }
+    repair_thread_.join();
+    close_fd(stop_fd_);
+    close_fd(fd_);
+}
+
+uint64_t MulticastPublisher::sequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return next_sequence_;
+}
+
+void MulticastPublisher::send(span<const span<const char>> parts) {
+    size_t size = 0;
+    for (const auto& part : parts) {
+        size += part.size();
+    }
+    const size_t fragments = std::max<size_t>((size + options_.fragment_size - 1) / options_.fragment_size, 1);
+
+    std::vector<WireHeader> headers(fragments);
+    std::vector<struct iovec> iovecs;
+    iovecs.reserve(2 * fragments + parts.size());
+    std::vector<struct mmsghdr> packets(fragments);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint64_t first = next_sequence_;
+        next_sequence_ += fragments;
+        last_send_ = std::chrono::steady_clock::now();
+
+        size_t part = 0;
+        size_t part_offset = 0;
+        for (size_t f = 0; f < fragments; ++f) {
+            headers[f] = WireHeader{WIRE_MAGIC, WIRE_DATA, 0, endpoint_.topic, session_, first + f,
+                                    static_cast<uint32_t>(f), static_cast<uint32_t>(fragments), size};
+
+            const size_t begin = iovecs.size();
+            iovecs.push_back({&headers[f], sizeof(WireHeader)});
+            size_t room = options_.fragment_size;
+            while (room > 0 && part < parts.size()) {
+                const size_t take = std::min(room, parts[part].size() - part_offset);
+                if (take > 0) {
+                    iovecs.push_back({const_cast<char*>(parts[part].data()) + part_offset, take});
+                    room -= take;
+                    part_offset += take;
+                }
+                if (part_offset == parts[part].size()) {
+                    part++;
+                    part_offset = 0;
+                }
+            }
+
+            packets[f] = {};
+            packets[f].msg_hdr.msg_name = &endpoint_.group;
+            packets[f].msg_hdr.msg_namelen = sizeof(endpoint_.group);
+            packets[f].msg_hdr.msg_iov = &iovecs[begin];
+            packets[f].msg_hdr.msg_iovlen = iovecs.size() - begin;
+
+            // Keep a copy for repairs before it goes out, so an early NACK finds it
+            Slot& slot = history_[(first + f) % history_.size()];
+            slot.sequence = first + f;
+            slot.repaired_at = {};
+            slot.bytes.clear();
+            for (size_t i = begin; i < iovecs.size(); ++i) {
+                const char* base = static_cast<const char*>(iovecs[i].iov_base);
+                slot.bytes.insert(slot.bytes.end(), base, base + iovecs[i].iov_len);
+            }
+        }
+    }
+
+    send_all(fd_, packets.data(), packets.size());
+}
+
+void MulticastPublisher::send_heartbeat() {
+    WireHeader header{WIRE_MAGIC, WIRE_HEARTBEAT, 0, endpoint_.topic, session_, 0, 0, 0, 0};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        header.sequence = next_sequence_;
+        last_send_ = std::chrono::steady_clock::now();
+    }
+    ::sendto(fd_, &header, sizeof(header), 0, reinterpret_cast<const sockaddr*>(&endpoint_.group),
+             sizeof(endpoint_.group));
+}
+
+void MulticastPublisher::repair(const char* nack, size_t size) {
+    WireHeader header;
+    if (size < sizeof(header)) {
+        return;
+    }
+    std::memcpy(&header, nack, sizeof(header));
+    if (header.magic != WIRE_MAGIC || header.type != WIRE_NACK || header.topic != endpoint_.topic ||
+        header.session != session_ || header.index > MAX_NACK_RANGES ||
+        size < sizeof(header) + header.index * sizeof(NackRange)) {
+        return;
+    }
+
+    struct mmsghdr packets[REPAIR_BATCH];
+    struct iovec iovecs[REPAIR_BATCH];
+    size_t count = 0;
+    uint64_t budget = MAX_REPAIR_PER_NACK;
+    const auto now = std::chrono::steady_clock::now();
+
+    // Retransmit under the lock: send() may otherwise recycle a slot mid-flight
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint32_t r = 0; r < header.index && budget > 0; ++r) {
+        NackRange range;
+        std::memcpy(&range, nack + sizeof(header) + r * sizeof(NackRange), sizeof(range));
+        for (uint64_t seq = range.first; seq < range.first + std::min(range.count, budget); ++seq) {
+            Slot& slot = history_[seq % history_.size()];
+            if (slot.sequence != seq || now - slot.repaired_at < REPAIR_HOLDOFF) {
+                continue;  // Too old, or just sent again for another subscriber
+            }
+            slot.repaired_at = now;
+            iovecs[count] = {slot.bytes.data(), slot.bytes.size()};
+            packets[count] = {};
+            packets[count].msg_hdr.msg_name = &endpoint_.group;
+            packets[count].msg_hdr.msg_namelen = sizeof(endpoint_.group);
+            packets[count].msg_hdr.msg_iov = &iovecs[count];
+            packets[count].msg_hdr.msg_iovlen = 1;
+            if (++count == REPAIR_BATCH) {
+                send_all(fd_, packets, count);
+                retransmitted_.fetch_add(count, std::memory_order_relaxed);
+                count = 0;
+            }
+        }
+        budget -= std::min(range.count, budget);
+    }
+    send_all(fd_, packets, count);
+    retransmitted_.fetch_add(count, std::memory_order_relaxed);
+}
+
+void MulticastPublisher::repair_loop() noexcept {
+    std::vector<char> buffer(sizeof(WireHeader) + MAX_NACK_RANGES * sizeof(NackRange));
+    const int heartbeat_ms = static_cast<int>(std::max<int64_t>(options_.heartbeat.count(), 1));
+
+    for (;;) {
+        struct pollfd fds[2] = {{fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+        const int rc = ::poll(fds, 2, heartbeat_ms);
+        if (rc < 0 && errno != EINTR) {
+            return;
+        }
+        if (fds[1].revents & POLLIN) {
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            for (;;) {
+                const ssize_t n = ::recv(fd_, buffer.data(), buffer.size(), MSG_DONTWAIT);
+                if (n < 0) break;
+                repair(buffer.data(), static_cast<size_t>(n));
+            }
+        }
+
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle = std::chrono::steady_clock::now() - last_send_ >= options_.heartbeat;
+        }
+        if (idle) {
+            send_heartbeat();
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// MulticastSubscriber
+// ----------------------------------------------------------------------------
+
+std::unique_ptr<MulticastSubscriber> MulticastSubscriber::join(std::string_view name, const MulticastOptions& options) {
+    const MulticastEndpoint endpoint = multicast_endpoint(name);
+
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw_errno("Failed to create multicast socket");
+    }
+
+    const int one = 1;
+    const int zero = 0;
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = endpoint.group.sin_port;
+    ip_mreq membership{};
+    membership.imr_multiaddr = endpoint.group.sin_addr;
+    membership.imr_interface = endpoint.interface;
+
+    // Every subscriber of the topic binds the same port; only datagrams of
+    // groups this socket joined are delivered to it
+    if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+        ::bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0 ||
+        ::setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0 ||
+        ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_ALL, &zero, sizeof(zero)) < 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "Failed to join multicast group");
+    }
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &options.receive_buffer, sizeof(options.receive_buffer));
+
+    return std::unique_ptr<MulticastSubscriber>(new MulticastSubscriber(fd, endpoint));
+}
+
+MulticastSubscriber::MulticastSubscriber(int fd, const MulticastEndpoint& endpoint)
+    : fd_(fd),
+      endpoint_(endpoint),
+      message_(ByteBuffer::allocator_type(resource_)),
+      slots_(MULTICAST_RECV_BATCH * (sizeof(WireHeader) + MULTICAST_MAX_FRAGMENT)),
+      names_(MULTICAST_RECV_BATCH),
+      iovecs_(MULTICAST_RECV_BATCH),
+      packets_(MULTICAST_RECV_BATCH) {}
+
+MulticastSubscriber::~MulticastSubscriber() {
+    close_fd(fd_);
+}
+
+void MulticastSubscriber::set_memory_resource(std::pmr::memory_resource* resource) noexcept {
+    resource_ = resource != nullptr ? resource : std::pmr::get_default_resource();
+    message_ = ByteBuffer(ByteBuffer::allocator_type(resource_));
+    assembling_ = false;
+}
+
+void MulticastSubscriber::resync(uint64_t sequence) {
+    synced_ = true;
+    expected_ = highest_ = sequence;
+    pending_.clear();
+    assembling_ = false;
+    attempts_ = 0;
+    repair_mark_ = sequence;
+}
+
+void MulticastSubscriber::handle(const char* data, size_t size, const sockaddr_in& from) {
+    WireHeader header;
+    if (size < sizeof(header)) {
+        return;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != WIRE_MAGIC || header.topic != endpoint_.topic ||
+        (header.type != WIRE_DATA && header.type != WIRE_HEARTBEAT)) {
+        return;
+    }
+
+    const char* payload = data + sizeof(header);
+    const size_t length = size - sizeof(header);
+    if (header.type == WIRE_DATA &&
+        (header.fragments == 0 || header.index >= header.fragments || header.size > MAX_MESSAGE_SIZE)) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (!synced_ || header.session != session_) {
+        // Sessions are start times: a restarted publisher takes over, late
+        // retransmissions from the old one do not, unless it has been
+        // silent long enough that the new one may have an older clock
+        if (synced_ && header.session < session_ && now - last_heard_ < MULTICAST_SESSION_TIMEOUT) {
+            return;
+        }
+        // Start at the message in flight (its earlier fragments are
+        // repaired) or at the next one
+        session_ = header.session;
+        resync(header.type == WIRE_DATA ? header.sequence - header.index : header.sequence);
+    }
+    publisher_ = from;
+    last_heard_ = now;
+
+    if (header.type == WIRE_HEARTBEAT) {
+        highest_ = std::max(highest_, header.sequence);
+        return;
+    }
+
+    const uint64_t seq = header.sequence;
+    if (seq < expected_ || pending_.count(seq) != 0) {
+        stats_.duplicates++;
+        return;
+    }
+    highest_ = std::max(highest_, seq + 1);
+
+    if (seq - expected_ >= MULTICAST_REORDER_WINDOW) {
+        // Hopelessly behind: give up on everything before this datagram
+        stats_.lost += seq - expected_ - pending_.size();
+        pending_.clear();
+        expected_ = seq;
+        assembling_ = false;
+        attempts_ = 0;
+    }
+
+    if (seq == expected_) {
+        accept(header.index, header.fragments, header.size, payload, length);
+        expected_++;
+        advance();
+    } else {
+        pending_.emplace(seq, Fragment{header.index, header.fragments, header.size,
+                                       std::vector<char>(payload, payload + length)});
+    }
+}
+
+void MulticastSubscriber::accept(uint32_t index, uint32_t fragments, uint64_t size, const char* payload,
+                                 size_t length) {
+    if (index == 0) {
+        message_.resize(size);
+        filled_ = 0;
+        assembling_ = true;
+    } else if (!assembling_ || message_.size() != size) {
+        return;  // The head of this message was lost
+    }
+    if (length > message_.size() - filled_) {
+        assembling_ = false;
+        return;
+    }
+    if (length != 0) {
+        std::memcpy(message_.data() + filled_, payload, length);
+    }
+    filled_ += length;
+
+    if (index + 1 == fragments) {
+        assembling_ = false;
+        if (filled_ != message_.size()) {
+            return;
+        }
+        ready_.push_back(std::move(message_));
+        message_ = ByteBuffer(ByteBuffer::allocator_type(resource_));
+        if (ready_.size() > MULTICAST_MAX_READY) {
+            ready_.pop_front();
+            stats_.dropped++;
+        }
+    }
+}
+
+// Deliver datagrams held back until the gap before them was filled
+void MulticastSubscriber::advance() {
+    for (auto it = pending_.begin(); it != pending_.end() && it->first <= expected_; it = pending_.erase(it)) {
+        if (it->first == expected_) {
+            const Fragment& fragment = it->second;
+            accept(fragment.index, fragment.fragments, fragment.size, fragment.payload.data(),
+                   fragment.payload.size());
+            expected_++;
+        }
+    }
+}
+
+void MulticastSubscriber::request_repairs() {
+    if (!repairing()) {
+        attempts_ = 0;
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (now < next_nack_) {
+        return;
+    }
+
+    // Only rounds in which no repair arrived count towards giving up
+    const uint64_t received = expected_ + pending_.size();
+    if (received != repair_mark_) {
+        repair_mark_ = received;
+        attempts_ = 0;
+    }
+    if (attempts_ >= MULTICAST_NACK_ATTEMPTS) {
+        // Out of the publisher's history, or the publisher is gone
+        const uint64_t next = pending_.empty() ? highest_ : pending_.begin()->first;
+        stats_.lost += next - expected_;
+        expected_ = next;
+        assembling_ = false;
+        advance();
+        attempts_ = 0;
+        repair_mark_ = expected_ + pending_.size();
+        if (!repairing()) {
+            return;
+        }
+    }
+
+    char buffer[sizeof(WireHeader) + MAX_NACK_RANGES * sizeof(NackRange)];
+    WireHeader header{WIRE_MAGIC, WIRE_NACK, 0, endpoint_.topic, session_, 0, 0, 0, 0};
+    uint64_t seq = expected_;
+    for (auto it = pending_.begin(); seq < highest_ && header.index < MAX_NACK_RANGES;) {
+        const uint64_t end = it != pending_.end() ? it->first : highest_;
+        if (end > seq) {
+            const NackRange range{seq, end - seq};
+            std::memcpy(buffer + sizeof(header) + header.index * sizeof(range), &range, sizeof(range));
+            header.index++;
+        }
+        if (it == pending_.end()) {
+            break;
+        }
+        seq = it->first + 1;
+        ++it;
+    }
+    std::memcpy(buffer, &header, sizeof(header));
+    ::sendto(fd_, buffer, sizeof(header) + header.index * sizeof(NackRange), MSG_DONTWAIT,
+             reinterpret_cast<const sockaddr*>(&publisher_), sizeof(publisher_));
+    stats_.nacks++;
+    attempts_++;
+    next_nack_ = now + MULTICAST_NACK_INTERVAL;
+}
+
+bool MulticastSubscriber::pump() {
+    const size_t slot_size = sizeof(WireHeader) + MULTICAST_MAX_FRAGMENT;
+    for (size_t batch = 0; batch < MAX_DRAIN_BATCHES; ++batch) {
+        for (size_t i = 0; i < MULTICAST_RECV_BATCH; ++i) {
+            iovecs_[i] = {slots_.data() + i * slot_size, slot_size};
+            packets_[i] = {};
+            packets_[i].msg_hdr.msg_name = &names_[i];
+            packets_[i].msg_hdr.msg_namelen = sizeof(names_[i]);
+            packets_[i].msg_hdr.msg_iov = &iovecs_[i];
+            packets_[i].msg_hdr.msg_iovlen = 1;
+        }
+        const int n = ::recvmmsg(fd_, packets_.data(), MULTICAST_RECV_BATCH, MSG_DONTWAIT, nullptr);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            if ((packets_[i].msg_hdr.msg_flags & MSG_TRUNC) == 0) {
+                handle(slots_.data() + i * slot_size, packets_[i].msg_len, names_[i]);
+            }
+        }
+        if (static_cast<size_t>(n) < MULTICAST_RECV_BATCH) {
+            break;
+        }
+    }
+    request_repairs();
+    return !ready_.empty();
+}
+
+bool MulticastSubscriber::receive(ByteBuffer& out, int timeout_ms, bool conflate) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+
+    for (;;) {
+        if (pump()) {
+            if (conflate) {
+                out = std::move(ready_.back());
+                ready_.clear();
+            } else {
+                out = std::move(ready_.front());
+                ready_.pop_front();
+            }
+            return true;
+        }
+
+        int wait_ms = -1;
+        if (timeout_ms >= 0) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0) {
+                return false;
+            }
+            wait_ms = static_cast<int>(left);
+        }
+        // Wake up to repeat NACKs while a gap is open
+        if (repairing()) {
+            const int nack_ms = static_cast<int>(MULTICAST_NACK_INTERVAL.count());
+            wait_ms = wait_ms < 0 ? nack_ms : std::min(wait_ms, nack_ms);
+        }
+
+        struct pollfd pfd = {fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, wait_ms) < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+} // namespace msgq
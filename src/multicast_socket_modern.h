@@ -0,0 +1,229 @@
+#pragma once
+
+/*
+ * Publish/subscribe over UDP multicast with NACK-based repair
+ *
+ * Each message is sent once to the topic's group however many processes
+ * (or hosts) subscribe, split into datagrams of MulticastOptions::
+ * fragment_size that carry a per-publisher sequence number. Fragments of
+ * one message go out in a single sendmmsg(2); subscribers drain up to
+ * MULTICAST_RECV_BATCH datagrams per recvmmsg(2).
+ *
+ * Reliability: the publisher keeps the last `history` datagrams. A
+ * subscriber that sees a sequence gap (from later data, or from the
+ * heartbeat the publisher sends while idle) unicasts a NACK with the
+ * missing ranges to the publisher, whose repair thread multicasts them
+ * again from history. A gap still open after MULTICAST_NACK_ATTEMPTS
+ * rounds without any repair arriving (it fell out of the history, or the
+ * publisher is gone) is skipped and counted as lost. Messages are
+ * delivered whole and in publish order.
+ *
+ * Addressing: group MSGQ_MULTICAST_GROUP (default 239.255.77.1) on
+ * MSGQ_MULTICAST_IF (default 127.0.0.1, so everything stays on the
+ * loopback interface until configured otherwise); the port is derived
+ * from the topic name and OPENPILOT_PREFIX, and datagrams carry the topic
+ * hash so colliding topics ignore each other. One publisher per topic.
+ *
+ * Self-contained (no msgq_modern.h / msgq.h) like memfd_segment_modern.h.
+ */
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "span_modern.h"
+#include "default_init_allocator_modern.h"
+
+namespace msgq {
+
+// Environment switch for the multicast backend (MSGQ_MULTICAST=1)
+[[nodiscard]] bool messaging_use_multicast() noexcept;
+
+// Largest fragment payload a subscriber accepts (jumbo frames)
+constexpr size_t MULTICAST_MAX_FRAGMENT = 8192;
+
+// Datagrams a subscriber takes per recvmmsg(2)
+constexpr size_t MULTICAST_RECV_BATCH = 32;
+
+// Time between NACKs for the same gap, and how many are sent before
+// the gap is given up on
+constexpr auto MULTICAST_NACK_INTERVAL = std::chrono::milliseconds(10);
+constexpr int MULTICAST_NACK_ATTEMPTS = 5;
+
+// A subscriber follows a publisher with an older session (start time)
+// only after the current one has been silent this long
+constexpr auto MULTICAST_SESSION_TIMEOUT = std::chrono::seconds(1);
+
+// Datagrams a subscriber holds out of order while waiting for repairs
+constexpr size_t MULTICAST_REORDER_WINDOW = 16384;
+
+// Complete messages queued in a subscriber before the oldest are dropped
+constexpr size_t MULTICAST_MAX_READY = 1024;
+
+struct MulticastOptions {
+    size_t fragment_size = 1400;                   // Payload bytes per datagram (fits a 1500 MTU)
+    size_t history = 8192;                         // Datagrams the publisher keeps for repair
+    int ttl = 1;                                   // Hops; 1 keeps traffic on the local network
+    std::chrono::milliseconds heartbeat{50};       // Idle publisher announces its sequence this often
+    int receive_buffer = 4 * 1024 * 1024;          // Subscriber SO_RCVBUF
+};
+
+// Group, port and topic hash of a topic.
+// Throws std::invalid_argument for empty names or a malformed
+// MSGQ_MULTICAST_GROUP / MSGQ_MULTICAST_IF.
+struct MulticastEndpoint {
+    sockaddr_in group;      // Group address and topic port
+    in_addr interface;      // Local interface to send and join on
+    uint64_t topic;         // Carried in every datagram
+};
+[[nodiscard]] MulticastEndpoint multicast_endpoint(std::string_view name);
+
+class MulticastPublisher {
+public:
+    // Open the topic's sending socket and start the repair thread.
+    // Throws std::system_error if the socket cannot be set up.
+    [[nodiscard]] static std::unique_ptr<MulticastPublisher> create(std::string_view name,
+                                                                    const MulticastOptions& options = {});
+
+    MulticastPublisher(const MulticastPublisher&) = delete;
+    MulticastPublisher& operator=(const MulticastPublisher&) = delete;
+
+    // Stops the repair thread; subscribers lose what they have not repaired
+    ~MulticastPublisher();
+
+    // Send the concatenated parts as one message
+    void send(span<const span<const char>> parts);
+
+    // Datagrams sent again on request
+    [[nodiscard]] uint64_t retransmitted() const noexcept { return retransmitted_.load(std::memory_order_relaxed); }
+
+    // Sequence number of the next datagram
+    [[nodiscard]] uint64_t sequence() const;
+
+private:
+    struct Slot {
+        uint64_t sequence = UINT64_MAX;
+        std::chrono::steady_clock::time_point repaired_at{};  // Last retransmission, to absorb NACK storms
+        std::vector<char> bytes;                                // Header + payload
+    };
+
+    MulticastPublisher(int fd, int stop_fd, const MulticastEndpoint& endpoint, const MulticastOptions& options);
+
+    void repair_loop() noexcept;
+    void repair(const char* nack, size_t size);
+    void send_heartbeat();
+
+    int fd_ = -1;
+    int stop_fd_ = -1;
+    MulticastEndpoint endpoint_;
+    MulticastOptions options_;
+    uint64_t session_;
+
+    mutable std::mutex mutex_;  // Guards the sequence, history and last_send_
+    uint64_t next_sequence_ = 0;
+    std::vector<Slot> history_;
+    std::chrono::steady_clock::time_point last_send_{};
+    std::atomic<uint64_t> retransmitted_{0};
+    std::thread repair_thread_;
+};
+
+class MulticastSubscriber {
+public:
+    // Join the topic's group. Throws std::system_error on socket errors.
+    [[nodiscard]] static std::unique_ptr<MulticastSubscriber> join(std::string_view name,
+                                                                   const MulticastOptions& options = {});
+
+    MulticastSubscriber(const MulticastSubscriber&) = delete;
+    MulticastSubscriber& operator=(const MulticastSubscriber&) = delete;
+    ~MulticastSubscriber();
+
+    // Messages are allocated from `resource` (null = default); it must
+    // outlive them
+    void set_memory_resource(std::pmr::memory_resource* resource) noexcept;
+
+    // Next message into `out`, waiting up to `timeout_ms` (0 polls,
+    // negative waits forever). With `conflate` only the newest complete
+    // message is returned. False on timeout.
+    bool receive(ByteBuffer& out, int timeout_ms, bool conflate = false);
+
+    // Read what is waiting without blocking and send due NACKs.
+    // True if a complete message is ready.
+    bool pump();
+
+    // A complete message is ready (no syscall)
+    [[nodiscard]] bool ready() const noexcept { return !ready_.empty(); }
+
+    // A gap is being repaired: call pump() within MULTICAST_NACK_INTERVAL
+    [[nodiscard]] bool repairing() const noexcept { return synced_ && expected_ < highest_; }
+
+    // Socket to poll for POLLIN
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+
+    struct Stats {
+        uint64_t lost = 0;         // Datagrams given up on
+        uint64_t duplicates = 0;   // Datagrams received twice
+        uint64_t nacks = 0;        // NACK datagrams sent
+        uint64_t dropped = 0;      // Complete messages dropped because nobody read them
+    };
+    [[nodiscard]] const Stats& stats() const noexcept { return stats_; }
+
+private:
+    struct Fragment {
+        uint32_t index;
+        uint32_t fragments;
+        uint64_t size;
+        std::vector<char> payload;
+    };
+
+    MulticastSubscriber(int fd, const MulticastEndpoint& endpoint);
+
+    void handle(const char* data, size_t size, const sockaddr_in& from);
+    void accept(uint32_t index, uint32_t fragments, uint64_t size, const char* payload, size_t length);
+    void advance();
+    void request_repairs();
+    void resync(uint64_t sequence);
+
+    int fd_ = -1;
+    MulticastEndpoint endpoint_;
+    std::pmr::memory_resource* resource_ = std::pmr::get_default_resource();
+
+    bool synced_ = false;
+    uint64_t session_ = 0;
+    sockaddr_in publisher_{};                 // Where NACKs go
+    uint64_t expected_ = 0;                   // Next sequence to deliver
+    uint64_t highest_ = 0;                    // One past the highest sequence known to exist
+    std::map<uint64_t, Fragment> pending_;    // Received ahead of expected_
+    int attempts_ = 0;                        // NACK rounds without any repair arriving
+    uint64_t repair_mark_ = 0;                // expected_ + pending_.size() at the last NACK
+    std::chrono::steady_clock::time_point last_heard_{};  // Last datagram of the current session
+    std::chrono::steady_clock::time_point next_nack_{};
+
+    ByteBuffer message_;                      // Message being reassembled
+    size_t filled_ = 0;
+    bool assembling_ = false;
+    std::deque<ByteBuffer> ready_;
+    Stats stats_;
+
+    // recvmmsg batch
+    std::vector<char> slots_;
+    std::vector<sockaddr_in> names_;
+    std::vector<struct iovec> iovecs_;
+    std::vector<struct mmsghdr> packets_;
+};
+
+} // namespace msgq
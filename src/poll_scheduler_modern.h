@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// @file poll_scheduler_modern.h
+/// @brief 轮询结果调度：按优先级、截止时间与等待时长排序就绪套接字
+/// @details 独立头文件（不依赖 ipc.h / zmq.h），MSGQ、Fake 与 ZMQ 轮询器共用。
+///          等待时长从套接字首次被观察到就绪时开始计算，直到某一轮轮询
+///          发现它不再就绪（已被读空）为止，近似于最旧未读消息的等待时间。
+
+namespace msgq {
+
+/// @brief 注册套接字时的调度选项
+struct PollOptions {
+  int priority = 0;                        ///< 优先级，越大越先返回
+  std::chrono::milliseconds deadline{0};   ///< 可容忍的最长等待，超过后排到最前（0 = 无）
+};
+
+/// @brief 就绪套接字排序器
+/// @details 排序规则：
+///   1. 已超过截止时间或防饿死上限的套接字排最前，等待最久者优先；
+///   2. 其余按优先级从高到低；
+///   3. 同优先级按等待时长从长到短；
+///   4. 仍相同时保持注册（传入）顺序。
+class PollScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// @brief 默认防饿死上限：低优先级套接字等待超过此时长即被提前
+  static constexpr std::chrono::milliseconds DEFAULT_STARVATION_LIMIT{100};
+
+  /// @brief 设置套接字的调度选项
+  /// @param key 套接字标识（SubSocket* 或 ZMQ 套接字指针）
+  /// @param options 调度选项
+  void set_options(const void* key, const PollOptions& options) {
+    entries_[key].options = options;
+  }
+
+  /// @brief 设置防饿死上限
+  /// @param limit 等待上限，0 表示关闭防饿死
+  void set_starvation_limit(std::chrono::milliseconds limit) noexcept {
+    starvation_limit_ = limit;
+  }
+
+  /// @brief 就地排序本轮就绪的套接字，并更新各自的等待起点
+  /// @param ready 本轮就绪的套接字（注册顺序）
+  /// @param now 本轮轮询时间
+  template <typename T>
+  void order(std::vector<T*>& ready, Clock::time_point now = Clock::now()) {
+    ++round_;
+    for (T* socket : ready) {
+      Entry& entry = entries_[socket];
+      if (!entry.ready) {
+        entry.ready = true;
+        entry.ready_since = now;
+      }
+      entry.round = round_;
+    }
+    // 本轮未就绪说明已被读空，下次就绪重新计时
+    for (auto& item : entries_) {
+      if (item.second.round != round_) {
+        item.second.ready = false;
+      }
+    }
+
+    std::stable_sort(ready.begin(), ready.end(), [&](T* a, T* b) {
+      const Entry& ea = entries_.find(a)->second;
+      const Entry& eb = entries_.find(b)->second;
+      const bool ua = urgent(ea, now);
+      const bool ub = urgent(eb, now);
+      if (ua != ub) {
+        return ua;
+      }
+      if (!ua && ea.options.priority != eb.options.priority) {
+        return ea.options.priority > eb.options.priority;
+      }
+      return ea.ready_since < eb.ready_since;
+    });
+  }
+
+  /// @brief 套接字连续就绪的时长（未就绪时为 0）
+  /// @param key 套接字标识
+  /// @param now 当前时间
+  [[nodiscard]] Clock::duration pending_age(const void* key, Clock::time_point now = Clock::now()) const {
+    auto it = entries_.find(key);
+    if (it == entries_.end() || !it->second.ready) {
+      return Clock::duration::zero();
+    }
+    return now - it->second.ready_since;
+  }
+
+private:
+  struct Entry {
+    PollOptions options;
+    Clock::time_point ready_since{};  ///< 首次观察到就绪的时间
+    bool ready = false;
+    uint64_t round = 0;               ///< 最近一次就绪的轮次
+  };
+
+  [[nodiscard]] bool urgent(const Entry& entry, Clock::time_point now) const noexcept {
+    const auto waited = now - entry.ready_since;
+    if (entry.options.deadline.count() > 0 && waited >= entry.options.deadline) {
+      return true;
+    }
+    return starvation_limit_.count() > 0 && waited >= starvation_limit_;
+  }
+
+  std::unordered_map<const void*, Entry> entries_;
+  std::chrono::milliseconds starvation_limit_{DEFAULT_STARVATION_LIMIT};
+  uint64_t round_ = 0;
+};
+
+}  // namespace msgq
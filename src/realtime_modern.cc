@@ -0,0 +1,280 @@
+#include "realtime_modern.h"
+#include <sys/mman.h>
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace msgq {
+
+namespace {
+
+// Stack left untouched below the prefaulted block for the frames of
+// whatever the thread calls next, and for the guard page
+constexpr size_t STACK_MARGIN = 64 * 1024;
+
+std::string errno_string(int err) {
+    return std::string(strerror(err));
+}
+
+const char* policy_name(int policy) noexcept {
+    switch (policy) {
+        case SCHED_OTHER: return "SCHED_OTHER";
+        case SCHED_FIFO: return "SCHED_FIFO";
+        case SCHED_RR: return "SCHED_RR";
+        case SCHED_BATCH: return "SCHED_BATCH";
+        case SCHED_IDLE: return "SCHED_IDLE";
+        default: return "SCHED_?";
+    }
+}
+
+// "0-3,6"
+std::string format_cpu_list(const std::vector<int>& cpus) {
+    std::string out;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            ++j;
+        }
+        if (!out.empty()) {
+            out += ',';
+        }
+        out += std::to_string(cpus[i]);
+        if (j > i) {
+            out += '-' + std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return out.empty() ? "none" : out;
+}
+
+std::string format_bytes(size_t bytes) {
+    if (bytes >= 1024 * 1024) {
+        return std::to_string(bytes / (1024 * 1024)) + " MiB";
+    }
+    return std::to_string(bytes / 1024) + " KiB";
+}
+
+std::vector<int> sorted_cpus(std::vector<int> cpus) {
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+size_t locked_memory() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmLck:") == 0) {
+            return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+        }
+    }
+    return 0;
+}
+
+void validate(const RealtimeOptions& options) {
+    const int max_priority = sched_get_priority_max(SCHED_FIFO);
+    if (options.priority < 0 || options.priority > max_priority) {
+        throw std::invalid_argument("SCHED_FIFO priority must be 0-" + std::to_string(max_priority) +
+                                    ", got " + std::to_string(options.priority));
+    }
+    for (int cpu : options.cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            throw std::invalid_argument("CPU out of range: " + std::to_string(cpu));
+        }
+    }
+}
+
+// Bytes of stack between the caller's frame and the guard, less the margin
+size_t stack_headroom() noexcept {
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+        return 0;
+    }
+    void* base = nullptr;
+    size_t size = 0;
+    pthread_attr_getstack(&attr, &base, &size);
+    pthread_attr_destroy(&attr);
+
+    const auto* frame = static_cast<const char*>(__builtin_frame_address(0));
+    const auto* low = static_cast<const char*>(base);
+    if (frame <= low + STACK_MARGIN || frame > low + size) {
+        return 0;
+    }
+    return static_cast<size_t>(frame - low) - STACK_MARGIN;
+}
+
+// Touch every page of a `bytes` block just below the caller's frame; the
+// pages stay mapped (and locked, after mlockall(MCL_FUTURE)) once it returns
+__attribute__((noinline)) void touch_stack(size_t bytes) {
+    volatile char* block = static_cast<volatile char*>(alloca(bytes));
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t i = 0; i < bytes; i += page) {
+        block[i] = 0;
+    }
+    block[bytes - 1] = 0;
+}
+
+} // namespace
+
+std::string RealtimeReport::describe() const {
+    std::string out = std::string(policy_name(policy)) + "/" + std::to_string(priority);
+    out += " cpus " + format_cpu_list(cpus);
+    out += " locked " + format_bytes(locked_bytes);
+    out += " stack " + format_bytes(stack_prefaulted);
+    for (const auto& failure : failures) {
+        out += "; " + failure;
+    }
+    return out;
+}
+
+RealtimeReport inspect_current_thread(const RealtimeOptions& expected) {
+    RealtimeReport report;
+
+    sched_param param{};
+    if (pthread_getschedparam(pthread_self(), &report.policy, &param) == 0) {
+        report.priority = param.sched_priority;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                report.cpus.push_back(cpu);
+            }
+        }
+    }
+
+    report.locked_bytes = locked_memory();
+
+    if (expected.priority > 0 && (report.policy != SCHED_FIFO || report.priority != expected.priority)) {
+        report.failures.push_back("scheduler is " + std::string(policy_name(report.policy)) + "/" +
+                                  std::to_string(report.priority) + ", wanted SCHED_FIFO/" +
+                                  std::to_string(expected.priority));
+    }
+    if (!expected.cpus.empty() && report.cpus != sorted_cpus(expected.cpus)) {
+        report.failures.push_back("running on cpus " + format_cpu_list(report.cpus) + ", wanted " +
+                                  format_cpu_list(sorted_cpus(expected.cpus)));
+    }
+    if (expected.lock_memory && report.locked_bytes == 0) {
+        report.failures.push_back("no memory is locked");
+    }
+    return report;
+}
+
+RealtimeReport configure_current_thread(const RealtimeOptions& options) {
+    validate(options);
+
+    // Settings the kernel refused are reported with its reason rather than
+    // again as a mismatch by inspect_current_thread()
+    RealtimeOptions check = options;
+    std::vector<std::string> failures;
+
+    // Affinity first, so memory is locked and the stack faulted in on the
+    // cores the thread will run on
+    if (!options.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : options.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        if (int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); err != 0) {
+            failures.push_back("cpus " + format_cpu_list(sorted_cpus(options.cpus)) + ": " + errno_string(err));
+            check.cpus.clear();
+        }
+    }
+
+    if (options.lock_memory && ::mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        failures.push_back("mlockall: " + errno_string(errno));
+        check.lock_memory = false;
+    }
+
+    size_t prefaulted = 0;
+    if (options.prefault_stack > 0) {
+        prefaulted = std::min(options.prefault_stack, stack_headroom());
+        if (prefaulted > 0) {
+            touch_stack(prefaulted);
+        }
+        if (prefaulted < options.prefault_stack) {
+            failures.push_back("stack prefault limited to " + format_bytes(prefaulted) + " of " +
+                               format_bytes(options.prefault_stack));
+        }
+    }
+
+    // Last: a FIFO thread spinning through the steps above could starve
+    // the rest of its core
+    if (options.priority > 0) {
+        sched_param param{};
+        param.sched_priority = options.priority;
+        if (int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); err != 0) {
+            failures.push_back("SCHED_FIFO/" + std::to_string(options.priority) + ": " + errno_string(err));
+            check.priority = 0;
+        }
+    }
+
+    RealtimeReport report = inspect_current_thread(check);
+    report.stack_prefaulted = prefaulted;
+    report.failures.insert(report.failures.begin(), failures.begin(), failures.end());
+    return report;
+}
+
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        const std::string item = list.substr(pos, end - pos);
+        int first = 0;
+        int last = 0;
+        int consumed = 0;
+        if (std::sscanf(item.c_str(), "%d-%d%n", &first, &last, &consumed) == 2 &&
+            consumed == static_cast<int>(item.size())) {
+            // Range
+        } else if (std::sscanf(item.c_str(), "%d%n", &first, &consumed) == 1 &&
+                   consumed == static_cast<int>(item.size())) {
+            last = first;
+        } else {
+            throw std::invalid_argument("Malformed CPU list: " + list);
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            throw std::invalid_argument("Malformed CPU list: " + list);
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+        pos = end + 1;
+    }
+    if (cpus.empty()) {
+        throw std::invalid_argument("Empty CPU list");
+    }
+    return sorted_cpus(std::move(cpus));
+}
+
+RealtimeThread& RealtimeThread::operator=(RealtimeThread&& other) noexcept {
+    if (this != &other) {
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        thread_ = std::move(other.thread_);
+        report_ = std::move(other.report_);
+    }
+    return *this;
+}
+
+RealtimeThread::~RealtimeThread() {
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+} // namespace msgq
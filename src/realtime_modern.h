@@ -0,0 +1,107 @@
+#pragma once
+
+/*
+ * Real-time setup for latency-critical threads
+ *
+ * configure_current_thread() applies SCHED_FIFO priority, CPU affinity,
+ * mlockall(2) and stack prefaulting in one call and then reads back what
+ * actually took effect, so a missing CAP_SYS_NICE, an RLIMIT_MEMLOCK that
+ * is too small or a core outside the container's cpuset shows up in the
+ * report instead of as jitter later. Nothing is thrown for settings the
+ * system refuses; only malformed options throw.
+ *
+ * RealtimeThread starts a thread that is configured before its body runs.
+ * CompressionPool (CompressionOptions::realtime) and rpc::Server::start()
+ * use it for their threads.
+ *
+ * Self-contained (no msgq_modern.h / msgq.h) like memfd_segment_modern.h.
+ */
+
+#include <cstddef>
+#include <future>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace msgq {
+
+struct RealtimeOptions {
+    int priority = 0;              // SCHED_FIFO priority (1-99); 0 keeps the current policy
+    std::vector<int> cpus;         // Cores the thread may run on; empty keeps the affinity
+    bool lock_memory = false;      // mlockall(MCL_CURRENT | MCL_FUTURE); affects the whole process
+    size_t prefault_stack = 0;     // Stack bytes to touch now so later growth does not page-fault
+};
+
+// What a thread is actually running with
+struct RealtimeReport {
+    int policy = 0;                     // SCHED_OTHER, SCHED_FIFO, ...
+    int priority = 0;
+    std::vector<int> cpus;              // Current affinity
+    size_t locked_bytes = 0;            // VmLck of the process
+    size_t stack_prefaulted = 0;
+    std::vector<std::string> failures;  // One line per requested setting that did not take effect
+
+    [[nodiscard]] bool ok() const noexcept { return failures.empty(); }
+
+    // One line, e.g. "SCHED_FIFO/80 cpus 2,3 locked 12 MiB stack 256 KiB"
+    [[nodiscard]] std::string describe() const;
+};
+
+// Apply `options` to the calling thread and report the result.
+// Throws std::invalid_argument for a priority or core out of range.
+RealtimeReport configure_current_thread(const RealtimeOptions& options);
+
+// Read back the calling thread's settings; `expected` settings that do not
+// hold are listed as failures (stack prefaulting cannot be observed and is
+// not checked)
+[[nodiscard]] RealtimeReport inspect_current_thread(const RealtimeOptions& expected = {});
+
+// Parse a core list such as "2-3,6". Throws std::invalid_argument.
+[[nodiscard]] std::vector<int> parse_cpu_list(const std::string& list);
+
+// A std::thread that applies RealtimeOptions before running its body.
+// The constructor returns once the options are applied, so report() is
+// final from the start. Joins on destruction.
+class RealtimeThread {
+public:
+    RealtimeThread() noexcept = default;
+
+    template <typename Body>
+    RealtimeThread(const RealtimeOptions& options, Body&& body) {
+        std::promise<RealtimeReport> configured;
+        std::future<RealtimeReport> report = configured.get_future();
+        thread_ = std::thread([options, configured = std::move(configured),
+                               body = std::forward<Body>(body)]() mutable {
+            try {
+                configured.set_value(configure_current_thread(options));
+            } catch (...) {
+                configured.set_exception(std::current_exception());
+                return;
+            }
+            body();
+        });
+        try {
+            report_ = report.get();
+        } catch (...) {
+            thread_.join();
+            throw;
+        }
+    }
+
+    RealtimeThread(RealtimeThread&&) noexcept = default;
+    RealtimeThread& operator=(RealtimeThread&& other) noexcept;
+    RealtimeThread(const RealtimeThread&) = delete;
+    RealtimeThread& operator=(const RealtimeThread&) = delete;
+    ~RealtimeThread();
+
+    [[nodiscard]] const RealtimeReport& report() const noexcept { return report_; }
+    [[nodiscard]] bool joinable() const noexcept { return thread_.joinable(); }
+    void join() { thread_.join(); }
+
+private:
+    std::thread thread_;
+    RealtimeReport report_;
+};
+
+} // namespace msgq
@@ -0,0 +1,319 @@
+#include "rpc_modern.h"
+#include <unistd.h>
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <utility>
+
+namespace msgq {
+namespace rpc {
+
+namespace {
+
+std::string request_queue_name(std::string_view service) {
+    return std::string(service) + "_rpc_req";
+}
+
+std::string reply_queue_name(std::string_view service) {
+    return std::string(service) + "_rpc_rep";
+}
+
+int64_t to_deadline_ns(Clock::time_point deadline) noexcept {
+    if (deadline == Clock::time_point::max()) {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+}
+
+// Queue::recv timeout for the time left until `deadline`, rounded up so we
+// never wake just short of it
+int timeout_until(Clock::time_point deadline) noexcept {
+    if (deadline == Clock::time_point::max()) {
+        return -1;
+    }
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    return static_cast<int>(std::clamp<int64_t>(remaining, 0, INT32_MAX));
+}
+
+void send_frame(Queue& queue, const FrameHeader& header, gsl::span<const char> payload) {
+    const gsl::span<const char> parts[2] = {
+        gsl::span<const char>(reinterpret_cast<const char*>(&header), sizeof(header)),
+        payload
+    };
+    queue.sendv(gsl::span<const gsl::span<const char>>(parts, 2));
+}
+
+// Split a received frame; false if it is too short to carry a header
+bool parse_frame(const Message& msg, FrameHeader& header, gsl::span<const char>& payload) noexcept {
+    if (msg.size() < sizeof(FrameHeader)) {
+        return false;
+    }
+    std::memcpy(&header, msg.data_ptr(), sizeof(header));
+    payload = gsl::span<const char>(msg.data_ptr() + sizeof(header), msg.size() - sizeof(header));
+    return true;
+}
+
+} // namespace
+
+// ============================================================================
+// Client implementation
+// ============================================================================
+
+class Client::Impl {
+public:
+    struct Pending {
+        bool done = false;
+        bool failed = false;
+        Message reply;
+    };
+
+    Queue request_;
+    Queue reply_;
+    uint32_t tag_;                   // Tells our replies from a previous client's
+    std::atomic<uint32_t> sequence_{0};
+
+    std::mutex send_mutex_;          // Queue is single-producer
+    std::mutex mutex_;               // Guards everything below
+    std::condition_variable cv_;
+    bool receiving_ = false;         // One caller drains replies for everyone
+    std::unordered_map<uint64_t, Pending> pending_;
+
+    Impl(std::string_view service, size_t size, SegmentMode mode)
+        : request_(Queue::create(request_queue_name(service), size, mode)),
+          reply_(Queue::create(reply_queue_name(service), size, mode)),
+          tag_(static_cast<uint32_t>(::getpid()) ^ std::random_device{}()) {
+        request_.init_publisher();
+        reply_.init_subscriber();
+    }
+
+    // Hand a reply to its waiting call; replies to cancelled calls are dropped
+    void dispatch(const Message& msg) {
+        FrameHeader header;
+        gsl::span<const char> payload;
+        if (!parse_frame(msg, header, payload) || (header.call_id >> 32) != tag_) {
+            return;
+        }
+        auto it = pending_.find(header.call_id);
+        if (it == pending_.end()) {
+            return;
+        }
+        it->second.done = true;
+        it->second.failed = header.kind == static_cast<uint32_t>(FrameKind::Error);
+        it->second.reply = Message(payload);
+    }
+
+    std::optional<Message> call(gsl::span<const char> request, Clock::time_point deadline) {
+        const uint64_t call_id = (static_cast<uint64_t>(tag_) << 32) |
+                                 sequence_.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.emplace(call_id, Pending{});
+        }
+
+        FrameHeader header{call_id, to_deadline_ns(deadline), static_cast<uint32_t>(FrameKind::Request), 0};
+        try {
+            std::lock_guard<std::mutex> lock(send_mutex_);
+            send_frame(request_, header, request);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.erase(call_id);
+            throw;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            auto it = pending_.find(call_id);
+            if (it->second.done) {
+                Pending result = std::move(it->second);
+                pending_.erase(it);
+                if (result.failed) {
+                    throw MessageQueueError("RPC handler failed: " +
+                                            std::string(result.reply.data_ptr(), result.reply.size()));
+                }
+                return std::move(result.reply);
+            }
+            if (Clock::now() >= deadline) {
+                // Cancel: a reply arriving later finds no entry and is dropped
+                pending_.erase(it);
+                return std::nullopt;
+            }
+
+            if (receiving_) {
+                cv_.wait_until(lock, deadline);
+                continue;
+            }
+
+            // Nobody is reading replies: do it ourselves, without the lock,
+            // until our own deadline at the latest
+            receiving_ = true;
+            lock.unlock();
+            Message msg;
+            try {
+                msg = reply_.recv(timeout_until(deadline));
+            } catch (...) {
+                lock.lock();
+                receiving_ = false;
+                cv_.notify_all();
+                throw;
+            }
+            lock.lock();
+            receiving_ = false;
+            if (!msg.empty()) {
+                dispatch(msg);
+            }
+            cv_.notify_all();
+        }
+    }
+};
+
+Client::Client(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+Client::Client(Client&&) noexcept = default;
+Client& Client::operator=(Client&&) noexcept = default;
+Client::~Client() = default;
+
+Client Client::create(std::string_view service, size_t size, SegmentMode mode) {
+    return Client(std::make_unique<Impl>(service, size, mode));
+}
+
+std::optional<Message> Client::call(gsl::span<const char> request, Clock::time_point deadline) {
+    if (!impl_) throw MessageQueueError("Client not initialized");
+    return impl_->call(request, deadline);
+}
+
+size_t Client::outstanding() const {
+    if (!impl_) return 0;
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    return impl_->pending_.size();
+}
+
+// ============================================================================
+// Server implementation
+// ============================================================================
+
+class Server::Impl {
+public:
+    Queue request_;
+    Queue reply_;
+    Handler handler_;
+    std::atomic<bool> stop_{false};
+    RealtimeThread thread_;  // Set by start()
+    std::exception_ptr error_;  // Why thread_ stopped early
+
+    Impl(std::string_view service, Handler handler, size_t size, SegmentMode mode)
+        : request_(Queue::create(request_queue_name(service), size, mode)),
+          reply_(Queue::create(reply_queue_name(service), size, mode)),
+          handler_(std::move(handler)) {
+        if (!handler_) {
+            throw MessageQueueError("RPC server needs a handler");
+        }
+        request_.init_subscriber();
+        reply_.init_publisher();
+    }
+
+    ~Impl() {
+        stop_.store(true, std::memory_order_relaxed);
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    size_t poll(int timeout_ms) {
+        size_t handled = 0;
+        for (Message msg = request_.recv(timeout_ms); !msg.empty(); msg = request_.recv(0)) {
+            if (handle(msg)) {
+                handled++;
+            }
+        }
+        return handled;
+    }
+
+    void run() {
+        while (!stop_.load(std::memory_order_relaxed)) {
+            poll(DEFAULT_TIMEOUT_MS);
+        }
+    }
+
+    // Returns false if the frame was not a live request
+    bool handle(const Message& msg) {
+        FrameHeader header;
+        gsl::span<const char> payload;
+        if (!parse_frame(msg, header, payload) || header.kind != static_cast<uint32_t>(FrameKind::Request)) {
+            return false;
+        }
+        // The caller has given up already; don't spend time on it
+        if (header.deadline_ns != 0 && to_deadline_ns(Clock::now()) >= header.deadline_ns) {
+            return false;
+        }
+
+        FrameHeader reply_header{header.call_id, header.deadline_ns, static_cast<uint32_t>(FrameKind::Reply), 0};
+        try {
+            Message reply = handler_(payload);
+            send_frame(reply_, reply_header, reply.data());
+        } catch (const MessageQueueError&) {
+            throw;
+        } catch (const std::exception& e) {
+            reply_header.kind = static_cast<uint32_t>(FrameKind::Error);
+            std::string_view what = e.what();
+            send_frame(reply_, reply_header, gsl::span<const char>(what.data(), what.size()));
+        }
+        return true;
+    }
+};
+
+Server::Server(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+Server::Server(Server&&) noexcept = default;
+Server& Server::operator=(Server&&) noexcept = default;
+Server::~Server() = default;
+
+Server Server::create(std::string_view service, Handler handler, size_t size, SegmentMode mode) {
+    return Server(std::make_unique<Impl>(service, std::move(handler), size, mode));
+}
+
+size_t Server::poll(int timeout_ms) {
+    if (!impl_) throw MessageQueueError("Server not initialized");
+    return impl_->poll(timeout_ms);
+}
+
+void Server::run() {
+    if (!impl_) throw MessageQueueError("Server not initialized");
+    impl_->run();
+}
+
+void Server::stop() noexcept {
+    if (impl_) {
+        impl_->stop_.store(true, std::memory_order_relaxed);
+    }
+}
+
+RealtimeReport Server::start(const RealtimeOptions& realtime) {
+    if (!impl_) throw MessageQueueError("Server not initialized");
+    if (impl_->thread_.joinable()) throw MessageQueueError("Server already started; call wait() first");
+
+    Impl* impl = impl_.get();
+    impl_->stop_.store(false, std::memory_order_relaxed);
+    impl_->error_ = nullptr;
+    impl_->thread_ = RealtimeThread(realtime, [impl] {
+        try {
+            impl->run();
+        } catch (...) {
+            impl->error_ = std::current_exception();
+        }
+    });
+    return impl_->thread_.report();
+}
+
+void Server::wait() {
+    if (!impl_) throw MessageQueueError("Server not initialized");
+    if (impl_->thread_.joinable()) {
+        impl_->thread_.join();
+    }
+    if (impl_->error_) {
+        std::rethrow_exception(std::exchange(impl_->error_, nullptr));
+    }
+}
+
+} // namespace rpc
+} // namespace msgq
@@ -0,0 +1,136 @@
+#pragma once
+
+/*
+ * Request/reply RPC over a pair of shared-memory queues
+ *
+ * A service `name` uses two queues: "<name>_rpc_req" carries requests from
+ * the Client to the Server, "<name>_rpc_rep" carries replies back. Every
+ * frame starts with a small header holding a correlation id and the
+ * caller's deadline, so a Client can keep many calls outstanding from any
+ * number of threads and match replies as they arrive. Both sides block on
+ * the queues' futex, not on sleep-polling.
+ *
+ * Queues are single-producer: a service has one Server and one Client
+ * (which may be shared by all threads of its process). Creating a second
+ * Server or Client while the first is alive throws MessageQueueError;
+ * processes that each need to call a service share one Client process or
+ * use a service name of their own.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "msgq_modern.h"
+#include "realtime_modern.h"
+
+namespace msgq {
+namespace rpc {
+
+using Clock = std::chrono::steady_clock;
+
+// Frame header in front of every request and reply
+struct FrameHeader {
+    uint64_t call_id;      // Correlation id: client tag (high 32) | sequence (low 32)
+    int64_t deadline_ns;   // Caller's deadline on CLOCK_MONOTONIC, 0 for none
+    uint32_t kind;         // FrameKind
+    uint32_t reserved;
+};
+
+static_assert(sizeof(FrameHeader) == 24, "frame header is sent as raw bytes");
+
+enum class FrameKind : uint32_t {
+    Request = 1,
+    Reply = 2,
+    Error = 3   // Handler threw; payload is the message
+};
+
+constexpr size_t DEFAULT_RPC_QUEUE_SIZE = 1024 * 1024;
+
+// ============================================================================
+// Client
+// ============================================================================
+
+class Client {
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+
+    explicit Client(std::unique_ptr<Impl> impl);
+
+public:
+    // Non-copyable, moveable
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+    Client(Client&&) noexcept;
+    Client& operator=(Client&&) noexcept;
+    ~Client();
+
+    [[nodiscard]] static Client create(std::string_view service, size_t size = DEFAULT_RPC_QUEUE_SIZE,
+                                       SegmentMode mode = default_segment_mode());
+
+    // Send `request` and wait for its reply. Returns nullopt if the deadline
+    // passes first; the call is then cancelled and a late reply is dropped.
+    // Throws MessageQueueError if the server's handler failed. Thread-safe.
+    [[nodiscard]] std::optional<Message> call(gsl::span<const char> request, Clock::time_point deadline);
+
+    [[nodiscard]] std::optional<Message> call(gsl::span<const char> request,
+                                              std::chrono::milliseconds timeout) {
+        return call(request, Clock::now() + timeout);
+    }
+
+    // Calls waiting for a reply
+    [[nodiscard]] size_t outstanding() const;
+};
+
+// ============================================================================
+// Server
+// ============================================================================
+
+class Server {
+public:
+    // Request payload in, reply payload out. Exceptions are reported to the
+    // caller as errors.
+    using Handler = std::function<Message(gsl::span<const char>)>;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+
+    explicit Server(std::unique_ptr<Impl> impl);
+
+public:
+    // Non-copyable, moveable
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+    Server(Server&&) noexcept;
+    Server& operator=(Server&&) noexcept;
+    ~Server();
+
+    [[nodiscard]] static Server create(std::string_view service, Handler handler,
+                                       size_t size = DEFAULT_RPC_QUEUE_SIZE,
+                                       SegmentMode mode = default_segment_mode());
+
+    // Wait up to timeout_ms for requests and answer every pending one.
+    // Requests whose deadline has already passed are dropped unanswered.
+    // Returns the number of requests handled.
+    size_t poll(int timeout_ms = DEFAULT_TIMEOUT_MS);
+
+    // Dispatch loop; returns after stop() is called from another thread
+    void run();
+    void stop() noexcept;
+
+    // Run the dispatch loop on a thread of the server's own, configured
+    // with `realtime` first; returns what took effect. Ends on stop() or
+    // destruction, or when a queue error escapes it. Throws if a thread
+    // started earlier has not been wait()ed for.
+    RealtimeReport start(const RealtimeOptions& realtime = {});
+
+    // Join the thread started by start(); rethrows the error that ended it
+    void wait();
+};
+
+} // namespace rpc
+} // namespace msgq
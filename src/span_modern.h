@@ -0,0 +1,184 @@
+#pragma once
+
+/*
+ * Span abstraction shared by msgq_modern.h and ipc_modern.h
+ * C++20: std::span, C++17 with GSL: gsl::span, otherwise a minimal fallback
+ */
+
+#include <cstddef>
+
+// C++20 std::span support
+#if __cplusplus >= 202002L
+  #include <span>
+#endif
+
+// Optional: GSL support
+// Install: sudo apt-get install gsl-lite-dev (Ubuntu/Debian)
+//          brew install gsl (macOS)
+#ifdef __has_include
+  #if __has_include(<gsl/gsl>)
+    #include <gsl/gsl>
+    #define MSGQ_HAS_GSL 1
+  #else
+    #define MSGQ_HAS_GSL 0
+  #endif
+#else
+  #define MSGQ_HAS_GSL 0
+#endif
+
+// ============================================================================
+// Span abstraction - unified interface for C++20 std::span and fallback
+// ============================================================================
+
+namespace msgq {
+  
+  #if __cplusplus >= 202002L
+    // C++20: Use std::span directly
+    template<typename T>
+    using span = std::span<T>;
+    
+    // Mark that we're using std::span
+    #define MSGQ_USING_STD_SPAN 1
+    
+    // Helper for creating spans with deduction
+    template<typename T>
+    constexpr span<T> make_span(T* data, size_t size) noexcept {
+      return span<T>(data, size);
+    }
+    
+    template<typename Container>
+    constexpr auto make_span(Container& c) noexcept {
+      return span<typename Container::value_type>(c);
+    }
+    
+    template<typename Container>
+    constexpr auto make_span(const Container& c) noexcept {
+      return span<const typename Container::value_type>(c);
+    }
+  
+  #elif MSGQ_HAS_GSL
+    // C++17 with GSL: Use gsl::span
+    using gsl::span;
+    
+    #undef MSGQ_USING_STD_SPAN
+    
+    template<typename T>
+    constexpr span<T> make_span(T* data, size_t size) noexcept {
+      return span<T>(data, size);
+    }
+    
+    template<typename Container>
+    constexpr auto make_span(Container& c) noexcept {
+      return span<typename Container::value_type>(c);
+    }
+    
+    template<typename Container>
+    constexpr auto make_span(const Container& c) noexcept {
+      return span<const typename Container::value_type>(c);
+    }
+  
+  #else
+    // C++17 fallback: Minimal span implementation
+    template<typename T>
+    class span {
+    private:
+      T* data_;
+      size_t size_;
+    
+    public:
+      // Constructors
+      constexpr span() noexcept : data_(nullptr), size_(0) {}
+      
+      constexpr span(T* data, size_t size) noexcept 
+        : data_(data), size_(size) {}
+      
+      // From containers (SFINAE-enabled)
+      template<typename Container>
+      constexpr span(Container& c) noexcept 
+        : data_(c.data()), size_(c.size()) {}
+      
+      template<typename Container>
+      constexpr span(const Container& c) noexcept 
+        : data_(const_cast<T*>(c.data())), size_(c.size()) {}
+      
+      // Copy constructor and assignment
+      constexpr span(const span&) noexcept = default;
+      constexpr span& operator=(const span&) noexcept = default;
+      
+      // Element access
+      [[nodiscard]] constexpr T* data() const noexcept { return data_; }
+      [[nodiscard]] constexpr size_t size() const noexcept { return size_; }
+      [[nodiscard]] constexpr size_t size_bytes() const noexcept { 
+        return size_ * sizeof(T); 
+      }
+      [[nodiscard]] constexpr bool empty() const noexcept { return size_ == 0; }
+      
+      // Indexed access
+      [[nodiscard]] constexpr T& operator[](size_t idx) const noexcept {
+        return data_[idx];
+      }
+      
+      [[nodiscard]] constexpr T& front() const noexcept {
+        return data_[0];
+      }
+      
+      [[nodiscard]] constexpr T& back() const noexcept {
+        return data_[size_ - 1];
+      }
+      
+      // Iterator support
+      [[nodiscard]] constexpr T* begin() const noexcept { return data_; }
+      [[nodiscard]] constexpr T* end() const noexcept { return data_ + size_; }
+      [[nodiscard]] constexpr const T* cbegin() const noexcept { return data_; }
+      [[nodiscard]] constexpr const T* cend() const noexcept { return data_ + size_; }
+      
+      // Subspan
+      [[nodiscard]] constexpr span subspan(size_t offset, size_t count = -1) const noexcept {
+        if (count == (size_t)-1) count = size_ - offset;
+        return span(data_ + offset, count);
+      }
+      
+      [[nodiscard]] constexpr span first(size_t count) const noexcept {
+        return span(data_, count);
+      }
+      
+      [[nodiscard]] constexpr span last(size_t count) const noexcept {
+        return span(data_ + size_ - count, count);
+      }
+      
+      // Comparison
+      constexpr bool operator==(const span& other) const noexcept {
+        return data_ == other.data_ && size_ == other.size_;
+      }
+      
+      constexpr bool operator!=(const span& other) const noexcept {
+        return !(*this == other);
+      }
+    };
+    
+    #undef MSGQ_USING_STD_SPAN
+    
+    // Helper functions for span creation
+    template<typename T>
+    constexpr span<T> make_span(T* data, size_t size) noexcept {
+      return span<T>(data, size);
+    }
+    
+    template<typename Container>
+    constexpr auto make_span(Container& c) noexcept {
+      return span<typename Container::value_type>(c);
+    }
+    
+    template<typename Container>
+    constexpr auto make_span(const Container& c) noexcept {
+      return span<const typename Container::value_type>(c);
+    }
+  
+  #endif // Span implementation selection
+  
+} // namespace msgq
+
+// Make gsl::span available as an alias
+namespace gsl {
+  using msgq::span;
+}
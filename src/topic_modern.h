@@ -0,0 +1,195 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+/// @file topic_modern.h
+/// @brief 编译期话题注册表：名称、哈希 ID、段大小与消息类型
+/// @details 独立头文件（不依赖 ipc.h / msgq.h），msgq::Queue 与 SubSocket/PubSocket 共用。
+///          话题常量在编译期校验名称并算出 ID、段大小与 /dev/shm 路径，
+///          非法名称、注册表内重名或哈希冲突都在编译期报错，而不是进程启动时。
+///
+/// 用法：
+/// @code
+///   inline constexpr msgq::Topic<CarState> CAR_STATE{"carState"};
+///   inline constexpr msgq::Topic<> LOG_MESSAGE{"logMessage", 1024 * 1024};
+///   inline constexpr auto TOPICS = msgq::make_topic_table(CAR_STATE, LOG_MESSAGE);
+///   static_assert(TOPICS.find("carState") != nullptr);
+///
+///   auto queue = msgq::Queue::create(CAR_STATE);
+/// @endcode
+
+namespace msgq {
+
+/// @brief 话题名最大长度（memfd 模式下抽象 unix 套接字地址也要容纳它）
+constexpr size_t MAX_TOPIC_NAME = 64;
+
+/// @brief 命名段所在目录
+constexpr std::string_view TOPIC_PATH_PREFIX = "/dev/shm/";
+
+/// @brief 变长话题的默认段大小
+/// @note 与 msgq_modern.h 的 DEFAULT_SEGMENT_SIZE 相同；这里不能引用它，
+///       因为旧 msgq.h 把同名标识符定义成了宏
+constexpr size_t TOPIC_DEFAULT_SEGMENT_SIZE = 10 * 1024 * 1024;
+
+/// @brief 按消息类型推导段大小时，段至少容纳的消息条数与段大小下限
+constexpr size_t TOPIC_DEFAULT_DEPTH = 256;
+constexpr size_t TOPIC_MIN_SEGMENT_SIZE = 64 * 1024;
+
+/// @brief 每条记录的帧头开销（msgq_modern.cc 中 RecordHeader 的大小）
+constexpr size_t TOPIC_RECORD_OVERHEAD = 40;
+
+/// @brief FNV-1a 64 位哈希，编译期与运行期结果一致
+/// @param name 话题名
+/// @return 话题 ID
+constexpr uint64_t topic_hash(std::string_view name) noexcept {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : name) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/// @brief 类型擦除的话题描述，注册表按此存储
+struct TopicInfo {
+  std::string_view name;      ///< 话题名（同时是段名）
+  uint64_t id = 0;            ///< topic_hash(name)
+  size_t segment_size = 0;    ///< 数据区大小（字节）
+  size_t message_size = 0;    ///< 定长消息类型的大小，0 表示变长（原始字节）
+  std::array<char, TOPIC_PATH_PREFIX.size() + MAX_TOPIC_NAME + 1> path{};  ///< "/dev/shm/<name>"，以 NUL 结尾
+
+  /// @brief 构造并校验话题描述
+  /// @param name 话题名：非空、不超过 MAX_TOPIC_NAME、不含 '/' 与 NUL
+  /// @param segment_size 数据区大小（非 0）
+  /// @param message_size 定长消息大小，0 表示变长
+  /// @throws std::invalid_argument 名称或大小非法（常量求值时即为编译错误）
+  constexpr TopicInfo(std::string_view name, size_t segment_size, size_t message_size)
+      : name(name), id(topic_hash(name)), segment_size(segment_size), message_size(message_size) {
+    if (name.empty() || name.size() > MAX_TOPIC_NAME) {
+      throw std::invalid_argument("Topic name must be 1 to MAX_TOPIC_NAME characters");
+    }
+    if (segment_size == 0) {
+      throw std::invalid_argument("Topic segment size cannot be zero");
+    }
+    size_t n = 0;
+    for (char c : TOPIC_PATH_PREFIX) {
+      path[n++] = c;
+    }
+    for (char c : name) {
+      if (c == '/' || c == '\0') {
+        throw std::invalid_argument("Topic name cannot contain '/' or NUL");
+      }
+      path[n++] = c;
+    }
+  }
+
+  /// @brief 预先拼好的共享内存路径
+  [[nodiscard]] constexpr const char* c_path() const noexcept {
+    return path.data();
+  }
+};
+
+namespace detail {
+
+template <typename T>
+constexpr size_t topic_message_size() noexcept {
+  if constexpr (std::is_void_v<T>) {
+    return 0;
+  } else {
+    return sizeof(T);
+  }
+}
+
+/// @brief 由消息大小推导段大小：容纳 TOPIC_DEFAULT_DEPTH 条记录，按页取整
+constexpr size_t topic_segment_size(size_t message_size) noexcept {
+  if (message_size == 0) {
+    return TOPIC_DEFAULT_SEGMENT_SIZE;
+  }
+  const size_t record = (message_size + TOPIC_RECORD_OVERHEAD + 7) & ~size_t{7};
+  const size_t size = (record * TOPIC_DEFAULT_DEPTH + 4095) & ~size_t{4095};
+  return size < TOPIC_MIN_SEGMENT_SIZE ? TOPIC_MIN_SEGMENT_SIZE : size;
+}
+
+}  // namespace detail
+
+/// @brief 带消息类型的话题常量
+/// @tparam T 定长消息类型（按原始字节发送，须可平凡复制）；void 表示变长
+template <typename T = void>
+struct Topic : TopicInfo {
+  static_assert(std::is_void_v<T> || std::is_trivially_copyable_v<T>,
+                "topic messages are sent as raw bytes");
+
+  using message_type = T;
+
+  /// @brief 构造话题常量
+  /// @param name 话题名
+  /// @param segment_size 数据区大小，0 表示按消息类型推导
+  explicit constexpr Topic(std::string_view name, size_t segment_size = 0)
+      : TopicInfo(name,
+                  segment_size != 0 ? segment_size
+                                    : detail::topic_segment_size(detail::topic_message_size<T>()),
+                  detail::topic_message_size<T>()) {}
+};
+
+/// @brief 编译期话题表
+/// @details 构造时检查重名与 ID 冲突；查找在常量表达式中同样可用。
+template <size_t N>
+class TopicTable {
+public:
+  /// @throws std::invalid_argument 有重名或哈希冲突（常量求值时即为编译错误）
+  explicit constexpr TopicTable(const std::array<TopicInfo, N>& topics) : topics_(topics) {
+    for (size_t i = 0; i < N; ++i) {
+      for (size_t j = i + 1; j < N; ++j) {
+        if (topics_[i].name == topics_[j].name) {
+          throw std::invalid_argument("Duplicate topic name");
+        }
+        if (topics_[i].id == topics_[j].id) {
+          throw std::invalid_argument("Topic id collision");
+        }
+      }
+    }
+  }
+
+  /// @brief 按名称查找
+  /// @return 话题描述，未注册时为 nullptr
+  [[nodiscard]] constexpr const TopicInfo* find(std::string_view name) const noexcept {
+    const uint64_t id = topic_hash(name);
+    for (const TopicInfo& topic : topics_) {
+      if (topic.id == id && topic.name == name) {
+        return &topic;
+      }
+    }
+    return nullptr;
+  }
+
+  /// @brief 按 ID 查找
+  /// @return 话题描述，未注册时为 nullptr
+  [[nodiscard]] constexpr const TopicInfo* find(uint64_t id) const noexcept {
+    for (const TopicInfo& topic : topics_) {
+      if (topic.id == id) {
+        return &topic;
+      }
+    }
+    return nullptr;
+  }
+
+  [[nodiscard]] constexpr size_t size() const noexcept { return N; }
+  [[nodiscard]] constexpr const TopicInfo* begin() const noexcept { return topics_.data(); }
+  [[nodiscard]] constexpr const TopicInfo* end() const noexcept { return topics_.data() + N; }
+
+private:
+  std::array<TopicInfo, N> topics_;
+};
+
+/// @brief 由话题常量构造话题表
+template <typename... Topics>
+constexpr TopicTable<sizeof...(Topics)> make_topic_table(const Topics&... topics) {
+  return TopicTable<sizeof...(Topics)>(std::array<TopicInfo, sizeof...(Topics)>{topics...});
+}
+
+}  // namespace msgq
@@ -0,0 +1,671 @@
+#include "unix_socket_modern.h"
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <linux/sockios.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+namespace msgq {
+
+namespace {
+
+constexpr size_t PACKET_SIZE = sizeof(UnixFrameHeader) + UNIX_PACKET_PAYLOAD;
+constexpr size_t CONTROL_SIZE = CMSG_SPACE(sizeof(int));
+constexpr size_t SEND_BATCH = 64;                   // Backlog packets per sendmmsg(2)
+constexpr uint64_t MAX_MESSAGE_SIZE = 1ull << 31;   // Refuse to reassemble anything larger
+constexpr int SEND_BUFFER_SIZE = 4 * 1024 * 1024;   // Requested per subscriber, capped by wmem_max
+
+void close_fd(int& fd) noexcept {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+// Fill `addr` for `address`: a filesystem path if it starts with '/' or '.',
+// the abstract namespace otherwise
+socklen_t make_address(const std::string& address, sockaddr_un& addr) {
+    const bool filesystem = address[0] == '/' || address[0] == '.';
+    if (address.size() + 1 > sizeof(addr.sun_path)) {
+        throw std::invalid_argument("Unix socket address too long: " + address);
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (filesystem) {
+        std::memcpy(addr.sun_path, address.data(), address.size());
+        return static_cast<socklen_t>(sizeof(addr));
+    }
+    // sun_path[0] == '\0' selects the abstract namespace
+    std::memcpy(addr.sun_path + 1, address.data(), address.size());
+    return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + address.size());
+}
+
+// Send packets[0, count) without blocking. Returns how many went out, or
+// -1 if the subscriber is gone.
+ssize_t send_packets(int fd, struct mmsghdr* packets, size_t count) {
+    size_t sent = 0;
+    while (sent < count) {
+        int n;
+        if (count - sent == 1) {
+            n = ::sendmsg(fd, &packets[sent].msg_hdr, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 ? -1 : 1;
+        } else {
+            n = ::sendmmsg(fd, packets + sent, static_cast<unsigned>(std::min<size_t>(count - sent, UIO_MAXIOV)),
+                           MSG_DONTWAIT | MSG_NOSIGNAL);
+        }
+        if (n > 0) {
+            sent += n;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+            break;
+        } else {
+            return -1;
+        }
+    }
+    return static_cast<ssize_t>(sent);
+}
+
+// The fd passed with a received packet, -1 if none
+int received_fd(struct msghdr& msg) noexcept {
+    if (msg.msg_controllen == 0) {
+        return -1;
+    }
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+            cmsg->cmsg_len >= CMSG_LEN(sizeof(int))) {
+            int fd;
+            std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+            return fd;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+bool messaging_use_unix() noexcept {
+    const char* value = std::getenv("MSGQ_UNIX");
+    return value != nullptr && std::strcmp(value, "0") != 0;
+}
+
+std::string unix_socket_address(std::string_view name) {
+    if (name.empty()) {
+        throw std::invalid_argument("Topic name cannot be empty");
+    }
+    if (name.find('/') != std::string_view::npos || name.find('\0') != std::string_view::npos) {
+        throw std::invalid_argument("Topic name cannot contain '/' or NUL: " + std::string(name));
+    }
+
+    std::string address;
+    if (const char* dir = std::getenv("MSGQ_UNIX_DIR"); dir != nullptr && *dir != '\0') {
+        address = dir;
+        if (address[0] != '/' && address[0] != '.') {
+            address.insert(0, "./");
+        }
+    } else {
+        address = "msgq-unix";
+    }
+    address += '/';
+    if (const char* prefix = std::getenv("OPENPILOT_PREFIX"); prefix != nullptr && *prefix != '\0') {
+        address += prefix;
+        address += '/';
+    }
+    address += name;
+    return address;
+}
+
+// ----------------------------------------------------------------------------
+// UnixPublisher
+// ----------------------------------------------------------------------------
+
+UnixPublisher::Packet::~Packet() {
+    close_fd(fd);
+}
+
+UnixPublisher::UnixPublisher(int listen_fd, std::string path, const UnixPublisherOptions& options) noexcept
+    : listen_fd_(listen_fd), path_(std::move(path)), options_(options) {}
+
+std::unique_ptr<UnixPublisher> UnixPublisher::bind(std::string_view name, const UnixPublisherOptions& options) {
+    const std::string address = unix_socket_address(name);
+    const bool filesystem = address[0] == '/' || address[0] == '.';
+    sockaddr_un addr;
+    const socklen_t len = make_address(address, addr);
+
+    if (filesystem) {
+        // The prefix directory, if any; the base directory must exist and
+        // bind() reports anything else that is wrong with the path
+        ::mkdir(address.substr(0, address.rfind('/')).c_str(), 0777);
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Failed to create unix socket");
+    }
+
+    int rc = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), len);
+    if (rc < 0 && errno == EADDRINUSE && filesystem) {
+        // A socket file left by a publisher that died: take it over unless
+        // somebody still listens on it
+        int probe = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        const bool stale = probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr*>(&addr), len) < 0 &&
+                           errno == ECONNREFUSED;
+        close_fd(probe);
+        if (stale) {
+            ::unlink(address.c_str());
+            rc = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), len);
+        } else {
+            errno = EADDRINUSE;
+        }
+    }
+    if (rc < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "Failed to bind unix socket '" + address + "'");
+    }
+
+    return std::unique_ptr<UnixPublisher>(new UnixPublisher(fd, filesystem ? address : std::string(), options));
+}
+
+UnixPublisher::~UnixPublisher() {
+    for (auto& subscriber : subscribers_) {
+        close_fd(subscriber.fd);
+    }
+    close_fd(listen_fd_);
+    if (!path_.empty()) {
+        ::unlink(path_.c_str());
+    }
+}
+
+void UnixPublisher::accept_subscribers() {
+    for (;;) {
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return;  // EAGAIN: nobody waiting (other errors: retried on the next send)
+        }
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &SEND_BUFFER_SIZE, sizeof(SEND_BUFFER_SIZE));
+        ::shutdown(fd, SHUT_RD);
+        subscribers_.push_back(Subscriber{fd, {}});
+    }
+}
+
+void UnixPublisher::drop_subscriber(size_t index) {
+    close_fd(subscribers_[index].fd);
+    subscribers_.erase(subscribers_.begin() + index);
+}
+
+bool UnixPublisher::flush_backlog(Subscriber& subscriber) {
+    struct mmsghdr packets[SEND_BATCH];
+    struct iovec iovecs[SEND_BATCH];
+    alignas(cmsghdr) char controls[SEND_BATCH][CONTROL_SIZE];
+
+    while (!subscriber.backlog.empty()) {
+        const size_t count = std::min(subscriber.backlog.size(), SEND_BATCH);
+        for (size_t i = 0; i < count; ++i) {
+            const Packet& packet = *subscriber.backlog[i];
+            iovecs[i] = {const_cast<char*>(packet.bytes.data()), packet.bytes.size()};
+            packets[i] = {};
+            packets[i].msg_hdr.msg_iov = &iovecs[i];
+            packets[i].msg_hdr.msg_iovlen = 1;
+            if (packet.fd >= 0) {
+                packets[i].msg_hdr.msg_control = controls[i];
+                packets[i].msg_hdr.msg_controllen = CONTROL_SIZE;
+                cmsghdr* cmsg = CMSG_FIRSTHDR(&packets[i].msg_hdr);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_RIGHTS;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+                std::memcpy(CMSG_DATA(cmsg), &packet.fd, sizeof(int));
+            }
+        }
+        const ssize_t sent = send_packets(subscriber.fd, packets, count);
+        if (sent < 0) {
+            return false;
+        }
+        subscriber.backlog.erase(subscriber.backlog.begin(), subscriber.backlog.begin() + sent);
+        if (static_cast<size_t>(sent) < count) {
+            break;  // Socket full again
+        }
+    }
+    return true;
+}
+
+int UnixPublisher::create_memfd(span<const span<const char>> parts, size_t size) {
+    int fd = ::memfd_create("msgq:unix", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        // Seccomp sandboxes may forbid memfd_create: fragment from now on
+        memfd_available_ = false;
+        return -1;
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    off_t offset = 0;
+    for (const auto& part : parts) {
+        size_t done = 0;
+        while (done < part.size()) {
+            const ssize_t n = ::pwrite(fd, part.data() + done, part.size() - done, offset);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                ::close(fd);
+                return -1;
+            }
+            done += n;
+            offset += n;
+        }
+    }
+
+    // Subscribers get a read-only view that can no longer change
+    if (::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+size_t UnixPublisher::send(span<const span<const char>> parts) {
+    accept_subscribers();
+    if (subscribers_.empty()) {
+        return 0;
+    }
+
+    size_t size = 0;
+    for (const auto& part : parts) {
+        size += part.size();
+    }
+
+    int memfd = -1;
+    if (options_.memfd && memfd_available_ && size > UNIX_PACKET_PAYLOAD && size > options_.memfd_threshold) {
+        memfd = create_memfd(parts, size);
+    }
+    alignas(cmsghdr) char control[CONTROL_SIZE];
+
+    headers_.clear();
+    iovecs_.clear();
+    packets_.clear();
+    if (memfd >= 0) {
+        headers_.push_back(UnixFrameHeader{UNIX_FRAME_MEMFD, 0, size});
+        iovecs_.push_back({headers_.data(), sizeof(UnixFrameHeader)});
+        packets_.push_back({});
+        packets_[0].msg_hdr.msg_iov = iovecs_.data();
+        packets_[0].msg_hdr.msg_iovlen = 1;
+        packets_[0].msg_hdr.msg_control = control;
+        packets_[0].msg_hdr.msg_controllen = sizeof(control);
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&packets_[0].msg_hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+    } else {
+        const size_t fragments = std::max<size_t>((size + UNIX_PACKET_PAYLOAD - 1) / UNIX_PACKET_PAYLOAD, 1);
+        headers_.resize(fragments);
+        // One header per fragment plus at most one extra iovec per part
+        // boundary, so the vector never reallocates while we point into it
+        iovecs_.reserve(2 * fragments + parts.size());
+        packets_.resize(fragments);
+
+        size_t part = 0;
+        size_t part_offset = 0;
+        for (size_t f = 0; f < fragments; ++f) {
+            uint32_t flags = 0;
+            if (fragments > 1) {
+                flags = UNIX_FRAME_FRAGMENT | (f == 0 ? UNIX_FRAME_FIRST : 0) |
+                        (f == fragments - 1 ? UNIX_FRAME_LAST : 0);
+            }
+            headers_[f] = UnixFrameHeader{flags, 0, size};
+
+            const size_t first = iovecs_.size();
+            iovecs_.push_back({&headers_[f], sizeof(UnixFrameHeader)});
+            size_t room = UNIX_PACKET_PAYLOAD;
+            while (room > 0 && part < parts.size()) {
+                const size_t take = std::min(room, parts[part].size() - part_offset);
+                if (take > 0) {
+                    iovecs_.push_back({const_cast<char*>(parts[part].data()) + part_offset, take});
+                    room -= take;
+                    part_offset += take;
+                }
+                if (part_offset == parts[part].size()) {
+                    part++;
+                    part_offset = 0;
+                }
+            }
+
+            packets_[f] = {};
+            packets_[f].msg_hdr.msg_iov = &iovecs_[first];
+            packets_[f].msg_hdr.msg_iovlen = iovecs_.size() - first;
+        }
+    }
+
+    // Copies for slow subscribers, made once and shared between them
+    std::vector<std::shared_ptr<const Packet>> copies;
+    auto copy_of = [&](size_t index) {
+        if (copies.empty()) {
+            copies.resize(packets_.size());
+        }
+        if (!copies[index]) {
+            auto packet = std::make_shared<Packet>();
+            const msghdr& msg = packets_[index].msg_hdr;
+            for (size_t i = 0; i < msg.msg_iovlen; ++i) {
+                const char* base = static_cast<const char*>(msg.msg_iov[i].iov_base);
+                packet->bytes.insert(packet->bytes.end(), base, base + msg.msg_iov[i].iov_len);
+            }
+            if (memfd >= 0) {
+                packet->fd = ::fcntl(memfd, F_DUPFD_CLOEXEC, 0);
+            }
+            copies[index] = std::move(packet);
+        }
+        return copies[index];
+    };
+
+    size_t reached = 0;
+    for (size_t i = 0; i < subscribers_.size();) {
+        Subscriber& subscriber = subscribers_[i];
+        if (!flush_backlog(subscriber)) {
+            drop_subscriber(i);
+            continue;
+        }
+
+        size_t sent = 0;
+        if (subscriber.backlog.empty()) {
+            const ssize_t n = send_packets(subscriber.fd, packets_.data(), packets_.size());
+            if (n < 0) {
+                drop_subscriber(i);
+                continue;
+            }
+            sent = static_cast<size_t>(n);
+        }
+
+        if (sent < packets_.size()) {
+            // Whole messages only: once the first packet is out the rest
+            // is queued even past the limit
+            if (sent == 0 && subscriber.backlog.size() + packets_.size() > options_.max_backlog) {
+                dropped_++;
+                ++i;
+                continue;
+            }
+            for (size_t p = sent; p < packets_.size(); ++p) {
+                subscriber.backlog.push_back(copy_of(p));
+            }
+        }
+        reached++;
+        ++i;
+    }
+
+    if (memfd >= 0) {
+        ::close(memfd);
+    }
+    return reached;
+}
+
+bool UnixPublisher::all_readers_updated() const {
+    for (const auto& subscriber : subscribers_) {
+        int queued = 0;
+        if (!subscriber.backlog.empty() || (::ioctl(subscriber.fd, SIOCOUTQ, &queued) == 0 && queued > 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// UnixSubscriber
+// ----------------------------------------------------------------------------
+
+UnixSubscriber::UnixSubscriber(std::string address)
+    : address_(std::move(address)),
+      slots_(UNIX_RECV_BATCH * PACKET_SIZE),
+      controls_(UNIX_RECV_BATCH * CONTROL_SIZE),
+      iovecs_(UNIX_RECV_BATCH),
+      packets_(UNIX_RECV_BATCH),
+      message_(ByteBuffer::allocator_type(resource_)) {}
+
+std::unique_ptr<UnixSubscriber> UnixSubscriber::connect(std::string_view name) {
+    std::unique_ptr<UnixSubscriber> subscriber(new UnixSubscriber(unix_socket_address(name)));
+    subscriber->try_connect();
+    return subscriber;
+}
+
+UnixSubscriber::~UnixSubscriber() {
+    disconnect();
+}
+
+void UnixSubscriber::set_memory_resource(std::pmr::memory_resource* resource) noexcept {
+    resource_ = resource != nullptr ? resource : std::pmr::get_default_resource();
+    message_ = ByteBuffer(ByteBuffer::allocator_type(resource_));
+    assembling_ = false;
+}
+
+bool UnixSubscriber::try_connect() {
+    if (fd_ >= 0) {
+        return true;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (now < next_attempt_) {
+        return false;
+    }
+    next_attempt_ = now + UNIX_RECONNECT_INTERVAL;
+
+    int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    sockaddr_un addr;
+    const socklen_t len = make_address(address_, addr);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), len) < 0) {
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    return true;
+}
+
+void UnixSubscriber::discard_batch() noexcept {
+    for (; next_ < count_; ++next_) {
+        int fd = received_fd(packets_[next_].msg_hdr);
+        close_fd(fd);
+    }
+    next_ = count_ = 0;
+}
+
+void UnixSubscriber::disconnect() noexcept {
+    discard_batch();
+    close_fd(fd_);
+    assembling_ = false;
+    // Retry right away: the publisher may already be back
+    next_attempt_ = {};
+}
+
+// Read the next batch of packets. False if nothing is waiting.
+bool UnixSubscriber::fill() {
+    for (size_t i = 0; i < UNIX_RECV_BATCH; ++i) {
+        iovecs_[i] = {slots_.data() + i * PACKET_SIZE, PACKET_SIZE};
+        packets_[i] = {};
+        packets_[i].msg_hdr.msg_iov = &iovecs_[i];
+        packets_[i].msg_hdr.msg_iovlen = 1;
+        packets_[i].msg_hdr.msg_control = controls_.data() + i * CONTROL_SIZE;
+        packets_[i].msg_hdr.msg_controllen = CONTROL_SIZE;
+    }
+
+    for (;;) {
+        const int n = ::recvmmsg(fd_, packets_.data(), UNIX_RECV_BATCH, MSG_DONTWAIT | MSG_CMSG_CLOEXEC, nullptr);
+        if (n > 0) {
+            next_ = 0;
+            count_ = static_cast<size_t>(n);
+            return true;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return false;
+        }
+        disconnect();
+        return false;
+    }
+}
+
+// Consume buffered packets until a message is complete
+bool UnixSubscriber::take(ByteBuffer& out) {
+    while (next_ < count_) {
+        struct msghdr& msg = packets_[next_].msg_hdr;
+        const size_t length = packets_[next_].msg_len;
+        const char* data = slots_.data() + next_ * PACKET_SIZE;
+        int fd = received_fd(msg);
+        next_++;
+
+        if (length == 0) {
+            // Publisher closed the connection (seqpacket EOF)
+            close_fd(fd);
+            disconnect();
+            return false;
+        }
+        UnixFrameHeader header;
+        if ((msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0 || length < sizeof(header)) {
+            close_fd(fd);
+            errors_++;
+            continue;
+        }
+        std::memcpy(&header, data, sizeof(header));
+
+        if (header.flags & UNIX_FRAME_MEMFD) {
+            assembling_ = false;
+            struct stat st;
+            if (fd < 0 || header.size > MAX_MESSAGE_SIZE || ::fstat(fd, &st) < 0 ||
+                static_cast<uint64_t>(st.st_size) < header.size) {
+                close_fd(fd);
+                errors_++;
+                continue;
+            }
+            out.resize(header.size);
+            size_t done = 0;
+            while (done < out.size()) {
+                const ssize_t n = ::pread(fd, out.data() + done, out.size() - done, static_cast<off_t>(done));
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) break;
+                done += n;
+            }
+            close_fd(fd);
+            if (done != out.size()) {
+                errors_++;
+                continue;
+            }
+            return true;
+        }
+        close_fd(fd);
+
+        const char* payload = data + sizeof(header);
+        const size_t payload_size = length - sizeof(header);
+        if (!(header.flags & UNIX_FRAME_FRAGMENT)) {
+            assembling_ = false;
+            if (payload_size != header.size) {
+                errors_++;
+                continue;
+            }
+            out.resize(payload_size);
+            if (payload_size != 0) {
+                std::memcpy(out.data(), payload, payload_size);
+            }
+            return true;
+        }
+
+        if (header.flags & UNIX_FRAME_FIRST) {
+            if (header.size > MAX_MESSAGE_SIZE) {
+                assembling_ = false;
+                errors_++;
+                continue;
+            }
+            message_.resize(header.size);
+            filled_ = 0;
+            assembling_ = true;
+        } else if (!assembling_ || message_.size() != header.size) {
+            assembling_ = false;
+            errors_++;
+            continue;
+        }
+        if (payload_size > message_.size() - filled_) {
+            assembling_ = false;
+            errors_++;
+            continue;
+        }
+        std::memcpy(message_.data() + filled_, payload, payload_size);
+        filled_ += payload_size;
+
+        if (header.flags & UNIX_FRAME_LAST) {
+            assembling_ = false;
+            if (filled_ != message_.size()) {
+                errors_++;
+                continue;
+            }
+            // Steals the buffer when both use the same resource
+            out = std::move(message_);
+            message_.clear();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool UnixSubscriber::receive(ByteBuffer& out, int timeout_ms, bool conflate) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+    bool received = false;
+
+    for (;;) {
+        while (take(out)) {
+            received = true;
+            if (!conflate) {
+                return true;
+            }
+        }
+        // Batch used up; with conflate keep reading while data is waiting
+        if (fd_ >= 0 && fill()) {
+            continue;
+        }
+        if (received) {
+            return true;
+        }
+        // Reconnect (rate-limited) before the deadline check, so polling
+        // with timeout_ms == 0 still finds a publisher that came up later
+        if (fd_ < 0 && try_connect()) {
+            continue;
+        }
+
+        int wait_ms = -1;
+        if (timeout_ms >= 0) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0) {
+                return false;
+            }
+            wait_ms = static_cast<int>(left);
+        }
+
+        if (fd_ < 0) {
+            auto pause = std::chrono::duration_cast<std::chrono::milliseconds>(
+                next_attempt_ - std::chrono::steady_clock::now());
+            if (wait_ms >= 0) {
+                pause = std::min(pause, std::chrono::milliseconds(wait_ms));
+            }
+            std::this_thread::sleep_for(std::max(pause, std::chrono::milliseconds(1)));
+            continue;
+        }
+
+        struct pollfd pfd = {fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, wait_ms) < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+} // namespace msgq
@@ -0,0 +1,204 @@
+#pragma once
+
+/*
+ * Publish/subscribe over AF_UNIX SOCK_SEQPACKET sockets
+ *
+ * For processes that cannot map /dev/shm (sandboxed plugins). The
+ * publisher listens on a unix socket named after the topic and every
+ * subscriber holds its own connection, so the kernel keeps packet
+ * boundaries and order and reports a dead peer as a hangup.
+ *
+ * - Each message is one packet when it fits in UNIX_PACKET_PAYLOAD, or a
+ *   run of fragments handed to the kernel in one sendmmsg(2) per
+ *   subscriber. Past PublisherOptions::memfd_threshold the payload is
+ *   written once into a sealed memfd that every subscriber receives
+ *   through SCM_RIGHTS, so a large message costs one copy regardless of
+ *   the number of subscribers.
+ * - A subscriber that cannot keep up has its packets queued; the queue
+ *   is flushed with sendmmsg(2) before the next send, and beyond
+ *   max_backlog packets whole messages are dropped for that subscriber
+ *   only (the publisher never blocks, as with the shared-memory ring).
+ * - Subscribers drain up to UNIX_RECV_BATCH packets per recvmmsg(2).
+ *
+ * Sockets live in the abstract namespace ("msgq-unix/<prefix>/<name>"),
+ * or under the directory named by MSGQ_UNIX_DIR for sandboxes with their
+ * own network namespace. OPENPILOT_PREFIX keeps test instances apart.
+ *
+ * Self-contained (no msgq_modern.h / msgq.h) like memfd_segment_modern.h.
+ */
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "span_modern.h"
+#include "default_init_allocator_modern.h"
+
+namespace msgq {
+
+// Environment switch for the unix socket backend (MSGQ_UNIX=1)
+[[nodiscard]] bool messaging_use_unix() noexcept;
+
+// Largest payload carried inline in one packet; longer messages are
+// fragmented or passed by memfd. Fixed so both ends agree on it.
+constexpr size_t UNIX_PACKET_PAYLOAD = 16 * 1024;
+
+// Packets a subscriber takes per recvmmsg(2)
+constexpr size_t UNIX_RECV_BATCH = 16;
+
+// How often a subscriber without a publisher retries the connection
+constexpr auto UNIX_RECONNECT_INTERVAL = std::chrono::milliseconds(100);
+
+// Socket name of a topic: the abstract address without its leading NUL,
+// or a filesystem path when MSGQ_UNIX_DIR is set.
+// Throws std::invalid_argument for empty names or names containing '/'.
+[[nodiscard]] std::string unix_socket_address(std::string_view name);
+
+// Leading bytes of every packet
+struct UnixFrameHeader {
+    uint32_t flags;     // UNIX_FRAME_* bits
+    uint32_t reserved;
+    uint64_t size;      // Size of the whole message
+};
+
+constexpr uint32_t UNIX_FRAME_MEMFD = 1u << 0;     // Payload is in the memfd passed with the packet
+constexpr uint32_t UNIX_FRAME_FRAGMENT = 1u << 1;  // Part of a fragmented message
+constexpr uint32_t UNIX_FRAME_FIRST = 1u << 2;     // First fragment
+constexpr uint32_t UNIX_FRAME_LAST = 1u << 3;      // Last fragment
+
+struct UnixPublisherOptions {
+    bool memfd = true;                        // Pass large payloads as a sealed memfd
+    size_t memfd_threshold = 256 * 1024;      // Payloads above this go by memfd
+    size_t max_backlog = 1024;                // Packets queued per slow subscriber before dropping
+};
+
+class UnixPublisher {
+public:
+    // Listen on the topic's socket. Throws std::system_error, with
+    // EADDRINUSE if another live publisher owns the topic.
+    [[nodiscard]] static std::unique_ptr<UnixPublisher> bind(std::string_view name,
+                                                             const UnixPublisherOptions& options = {});
+
+    UnixPublisher(const UnixPublisher&) = delete;
+    UnixPublisher& operator=(const UnixPublisher&) = delete;
+    ~UnixPublisher();
+
+    // Send the concatenated parts as one message to every subscriber.
+    // Returns the number of subscribers it was sent or queued to.
+    size_t send(span<const span<const char>> parts);
+
+    // Subscribers currently connected (accepted on the last send)
+    [[nodiscard]] size_t subscribers() const noexcept { return subscribers_.size(); }
+
+    // True if every subscriber has read everything sent so far
+    [[nodiscard]] bool all_readers_updated() const;
+
+    // Messages dropped for subscribers whose backlog was full
+    [[nodiscard]] uint64_t dropped() const noexcept { return dropped_; }
+
+private:
+    // A packet that could not be sent yet: header + payload bytes and the
+    // memfd it carries, if any (owned)
+    struct Packet {
+        std::vector<char> bytes;
+        int fd = -1;
+        ~Packet();
+    };
+
+    struct Subscriber {
+        int fd = -1;
+        std::deque<std::shared_ptr<const Packet>> backlog;
+    };
+
+    UnixPublisher(int listen_fd, std::string path, const UnixPublisherOptions& options) noexcept;
+
+    void accept_subscribers();
+    bool flush_backlog(Subscriber& subscriber);
+    void drop_subscriber(size_t index);
+    int create_memfd(span<const span<const char>> parts, size_t size);
+
+    int listen_fd_ = -1;
+    std::string path_;  // Filesystem socket to unlink, empty in the abstract namespace
+    UnixPublisherOptions options_;
+    bool memfd_available_ = true;  // Cleared if memfd_create is not allowed here
+    std::vector<Subscriber> subscribers_;
+    uint64_t dropped_ = 0;
+
+    // Per-send scratch, kept to avoid allocating on every message
+    std::vector<UnixFrameHeader> headers_;
+    std::vector<struct iovec> iovecs_;
+    std::vector<struct mmsghdr> packets_;
+};
+
+class UnixSubscriber {
+public:
+    // Subscribe to a topic. Connects now if the publisher is up, otherwise
+    // on later calls; a publisher restart is picked up the same way.
+    [[nodiscard]] static std::unique_ptr<UnixSubscriber> connect(std::string_view name);
+
+    UnixSubscriber(const UnixSubscriber&) = delete;
+    UnixSubscriber& operator=(const UnixSubscriber&) = delete;
+    ~UnixSubscriber();
+
+    // Received messages are allocated from `resource` (null = default);
+    // it must outlive them
+    void set_memory_resource(std::pmr::memory_resource* resource) noexcept;
+
+    // Next message into `out`, waiting up to `timeout_ms` (0 polls,
+    // negative waits forever). With `conflate` everything already received
+    // is skipped but the newest message. False on timeout.
+    bool receive(ByteBuffer& out, int timeout_ms, bool conflate = false);
+
+    // A message is already buffered (no syscall)
+    [[nodiscard]] bool buffered() const noexcept { return next_ < count_; }
+
+    // Socket to poll for POLLIN, -1 while not connected
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+
+    // Connect if not connected; true when connected. Called by pollers.
+    bool try_connect();
+
+    // Drop the connection after a hangup; the next call reconnects
+    void disconnect() noexcept;
+
+    // Packets dropped as malformed or truncated
+    [[nodiscard]] uint64_t errors() const noexcept { return errors_; }
+
+private:
+    explicit UnixSubscriber(std::string address);
+
+    bool fill();
+    bool take(ByteBuffer& out);
+    void discard_batch() noexcept;
+
+    std::string address_;
+    int fd_ = -1;
+    std::chrono::steady_clock::time_point next_attempt_{};
+    std::pmr::memory_resource* resource_ = std::pmr::get_default_resource();
+
+    // recvmmsg batch: slot i holds a packet of up to the frame header plus
+    // UNIX_PACKET_PAYLOAD bytes
+    std::vector<char> slots_;
+    std::vector<char> controls_;
+    std::vector<struct iovec> iovecs_;
+    std::vector<struct mmsghdr> packets_;
+    size_t next_ = 0;   // Next packet to consume
+    size_t count_ = 0;  // Packets in the batch
+
+    ByteBuffer message_;  // Fragmented message being reassembled
+    size_t filled_ = 0;
+    bool assembling_ = false;
+    uint64_t errors_ = 0;
+};
+
+} // namespace msgq